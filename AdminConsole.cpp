@@ -11,13 +11,21 @@ void AdminConsole::setWeights(float u, float w, float s) {
         cerr << "Error: Weights must sum to 1.0\n";
         return;
     }
-    engine->setWeights(u, w, s);
+    queueManager->reconfigure([&]() { engine->setWeights(u, w, s); }, JournalRecord::weightChange(u, w, s));
     cout << "Weights updated successfully.\n";
 }
 
-void AdminConsole::setServiceTypeScore(string type, float score) {
-    engine->setServiceTypeScore(type, score);
+bool AdminConsole::setServiceTypeScore(string type, float score) {
+    bool updated = false;
+    queueManager->reconfigure([&]() { updated = engine->setServiceTypeScore(type, score); },
+        JournalRecord::serviceTypeScore(type, score));
+    if (!updated) {
+        cerr << "Error: Cannot add " << type << ", limit of "
+            << ServiceTypeRegistry::MAX_TYPES << " service types reached\n";
+        return false;
+    }
     cout << type << " score set to " << score << ".\n";
+    return true;
 }
 
 void AdminConsole::setFairnessParams(int maxWait, float boost) {
@@ -28,4 +36,31 @@ void AdminConsole::setFairnessParams(int maxWait, float boost) {
     queueManager->setFairnessParams(maxWait, boost);
     cout << "Fairness rules updated (Max wait: "
         << maxWait << " mins, Boost: " << boost << ").\n";
+}
+
+void AdminConsole::setScoringMode(ScoringMode mode) {
+    if (!queueManager->setScoringMode(mode)) {
+        cerr << "Error: " << engine->getPolicyName()
+            << " scores cannot use arrival-anchored keys\n";
+        return;
+    }
+    cout << "Scoring mode set to "
+        << (mode == ScoringMode::RECOMPUTE ? "recompute on every tick" : "arrival-anchored keys")
+        << ".\n";
+}
+
+void AdminConsole::setHistoryRetention(int hours, int maxRecords) {
+    if (hours < 0 || maxRecords < 0) {
+        cerr << "Error: Values must not be negative\n";
+        return;
+    }
+    queueManager->setHistoryRetention(hours, maxRecords);
+    cout << "History retention set to "
+        << (hours > 0 ? to_string(hours) + " hours" : string("no age limit")) << ", "
+        << (maxRecords > 0 ? to_string(maxRecords) + " records" : string("no record cap"))
+        << " (" << queueManager->getRetainedHistoryCount() << " records kept).\n";
+}
+
+const ServiceTypeRegistry& AdminConsole::getServiceTypes() {
+    return engine->getServiceTypes();
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "PriorityEngine.h"
 #include "QueueManager.h"
+#include <iostream>
 
 class AdminConsole {
 private:
@@ -10,6 +11,18 @@ private:
 public:
     AdminConsole(PriorityEngine* e, QueueManager* qm);
     void setWeights(float u, float w, float s);
-    void setServiceTypeScore(std::string type, float score);
+    bool setServiceTypeScore(std::string type, float score);
     void setFairnessParams(int maxWait, float boost);
+    void setScoringMode(ScoringMode mode);
+    void setHistoryRetention(int hours, int maxRecords);
+    const ServiceTypeRegistry& getServiceTypes();
+
+    template <class Policy>
+    void setScoringPolicy() {
+        queueManager->reconfigure([&]() { engine->usePolicy<Policy>(); }, JournalRecord::policy(Policy::NAME));
+        std::cout << "Scoring policy set to " << Policy::NAME << ".\n";
+        if (!Policy::SHARED_WAIT_SLOPE) {
+            std::cout << "Scores now rise at different rates, so priorities are recomputed on every tick.\n";
+        }
+    }
 };
\ No newline at end of file
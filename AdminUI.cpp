@@ -25,10 +25,11 @@ int AdminUI::getIntInput(int min, int max) {
 }
 
 void AdminUI::showServiceTypes() {
+    const ServiceTypeRegistry& types = console->getServiceTypes();
     std::cout << "\n=== Service Types ===\n";
-    std::cout << "1. Emergency\n";
-    std::cout << "2. Critical\n";
-    std::cout << "3. Checkup\n";
+    for (int i = 0; i < types.size(); i++) {
+        std::cout << i + 1 << ". " << types.nameOf(i) << "\n";
+    }
 }
 
 void AdminUI::showMainMenu() {
@@ -37,11 +38,14 @@ void AdminUI::showMainMenu() {
         std::cout << "1. Change Priority Weights\n";
         std::cout << "2. Manage Service Types\n";
         std::cout << "3. Set Fairness Rules\n";
-        std::cout << "4. Return to Main Menu\n";
-        std::cout << "Choice (1-4): ";
-
-        int choice = getIntInput(1, 4);
-        if (choice == 4) break;
+        std::cout << "4. Set Scoring Mode\n";
+        std::cout << "5. Set Scoring Policy\n";
+        std::cout << "6. Set History Retention\n";
+        std::cout << "7. Return to Main Menu\n";
+        std::cout << "Choice (1-7): ";
+
+        int choice = getIntInput(1, 7);
+        if (choice == 7) break;
         handleInput(choice);
 
     }
@@ -69,16 +73,27 @@ void AdminUI::showWeightsMenu() {
 }
 
 void AdminUI::showServiceTypeMenu() {
+    const ServiceTypeRegistry& types = console->getServiceTypes();
+    int count = types.size();
     showServiceTypes();
-    std::cout << "Select type to modify (1-3): ";
-    int typeChoice = getIntInput(1, 3);
-
-    std::string types[] = { "Emergency", "Critical", "Checkup" };
-    std::cout << "Enter new score for " << types[typeChoice - 1] << " (1-100): ";
+    std::cout << count + 1 << ". Add new service type\n";
+    std::cout << "Select type to modify (1-" << count + 1 << "): ";
+    int typeChoice = getIntInput(1, count + 1);
+
+    std::string type;
+    if (typeChoice == count + 1) {
+        std::cout << "Enter name of new service type: ";
+        std::cin >> type;
+    }
+    else {
+        type = types.nameOf(typeChoice - 1);
+    }
+    std::cout << "Enter new score for " << type << " (1-100): ";
     float score = getIntInput(1, 100);
 
-    console->setServiceTypeScore(types[typeChoice - 1], score);
-    std::cout << types[typeChoice - 1] << " score updated to " << score << "\n";
+    if (console->setServiceTypeScore(type, score)) {
+        std::cout << type << " score updated to " << score << "\n";
+    }
 }
 
 void AdminUI::handleInput(int choice) {
@@ -102,7 +117,46 @@ void AdminUI::handleInput(int choice) {
             << " mins, Boost: " << boost << ")\n";
         break;
     }
-    case 4:
+    case 4: {
+        std::cout << "\n=== Scoring Mode ===\n";
+        std::cout << "1. Recompute every patient on each tick\n";
+        std::cout << "2. Arrival-anchored keys (re-key only on fairness boost)\n";
+        std::cout << "Choice (1-2): ";
+        int mode = getIntInput(1, 2);
+        console->setScoringMode(mode == 1 ? ScoringMode::RECOMPUTE : ScoringMode::ARRIVAL_ANCHORED);
+        break;
+    }
+    case 5: {
+        std::cout << "\n=== Scoring Policy ===\n";
+        std::cout << "1. " << LinearPolicy::NAME << "\n";
+        std::cout << "2. " << LexicographicPolicy::NAME << "\n";
+        std::cout << "3. " << TieredSlaPolicy::NAME << "\n";
+        std::cout << "Choice (1-3): ";
+        int policy = getIntInput(1, 3);
+        if (policy == 1) {
+            console->setScoringPolicy<LinearPolicy>();
+        }
+        else if (policy == 2) {
+            console->setScoringPolicy<LexicographicPolicy>();
+        }
+        else {
+            console->setScoringPolicy<TieredSlaPolicy>();
+        }
+        break;
+    }
+    case 6: {
+        std::cout << "\n=== History Retention ===\n";
+        std::cout << "Older served records are folded into daily totals. By default nothing is folded.\n";
+        std::cout << "Keep detailed records for (0-8760 hours, 0 = no limit): ";
+        int hours = getIntInput(0, 8760);
+
+        std::cout << "Keep at most (0-10000000 records, 0 = no limit): ";
+        int maxRecords = getIntInput(0, 10000000);
+
+        console->setHistoryRetention(hours, maxRecords);
+        break;
+    }
+    case 7:
         return;
     }
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "Clock.h"
+
+Clock::~Clock() {
+}
+
+Clock* Clock::system() {
+    static SystemClock wallClock;
+    return &wallClock;
+}
+
+time_t SystemClock::now() const {
+    return time(0);
+}
+
+VirtualClock::VirtualClock(time_t start) {
+    this->current = static_cast<long long>(start);
+}
+
+time_t VirtualClock::now() const {
+    return static_cast<time_t>(current.load());
+}
+
+void VirtualClock::set(time_t time) {
+    current = static_cast<long long>(time);
+}
+
+void VirtualClock::advance(long long seconds) {
+    current += seconds;
+}
@@ -0,0 +1,35 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <atomic>
+#include <ctime>
+
+// Where QueueManager, ReportManager and the simulation read "now". The
+// system clock is the wall clock; a VirtualClock only moves when told to, so
+// a simulation can run far ahead of real time and repeat exactly.
+class Clock {
+public:
+    virtual ~Clock();
+    virtual time_t now() const = 0;
+
+    // The shared wall clock, which is every QueueManager's default.
+    static Clock* system();
+};
+
+class SystemClock : public Clock {
+public:
+    time_t now() const override;
+};
+
+class VirtualClock : public Clock {
+private:
+    std::atomic<long long> current;
+
+public:
+    VirtualClock(time_t start);
+    time_t now() const override;
+    void set(time_t time);
+    void advance(long long seconds);
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "EventQueue.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Below this the heap is cheap enough to pop as it is.
+const size_t FOLD_THRESHOLD = 1024;
+
+}
+
+ScheduledEvent ScheduledEvent::arrival(long long time, int patientId, int urgency, const std::string& serviceType) {
+    ScheduledEvent event;
+    event.time = time;
+    event.kind = SimEventKind::ARRIVAL;
+    event.patientId = patientId;
+    event.urgency = urgency;
+    event.serviceType = serviceType;
+    return event;
+}
+
+ScheduledEvent ScheduledEvent::serviceComplete(long long time, int counter, int patientId) {
+    ScheduledEvent event;
+    event.time = time;
+    event.kind = SimEventKind::SERVICE_COMPLETE;
+    event.patientId = patientId;
+    event.tag = counter;
+    return event;
+}
+
+ScheduledEvent ScheduledEvent::departure(long long time, int patientId) {
+    ScheduledEvent event;
+    event.time = time;
+    event.kind = SimEventKind::DEPARTURE;
+    event.patientId = patientId;
+    return event;
+}
+
+ScheduledEvent ScheduledEvent::timer(long long time, int timerId) {
+    ScheduledEvent event;
+    event.time = time;
+    event.kind = SimEventKind::TIMER;
+    event.tag = timerId;
+    return event;
+}
+
+EventQueue::EventQueue() {
+    this->nextSequence = 0;
+}
+
+// The heap algorithms keep the greatest element on top, so "greater" here
+// means due later.
+bool EventQueue::later(const Key& a, const Key& b) {
+    return a.time != b.time ? a.time > b.time : a.sequence > b.sequence;
+}
+
+void EventQueue::push(const ScheduledEvent& event) {
+    push(ScheduledEvent(event));
+}
+
+void EventQueue::push(ScheduledEvent&& event) {
+    event.sequence = nextSequence++;
+    size_t slot;
+    if (freeSlots.empty()) {
+        slot = slots.size();
+        slots.push_back(std::move(event));
+    }
+    else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        slots[slot] = std::move(event);
+    }
+    heap.push_back(Key{ slots[slot].time, slots[slot].sequence, slot });
+    std::push_heap(heap.begin(), heap.end(), later);
+}
+
+// Each fold takes in at least an eighth as many keys as are already sorted,
+// so merging costs O(1) per push overall.
+void EventQueue::fold() const {
+    if (heap.size() < FOLD_THRESHOLD || heap.size() < sorted.size() / 8) {
+        return;
+    }
+    size_t already = sorted.size();
+    std::sort(heap.begin(), heap.end(), later);
+    sorted.insert(sorted.end(), heap.begin(), heap.end());
+    heap.clear();
+    std::inplace_merge(sorted.begin(), sorted.begin() + already, sorted.end(), later);
+}
+
+bool EventQueue::sortedIsNext() const {
+    return heap.empty() || (!sorted.empty() && later(heap.front(), sorted.back()));
+}
+
+const ScheduledEvent& EventQueue::top() const {
+    fold();
+    return slots[sortedIsNext() ? sorted.back().slot : heap.front().slot];
+}
+
+void EventQueue::pop(ScheduledEvent& event) {
+    fold();
+    size_t slot;
+    if (sortedIsNext()) {
+        slot = sorted.back().slot;
+        sorted.pop_back();
+    }
+    else {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        slot = heap.back().slot;
+        heap.pop_back();
+    }
+    event = std::move(slots[slot]);
+    if (empty()) {
+        slots.clear();
+        freeSlots.clear();
+    }
+    else {
+        freeSlots.push_back(slot);
+    }
+}
+
+bool EventQueue::empty() const {
+    return heap.empty() && sorted.empty();
+}
+
+size_t EventQueue::size() const {
+    return heap.size() + sorted.size();
+}
+
+void EventQueue::clear() {
+    sorted.clear();
+    heap.clear();
+    slots.clear();
+    freeSlots.clear();
+    nextSequence = 0;
+}
+
+void EventQueue::reserve(size_t count) {
+    heap.reserve(count);
+    slots.reserve(count);
+}
@@ -0,0 +1,75 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include <string>
+#include <vector>
+
+enum class SimEventKind : unsigned char {
+    ARRIVAL,              // patientId, urgency, serviceType
+    SERVICE_COMPLETE,     // patientId, tag = counter
+    DEPARTURE,            // patientId leaves without being served if still waiting
+    TIMER                 // tag = timer ID
+};
+
+// Something due to happen at `time` seconds after a simulation starts.
+// sequence is assigned by EventQueue::push.
+struct ScheduledEvent {
+    long long time = 0;
+    unsigned long long sequence = 0;
+    SimEventKind kind = SimEventKind::ARRIVAL;
+    int patientId = -1;
+    int urgency = 0;
+    int tag = 0;
+    std::string serviceType;
+
+    static ScheduledEvent arrival(long long time, int patientId, int urgency, const std::string& serviceType);
+    static ScheduledEvent serviceComplete(long long time, int counter, int patientId);
+    static ScheduledEvent departure(long long time, int patientId);
+    static ScheduledEvent timer(long long time, int timerId);
+};
+
+// The future-event list of a simulation: a binary min-heap on time, with
+// events due at the same time coming out in the order they were pushed, so
+// a run is deterministic. push and pop are O(log n) amortized. Only small
+// keys are ordered; the events themselves stay put in a slab until popped.
+// Most of a scenario is scheduled before it runs, and popping a large heap
+// is slow from cache misses alone, so when the heap has grown large next to
+// the rest it is sorted and merged into a run that pops from the back; the
+// heap then holds only what was scheduled since.
+class EventQueue {
+private:
+    struct Key {
+        long long time;
+        unsigned long long sequence;
+        size_t slot;
+    };
+
+    // Latest first, so the earliest is at the back. Folding moves keys from
+    // heap to sorted without changing what the queue holds, so it may happen
+    // in top().
+    mutable std::vector<Key> sorted;
+    mutable std::vector<Key> heap;
+    std::vector<ScheduledEvent> slots;
+    std::vector<size_t> freeSlots;
+    unsigned long long nextSequence;
+
+    static bool later(const Key& a, const Key& b);
+    void fold() const;
+    bool sortedIsNext() const;
+
+public:
+    EventQueue();
+
+    void push(const ScheduledEvent& event);
+    void push(ScheduledEvent&& event);
+    // The earliest event; the queue must not be empty.
+    const ScheduledEvent& top() const;
+    void pop(ScheduledEvent& event);
+
+    bool empty() const;
+    size_t size() const;
+    void clear();
+    void reserve(size_t count);
+};
+
+#endif
@@ -0,0 +1,593 @@
+#include "EventReader.h"
+#include <climits>
+#include <cstring>
+
+namespace {
+    bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    // Sized comparison, which compiles to a few word compares rather than a
+    // strlen and memcmp call per field name.
+    template <size_t N>
+    bool nameIs(const char* text, size_t length, const char (&name)[N]) {
+        return length == N - 1 && std::memcmp(text, name, N - 1) == 0;
+    }
+
+    int hexValue(int c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    void appendUtf8(std::string& out, unsigned int code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+}
+
+EventReader::EventReader() {
+    this->file = nullptr;
+    this->pos = nullptr;
+    this->end = nullptr;
+    this->bufferOffset = 0;
+    this->state = State::DONE;
+    this->fatal = false;
+    this->skipped = 0;
+}
+
+EventReader::~EventReader() {
+    close();
+}
+
+bool EventReader::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    buffer.resize(BUFFER_SIZE);
+    pos = buffer.data();
+    end = pos;
+    bufferOffset = 0;
+    state = State::START;
+    fatal = false;
+    skipped = 0;
+    errors.clear();
+    return true;
+}
+
+void EventReader::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    state = State::DONE;
+}
+
+bool EventReader::refill() {
+    if (!file) {
+        return false;
+    }
+    bufferOffset += end - buffer.data();
+    size_t got = std::fread(buffer.data(), 1, buffer.size(), file);
+    pos = buffer.data();
+    end = pos + got;
+    return got > 0;
+}
+
+// The next byte without consuming it, or -1 at the end of the input.
+int EventReader::peek() {
+    if (pos == end && !refill()) {
+        return -1;
+    }
+    return static_cast<unsigned char>(*pos);
+}
+
+long long EventReader::offset() const {
+    return bufferOffset + (pos - buffer.data());
+}
+
+void EventReader::skipWhitespace() {
+    while (true) {
+        const char* p = pos;
+        while (p < end && isSpace(*p)) {
+            p++;
+        }
+        pos = p;
+        if (p < end || !refill()) {
+            return;
+        }
+    }
+}
+
+// A problem inside an event skips that event; anywhere else it stops the read.
+void EventReader::report(long long recordOffset, long long at, const std::string& message) {
+    if (recordOffset < 0) {
+        stop(recordOffset, at, message);
+        return;
+    }
+    skipped++;
+    if (errors.size() < MAX_KEPT_ERRORS) {
+        errors.push_back(EventReadError{ recordOffset, at, message });
+    }
+}
+
+void EventReader::stop(long long recordOffset, long long at, const std::string& message) {
+    fatal = true;
+    state = State::DONE;
+    errors.push_back(EventReadError{ recordOffset, at, message });
+}
+
+// Positions the reader just inside the event array.
+bool EventReader::findEventArray() {
+    skipWhitespace();
+    int c = peek();
+    if (c == '[') {
+        pos++;
+        return true;
+    }
+    if (c != '{') {
+        stop(-1, offset(), c < 0 ? "the input is empty" : "expected '{' or '['");
+        return false;
+    }
+    pos++;
+
+    while (true) {
+        skipWhitespace();
+        c = peek();
+        if (c != '"') {
+            stop(-1, offset(), c == '}' ? "no \"simulation_events\" array" :
+                c < 0 ? "input ends before the event array" : "expected a field name");
+            return false;
+        }
+        pos++;
+        if (!readString(key, -1)) {
+            return false;
+        }
+        skipWhitespace();
+        if (peek() != ':') {
+            stop(-1, offset(), "expected ':' after a field name");
+            return false;
+        }
+        pos++;
+        skipWhitespace();
+        if (nameIs(key.data(), key.size(), "simulation_events")) {
+            if (peek() != '[') {
+                stop(-1, offset(), "\"simulation_events\" is not an array");
+                return false;
+            }
+            pos++;
+            return true;
+        }
+        if (!skipValue(-1)) {
+            return false;
+        }
+        skipWhitespace();
+        c = peek();
+        if (c != ',') {
+            stop(-1, offset(), c == '}' ? "no \"simulation_events\" array" : "expected ',' or '}'");
+            return false;
+        }
+        pos++;
+    }
+}
+
+// Reads a string whose opening quote has been consumed, decoding escapes.
+// An invalid escape is reported once the whole string has been consumed.
+bool EventReader::readString(std::string& out, long long recordOffset) {
+    // Nearly every string has no escapes and ends inside the buffer.
+    const char* p = pos;
+    while (p < end && *p != '"' && *p != '\\') {
+        p++;
+    }
+    if (p < end && *p == '"') {
+        out.assign(pos, p);
+        pos = p + 1;
+        return true;
+    }
+
+    out.clear();
+    long long badEscape = -1;
+    unsigned int highSurrogate = 0;
+    while (true) {
+        const char* start = pos;
+        while (pos < end && *pos != '"' && *pos != '\\') {
+            pos++;
+        }
+        if (pos != start) {
+            out.append(start, pos);
+            highSurrogate = 0;
+        }
+        if (pos == end) {
+            if (!refill()) {
+                stop(recordOffset, offset(), "input ends inside a string");
+                return false;
+            }
+            continue;
+        }
+        if (*pos == '"') {
+            pos++;
+            break;
+        }
+
+        long long escapeAt = offset();
+        pos++;
+        int c = peek();
+        if (c < 0) {
+            stop(recordOffset, offset(), "input ends inside a string");
+            return false;
+        }
+        pos++;
+        switch (c) {
+        case '"': case '\\': case '/': out += static_cast<char>(c); break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            unsigned int code = 0;
+            int digits = 0;
+            for (; digits < 4; digits++) {
+                int digit = hexValue(peek());
+                if (digit < 0) {
+                    break;
+                }
+                pos++;
+                code = code * 16 + digit;
+            }
+            if (digits < 4) {
+                if (badEscape < 0) badEscape = escapeAt;
+                break;
+            }
+            if (code >= 0xD800 && code < 0xDC00) {
+                highSurrogate = code;
+                continue;
+            }
+            if (code >= 0xDC00 && code < 0xE000 && highSurrogate) {
+                code = 0x10000 + ((highSurrogate - 0xD800) << 10) + (code - 0xDC00);
+            }
+            appendUtf8(out, code);
+            break;
+        }
+        default:
+            if (badEscape < 0) badEscape = escapeAt;
+            break;
+        }
+        highSurrogate = 0;
+    }
+    if (badEscape >= 0) {
+        report(recordOffset, badEscape, "invalid escape in a string");
+        return false;
+    }
+    return true;
+}
+
+// Reads a field name whose opening quote has been consumed. A name with no
+// escapes that ends inside the buffer is matched where it lies, uncopied.
+bool EventReader::readFieldName(Field& field, long long recordOffset) {
+    const char* p = pos;
+    while (p < end && *p != '"' && *p != '\\') {
+        p++;
+    }
+    const char* name;
+    size_t length;
+    if (p < end && *p == '"') {
+        name = pos;
+        length = p - pos;
+        pos = p + 1;
+    }
+    else {
+        if (!readString(key, recordOffset)) {
+            return false;
+        }
+        name = key.data();
+        length = key.size();
+    }
+    field = nameIs(name, length, "timestamp") ? Field::TIMESTAMP :
+        nameIs(name, length, "patientId") ? Field::PATIENT_ID :
+        nameIs(name, length, "urgency") ? Field::URGENCY :
+        nameIs(name, length, "serviceType") ? Field::SERVICE_TYPE : Field::OTHER;
+    return true;
+}
+
+bool EventReader::readInt(int& value, long long recordOffset) {
+    long long at = offset();
+    int c = peek();
+    bool negative = c == '-';
+    if (negative) {
+        pos++;
+        c = peek();
+    }
+    if (c < '0' || c > '9') {
+        if (c < 0) {
+            stop(recordOffset, offset(), "input ends inside an event");
+        }
+        else {
+            report(recordOffset, at, "expected an integer");
+        }
+        return false;
+    }
+    long long magnitude = 0;
+    while (c >= '0' && c <= '9') {
+        if (magnitude <= INT_MAX) {
+            magnitude = magnitude * 10 + (c - '0');
+        }
+        pos++;
+        c = peek();
+    }
+    if (c == '.' || c == 'e' || c == 'E') {
+        report(recordOffset, at, "expected an integer");
+        return false;
+    }
+    if (magnitude > static_cast<long long>(INT_MAX) + (negative ? 1 : 0)) {
+        report(recordOffset, at, "integer out of range");
+        return false;
+    }
+    value = static_cast<int>(negative ? -magnitude : magnitude);
+    return true;
+}
+
+// Skips a value without checking it, stopping at the ',', '}' or ']' that
+// follows it.
+bool EventReader::skipValue(long long recordOffset) {
+    int depth = 0;
+    while (true) {
+        int c = peek();
+        if (c < 0) {
+            stop(recordOffset, offset(), "input ends inside a value");
+            return false;
+        }
+        if (depth == 0 && (c == ',' || c == '}' || c == ']')) {
+            return true;
+        }
+        pos++;
+        if (c == '"') {
+            if (!skipToStringEnd(recordOffset)) {
+                return false;
+            }
+        }
+        else if (c == '{' || c == '[') {
+            depth++;
+        }
+        else if (c == '}' || c == ']') {
+            depth--;
+        }
+    }
+}
+
+bool EventReader::skipToStringEnd(long long recordOffset) {
+    while (true) {
+        while (pos < end && *pos != '"' && *pos != '\\') {
+            pos++;
+        }
+        if (pos == end) {
+            if (!refill()) {
+                stop(recordOffset, offset(), "input ends inside a string");
+                return false;
+            }
+            continue;
+        }
+        if (*pos++ == '"') {
+            return true;
+        }
+        if (peek() < 0) {
+            stop(recordOffset, offset(), "input ends inside a string");
+            return false;
+        }
+        pos++;
+    }
+}
+
+// Resynchronises after a bad event by skipping past its closing brace.
+bool EventReader::skipToObjectEnd(long long recordOffset) {
+    int depth = 1;
+    while (true) {
+        int c = peek();
+        if (c < 0) {
+            stop(recordOffset, offset(), "input ends inside an event");
+            return false;
+        }
+        pos++;
+        if (c == '"') {
+            if (!skipToStringEnd(recordOffset)) {
+                return false;
+            }
+        }
+        else if (c == '{' || c == '[') {
+            depth++;
+        }
+        else if ((c == '}' || c == ']') && --depth == 0) {
+            return true;
+        }
+    }
+}
+
+// Reads an event whose opening brace has been consumed. On a malformed
+// event the rest of it is skipped and false is returned.
+bool EventReader::readEvent(SimulationEvent& event, long long recordOffset) {
+    bool hasTimestamp = false;
+    bool hasPatientId = false;
+    bool hasUrgency = false;
+    bool hasServiceType = false;
+    auto abandon = [&]() {
+        if (!fatal) {
+            skipToObjectEnd(recordOffset);
+        }
+        return false;
+    };
+    auto reject = [&](const char* message) {
+        if (peek() < 0) {
+            stop(recordOffset, offset(), "input ends inside an event");
+            return false;
+        }
+        report(recordOffset, offset(), message);
+        return abandon();
+    };
+
+    skipWhitespace();
+    if (peek() == '}') {
+        pos++;
+        report(recordOffset, recordOffset, "event has no fields");
+        return false;
+    }
+    while (true) {
+        skipWhitespace();
+        if (peek() != '"') {
+            return reject("expected a field name");
+        }
+        pos++;
+        Field field;
+        if (!readFieldName(field, recordOffset)) {
+            return abandon();
+        }
+        skipWhitespace();
+        if (peek() != ':') {
+            return reject("expected ':' after a field name");
+        }
+        pos++;
+        skipWhitespace();
+
+        if (field == Field::TIMESTAMP) {
+            if (!readInt(event.timestamp, recordOffset)) return abandon();
+            hasTimestamp = true;
+        }
+        else if (field == Field::PATIENT_ID) {
+            if (!readInt(event.patientId, recordOffset)) return abandon();
+            hasPatientId = true;
+        }
+        else if (field == Field::URGENCY) {
+            if (!readInt(event.urgency, recordOffset)) return abandon();
+            hasUrgency = true;
+        }
+        else if (field == Field::SERVICE_TYPE) {
+            if (peek() != '"') {
+                return reject("\"serviceType\" is not a string");
+            }
+            pos++;
+            if (!readString(event.serviceType, recordOffset)) return abandon();
+            hasServiceType = true;
+        }
+        else if (!skipValue(recordOffset)) {
+            return false;
+        }
+
+        skipWhitespace();
+        int c = peek();
+        if (c == ',') {
+            pos++;
+            continue;
+        }
+        if (c == '}') {
+            pos++;
+            break;
+        }
+        return reject("expected ',' or '}'");
+    }
+
+    const char* missing = !hasTimestamp ? "event has no \"timestamp\"" :
+        !hasPatientId ? "event has no \"patientId\"" :
+        !hasUrgency ? "event has no \"urgency\"" :
+        !hasServiceType ? "event has no \"serviceType\"" : nullptr;
+    if (missing) {
+        report(recordOffset, recordOffset, missing);
+        return false;
+    }
+    return true;
+}
+
+bool EventReader::next(SimulationEvent& event) {
+    while (true) {
+        switch (state) {
+        case State::START:
+            if (!findEventArray()) {
+                return false;
+            }
+            state = State::FIRST_ELEMENT;
+            break;
+
+        case State::FIRST_ELEMENT:
+        case State::ELEMENT: {
+            skipWhitespace();
+            long long at = offset();
+            int c = peek();
+            if (c == ']' && state == State::FIRST_ELEMENT) {
+                pos++;
+                state = State::DONE;
+                return false;
+            }
+            if (c < 0) {
+                stop(-1, at, "input ends inside the event array");
+                return false;
+            }
+            state = State::SEPARATOR;
+            if (c == '{') {
+                pos++;
+                if (readEvent(event, at)) {
+                    return true;
+                }
+                if (fatal) {
+                    return false;
+                }
+            }
+            else {
+                report(at, at, "expected an event object");
+                if (!skipValue(at)) {
+                    return false;
+                }
+            }
+            break;
+        }
+
+        case State::SEPARATOR: {
+            skipWhitespace();
+            int c = peek();
+            if (c == ',') {
+                pos++;
+                state = State::ELEMENT;
+                break;
+            }
+            if (c == ']') {
+                pos++;
+                state = State::DONE;
+                return false;
+            }
+            stop(-1, offset(), c < 0 ? "input ends inside the event array" : "expected ',' or ']' after an event");
+            return false;
+        }
+
+        case State::DONE:
+            return false;
+        }
+    }
+}
+
+bool EventReader::failed() const {
+    return fatal;
+}
+
+long long EventReader::skippedCount() const {
+    return skipped;
+}
+
+const std::vector<EventReadError>& EventReader::getErrors() const {
+    return errors;
+}
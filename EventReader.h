@@ -0,0 +1,107 @@
+#ifndef EVENTREADER_H
+#define EVENTREADER_H
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct SimulationEvent {
+    int timestamp = 0;
+    int patientId = -1;
+    int urgency = 0;
+    std::string serviceType = "";
+
+    SimulationEvent() = default;
+
+    SimulationEvent(int ts, int pid, int urg, const std::string& st)
+        : timestamp(ts), patientId(pid), urgency(urg), serviceType(st) {
+    }
+};
+
+// A problem found while reading. recordOffset is the byte offset of the
+// event it belongs to, or -1 if it is outside any event; offset is where
+// the problem itself was found.
+struct EventReadError {
+    long long recordOffset;
+    long long offset;
+    std::string message;
+};
+
+// Reads simulation events from a JSON file one at a time through a fixed
+// buffer, so the whole file is never held in memory. The input may be
+// {"simulation_events": [...]} or a bare array of events, laid out any way
+// JSON allows, minified or not. Each event needs integer "timestamp",
+// "patientId" and "urgency" fields and a string "serviceType"; other keys
+// are skipped. A malformed event is reported and skipped. Anything wrong
+// outside an event, or input that ends inside one, stops the read.
+class EventReader {
+public:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    // Errors beyond this many are counted but not kept.
+    static const size_t MAX_KEPT_ERRORS = 100;
+
+private:
+    enum class State {
+        START,
+        FIRST_ELEMENT,
+        ELEMENT,
+        SEPARATOR,
+        DONE
+    };
+
+    enum class Field {
+        TIMESTAMP,
+        PATIENT_ID,
+        URGENCY,
+        SERVICE_TYPE,
+        OTHER
+    };
+
+    std::FILE* file;
+    std::vector<char> buffer;
+    const char* pos;
+    const char* end;
+    long long bufferOffset;
+    State state;
+    bool fatal;
+    long long skipped;
+    std::vector<EventReadError> errors;
+    std::string key;
+
+    bool refill();
+    int peek();
+    long long offset() const;
+    void skipWhitespace();
+    void report(long long recordOffset, long long at, const std::string& message);
+    void stop(long long recordOffset, long long at, const std::string& message);
+
+    bool findEventArray();
+    bool readString(std::string& out, long long recordOffset);
+    bool readFieldName(Field& field, long long recordOffset);
+    bool readInt(int& value, long long recordOffset);
+    bool skipValue(long long recordOffset);
+    bool skipToStringEnd(long long recordOffset);
+    bool skipToObjectEnd(long long recordOffset);
+    bool readEvent(SimulationEvent& event, long long recordOffset);
+
+public:
+    EventReader();
+    ~EventReader();
+    EventReader(const EventReader&) = delete;
+    EventReader& operator=(const EventReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // The next well-formed event, skipping malformed ones. Returns false
+    // at the end of the event array or when the read stops on an error.
+    bool next(SimulationEvent& event);
+
+    // True if the read stopped before the end of the event array.
+    bool failed() const;
+    long long skippedCount() const;
+    const std::vector<EventReadError>& getErrors() const;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "FileIO.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+int FileIO::openForAppend(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+int FileIO::createForWrite(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+bool FileIO::writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        unsigned int chunk = size > (1u << 30) ? (1u << 30) : static_cast<unsigned int>(size);
+        int written = _write(fd, data, chunk);
+        if (written <= 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool FileIO::syncFile(int fd) { return _commit(fd) == 0; }
+bool FileIO::truncateFile(int fd, long long size) { return _chsize_s(fd, size) == 0; }
+void FileIO::closeFile(int fd) { _close(fd); }
+
+bool FileIO::replaceFile(const std::string& from, const std::string& to) {
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+#else
+int FileIO::openForAppend(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+}
+
+int FileIO::createForWrite(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+bool FileIO::writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written <= 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool FileIO::syncFile(int fd) { return ::fsync(fd) == 0; }
+bool FileIO::truncateFile(int fd, long long size) { return ::ftruncate(fd, size) == 0; }
+void FileIO::closeFile(int fd) { ::close(fd); }
+
+bool FileIO::replaceFile(const std::string& from, const std::string& to) {
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+#endif
+
+namespace {
+    struct CrcTable {
+        unsigned int entries[256];
+
+        CrcTable() {
+            for (unsigned int i = 0; i < 256; i++) {
+                unsigned int c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    };
+}
+
+unsigned int FileIO::crc32(const char* data, size_t size) {
+    static const CrcTable table;
+    unsigned int c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        c = table.entries[(c ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+MappedFile::MappedFile() {
+    this->bytes = nullptr;
+    this->length = 0;
+#ifdef _WIN32
+    this->fileHandle = INVALID_HANDLE_VALUE;
+    this->mappingHandle = nullptr;
+#else
+    this->fd = -1;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+// An empty file opens with size() == 0 and no mapping.
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        return true;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+    bytes = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        return true;
+    }
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    bytes = (mapped == MAP_FAILED) ? nullptr : static_cast<const char*>(mapped);
+    if (bytes) {
+        madvise(mapped, length, MADV_SEQUENTIAL);
+    }
+#endif
+    if (!bytes) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+#else
+    if (bytes) munmap(const_cast<char*>(bytes), length);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+const char* MappedFile::data() const {
+    return bytes;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,47 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <string>
+#include <cstddef>
+
+// Thin wrappers over the POSIX and Windows file calls that the journal and
+// snapshots need: unbuffered appends, fsync, and atomic replacement.
+namespace FileIO {
+    int openForAppend(const std::string& path);
+    int createForWrite(const std::string& path);
+    bool writeAll(int fd, const char* data, size_t size);
+    bool syncFile(int fd);
+    bool truncateFile(int fd, long long size);
+    void closeFile(int fd);
+    // Renames from over to, replacing it; neither may be open.
+    bool replaceFile(const std::string& from, const std::string& to);
+
+    unsigned int crc32(const char* data, size_t size);
+}
+
+// A whole file mapped read-only. The mapping lives until close() or
+// destruction, so pointers into data() must not outlive the object.
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    const char* data() const;
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,672 @@
+#include "Journal.h"
+#include "FileIO.h"
+#include "Logger.h"
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+    const char MAGIC[4] = { 'H', 'Q', 'J', '1' };
+    // Version 2 adds the logical offset of the first record, which lets the
+    // part of the journal covered by a snapshot be dropped. Version 3 stores
+    // an admission's urgency as an int; it was one byte, which wrapped any
+    // urgency outside 0-255, and the time of a retention change. It also adds
+    // SCORE_OVERRIDE and TICK.
+    const unsigned int FORMAT_VERSION = 3;
+    const size_t V1_HEADER_BYTES = sizeof(MAGIC) + sizeof(unsigned int);
+    const size_t HEADER_BYTES = V1_HEADER_BYTES + sizeof(unsigned long long);
+    const size_t MAX_NAME_BYTES = 255;
+
+    // Fields are written in host byte order; every supported target is
+    // little-endian.
+    template <class T>
+    void put(std::vector<char>& out, T value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    void putName(std::vector<char>& out, const std::string& name) {
+        size_t size = name.size() < MAX_NAME_BYTES ? name.size() : MAX_NAME_BYTES;
+        put<unsigned char>(out, static_cast<unsigned char>(size));
+        out.insert(out.end(), name.begin(), name.begin() + size);
+    }
+
+    struct Reader {
+        const char* at;
+        const char* end;
+
+        template <class T>
+        bool get(T& value) {
+            if (static_cast<size_t>(end - at) < sizeof(T)) return false;
+            std::memcpy(&value, at, sizeof(T));
+            at += sizeof(T);
+            return true;
+        }
+
+        bool getName(std::string& name) {
+            unsigned char size;
+            if (!get(size) || static_cast<size_t>(end - at) < size) return false;
+            name.assign(at, size);
+            at += size;
+            return true;
+        }
+    };
+
+    void encode(const JournalRecord& record, std::vector<char>& out) {
+        size_t start = out.size();
+        put<unsigned short>(out, 0);
+        put<unsigned char>(out, static_cast<unsigned char>(record.op));
+
+        switch (record.op) {
+        case JournalOp::ADMIT:
+            put<int>(out, record.patientId);
+            put<int>(out, record.urgency);
+            put<unsigned char>(out, static_cast<unsigned char>(record.typeId));
+            put<unsigned char>(out, record.countsVisit ? 1 : 0);
+            put<long long>(out, static_cast<long long>(record.time));
+            putName(out, record.name);
+            break;
+        case JournalOp::SERVE:
+            put<int>(out, record.patientId);
+            put<long long>(out, static_cast<long long>(record.time));
+            put<float>(out, record.score);
+            break;
+        case JournalOp::REMOVE:
+        case JournalOp::VISIT:
+            put<int>(out, record.patientId);
+            break;
+        case JournalOp::REDIRECT:
+            put<unsigned char>(out, static_cast<unsigned char>(record.typeId));
+            put<unsigned char>(out, static_cast<unsigned char>(record.toTypeId));
+            break;
+        case JournalOp::WEIGHTS:
+            put<float>(out, record.weights[0]);
+            put<float>(out, record.weights[1]);
+            put<float>(out, record.weights[2]);
+            break;
+        case JournalOp::SERVICE_TYPE:
+            put<float>(out, record.score);
+            putName(out, record.name);
+            break;
+        case JournalOp::FAIRNESS:
+            put<int>(out, record.limit);
+            put<float>(out, record.score);
+            break;
+        case JournalOp::SCORING_MODE:
+            put<unsigned char>(out, static_cast<unsigned char>(record.limit));
+            break;
+        case JournalOp::POLICY:
+            putName(out, record.name);
+            break;
+        case JournalOp::RETENTION:
+            put<int>(out, record.limit);
+            put<int>(out, record.maxRecords);
+            put<long long>(out, static_cast<long long>(record.time));
+            break;
+        case JournalOp::SCORE_OVERRIDE:
+            put<int>(out, record.patientId);
+            put<long long>(out, static_cast<long long>(record.time));
+            put<float>(out, record.score);
+            break;
+        case JournalOp::TICK:
+            put<long long>(out, static_cast<long long>(record.time));
+            break;
+        }
+
+        unsigned short length = static_cast<unsigned short>(out.size() - start - sizeof(unsigned short));
+        std::memcpy(&out[start], &length, sizeof(length));
+        put<unsigned int>(out, FileIO::crc32(&out[start + sizeof(unsigned short)], length));
+    }
+
+    bool decode(Reader in, JournalRecord& record, unsigned int version) {
+        unsigned char op;
+        if (!in.get(op)) return false;
+        record = JournalRecord();
+        record.op = static_cast<JournalOp>(op);
+
+        unsigned char small = 0;
+        long long time = 0;
+        bool ok = false;
+        switch (record.op) {
+        case JournalOp::ADMIT:
+            if (version >= 3) {
+                ok = in.get(record.patientId) && in.get(record.urgency);
+            }
+            else {
+                ok = in.get(record.patientId) && in.get(small);
+                record.urgency = small;
+            }
+            ok = ok && in.get(small);
+            record.typeId = small;
+            ok = ok && in.get(small);
+            record.countsVisit = small != 0;
+            ok = ok && in.get(time) && in.getName(record.name);
+            break;
+        case JournalOp::SERVE:
+            ok = in.get(record.patientId) && in.get(time) && in.get(record.score);
+            break;
+        case JournalOp::REMOVE:
+        case JournalOp::VISIT:
+            ok = in.get(record.patientId);
+            break;
+        case JournalOp::REDIRECT:
+            ok = in.get(small);
+            record.typeId = small;
+            ok = ok && in.get(small);
+            record.toTypeId = small;
+            break;
+        case JournalOp::WEIGHTS:
+            ok = in.get(record.weights[0]) && in.get(record.weights[1]) && in.get(record.weights[2]);
+            break;
+        case JournalOp::SERVICE_TYPE:
+            ok = in.get(record.score) && in.getName(record.name);
+            break;
+        case JournalOp::FAIRNESS:
+            ok = in.get(record.limit) && in.get(record.score);
+            break;
+        case JournalOp::SCORING_MODE:
+            ok = in.get(small);
+            record.limit = small;
+            break;
+        case JournalOp::POLICY:
+            ok = in.getName(record.name);
+            break;
+        case JournalOp::RETENTION:
+            ok = in.get(record.limit) && in.get(record.maxRecords) && (version < 3 || in.get(time));
+            break;
+        case JournalOp::SCORE_OVERRIDE:
+            ok = version >= 3 && in.get(record.patientId) && in.get(time) && in.get(record.score);
+            break;
+        case JournalOp::TICK:
+            ok = version >= 3 && in.get(time);
+            break;
+        }
+        record.time = static_cast<time_t>(time);
+        return ok;
+    }
+
+    // Where the records of one journal file begin, in the file and in the
+    // journal as a whole.
+    struct Layout {
+        unsigned int version;
+        size_t headerBytes;
+        unsigned long long startOffset;
+    };
+
+    std::vector<char> header(unsigned long long startOffset) {
+        std::vector<char> bytes(MAGIC, MAGIC + sizeof(MAGIC));
+        put<unsigned int>(bytes, FORMAT_VERSION);
+        put<unsigned long long>(bytes, startOffset);
+        return bytes;
+    }
+
+    // Applies every intact record at or past logical offset `from` and
+    // returns how many bytes of the file the intact records cover: 0 for a
+    // missing or empty file, -1 if it is not a journal.
+    long long scan(const std::string& path, unsigned long long from,
+        const std::function<void(const JournalRecord&)>& apply, Layout& layout, long long& records) {
+        records = 0;
+        layout.version = FORMAT_VERSION;
+        layout.headerBytes = HEADER_BYTES;
+        layout.startOffset = 0;
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return 0;
+        std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (bytes.empty()) return 0;
+
+        Reader in = { bytes.data(), bytes.data() + bytes.size() };
+        char magic[sizeof(MAGIC)];
+        unsigned int& version = layout.version;
+        if (!in.get(magic) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !in.get(version)) return -1;
+        if (version == 1) {
+            layout.headerBytes = V1_HEADER_BYTES;
+        }
+        else if (version > FORMAT_VERSION || version == 0 || !in.get(layout.startOffset)) {
+            return -1;
+        }
+
+        size_t at = layout.headerBytes;
+        while (bytes.size() - at >= sizeof(unsigned short)) {
+            unsigned short length;
+            std::memcpy(&length, &bytes[at], sizeof(length));
+            size_t body = at + sizeof(length);
+            if (length == 0 || bytes.size() - body < length + sizeof(unsigned int)) break;
+            unsigned int crc;
+            std::memcpy(&crc, &bytes[body + length], sizeof(crc));
+            if (crc != FileIO::crc32(&bytes[body], length)) break;
+
+            JournalRecord record;
+            if (!decode(Reader{ &bytes[body], &bytes[body] + length }, record, version)) break;
+            if (layout.startOffset + (at - layout.headerBytes) >= from) {
+                apply(record);
+                records++;
+            }
+            at = body + length + sizeof(crc);
+        }
+        return static_cast<long long>(at);
+    }
+
+    // Rewrites a journal of an earlier version in the current one, keeping
+    // the records from logical offset `from` on. Records change size, so the
+    // offsets of all but the first move; `from` itself, which a snapshot may
+    // name, stays where it was.
+    bool upgrade(const std::string& path, unsigned long long from) {
+        Layout layout;
+        long long records;
+        std::vector<char> body;
+        if (scan(path, from, [&](const JournalRecord& record) { encode(record, body); }, layout, records) < 0) {
+            return false;
+        }
+        std::vector<char> bytes = header(from > layout.startOffset ? from : layout.startOffset);
+        bytes.insert(bytes.end(), body.begin(), body.end());
+
+        std::string temporary = path + ".tmp";
+        int out = FileIO::createForWrite(temporary);
+        if (out < 0) {
+            return false;
+        }
+        bool written = FileIO::writeAll(out, bytes.data(), bytes.size()) && FileIO::syncFile(out);
+        FileIO::closeFile(out);
+        if (!written || !FileIO::replaceFile(temporary, path)) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+}
+
+JournalRecord JournalRecord::admit(int patientId, int urgency, ServiceTypeId typeId, const std::string& serviceType,
+    time_t arrivalTime, bool countsVisit) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::ADMIT;
+    record.patientId = patientId;
+    record.urgency = urgency;
+    record.typeId = typeId;
+    record.name = serviceType;
+    record.time = arrivalTime;
+    record.countsVisit = countsVisit;
+    return record;
+}
+
+JournalRecord JournalRecord::serve(int patientId, time_t serviceTime, float finalScore) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::SERVE;
+    record.patientId = patientId;
+    record.time = serviceTime;
+    record.score = finalScore;
+    return record;
+}
+
+JournalRecord JournalRecord::remove(int patientId) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::REMOVE;
+    record.patientId = patientId;
+    return record;
+}
+
+JournalRecord JournalRecord::visit(int patientId) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::VISIT;
+    record.patientId = patientId;
+    return record;
+}
+
+JournalRecord JournalRecord::redirect(ServiceTypeId from, ServiceTypeId to) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::REDIRECT;
+    record.typeId = from;
+    record.toTypeId = to;
+    return record;
+}
+
+JournalRecord JournalRecord::weightChange(float urgency, float waitTime, float serviceType) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::WEIGHTS;
+    record.weights[0] = urgency;
+    record.weights[1] = waitTime;
+    record.weights[2] = serviceType;
+    return record;
+}
+
+JournalRecord JournalRecord::serviceTypeScore(const std::string& serviceType, float score) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::SERVICE_TYPE;
+    record.name = serviceType;
+    record.score = score;
+    return record;
+}
+
+JournalRecord JournalRecord::fairness(int maxWaitMinutes, float boost) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::FAIRNESS;
+    record.limit = maxWaitMinutes;
+    record.score = boost;
+    return record;
+}
+
+JournalRecord JournalRecord::scoringMode(int mode) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::SCORING_MODE;
+    record.limit = mode;
+    return record;
+}
+
+JournalRecord JournalRecord::policy(const std::string& policyName) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::POLICY;
+    record.name = policyName;
+    return record;
+}
+
+JournalRecord JournalRecord::retention(int hours, int maxRecords, time_t appliedAt) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::RETENTION;
+    record.limit = hours;
+    record.maxRecords = maxRecords;
+    record.time = appliedAt;
+    return record;
+}
+
+JournalRecord JournalRecord::scoreOverride(int patientId, float score, time_t scoredAt) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::SCORE_OVERRIDE;
+    record.patientId = patientId;
+    record.score = score;
+    record.time = scoredAt;
+    return record;
+}
+
+JournalRecord JournalRecord::tick(time_t currentTime) {
+    JournalRecord record = JournalRecord();
+    record.op = JournalOp::TICK;
+    record.time = currentTime;
+    return record;
+}
+
+Journal::Journal() {
+    this->fd = -1;
+    this->appendedCount = 0;
+    this->durableCount = 0;
+    this->syncRequested = false;
+    this->stopping = false;
+    this->commitIntervalMs = DEFAULT_COMMIT_INTERVAL_MS;
+    this->flushing = false;
+    this->failed = false;
+    this->headerBytes = 0;
+    this->startOffset = 0;
+    this->endOffset = 0;
+}
+
+Journal::~Journal() {
+    close();
+}
+
+// Cuts off a torn tail left by a crash, then appends after the last intact
+// record. A new or empty file, or one that ends before logical offset
+// `startAt` (a snapshot already covers more than it holds), is started
+// afresh at that offset. A file of an earlier format version is first
+// rewritten in the current one from `startAt` on, so that new records are
+// never appended in a different format from the ones before them.
+bool Journal::open(const std::string& path, unsigned long long startAt) {
+    close();
+    Layout layout;
+    long long records;
+    long long intact = scan(path, 0, [](const JournalRecord&) {}, layout, records);
+    if (intact > static_cast<long long>(layout.headerBytes) && layout.version < FORMAT_VERSION &&
+        layout.startOffset + (intact - layout.headerBytes) >= startAt) {
+        if (!upgrade(path, startAt)) {
+            return false;
+        }
+        intact = scan(path, 0, [](const JournalRecord&) {}, layout, records);
+    }
+    if (intact < 0) {
+        return false;
+    }
+
+    fd = FileIO::openForAppend(path);
+    if (fd < 0) {
+        return false;
+    }
+    if (intact < static_cast<long long>(layout.headerBytes) ||
+        layout.startOffset + (intact - layout.headerBytes) < startAt) {
+        std::vector<char> bytes = header(startAt);
+        if (!FileIO::truncateFile(fd, 0) || !FileIO::writeAll(fd, bytes.data(), bytes.size())) {
+            FileIO::closeFile(fd);
+            fd = -1;
+            return false;
+        }
+        intact = static_cast<long long>(bytes.size());
+        layout.headerBytes = bytes.size();
+        layout.startOffset = startAt;
+    }
+    else if (!FileIO::truncateFile(fd, intact)) {
+        FileIO::closeFile(fd);
+        fd = -1;
+        return false;
+    }
+    if (!FileIO::syncFile(fd)) {
+        FileIO::closeFile(fd);
+        fd = -1;
+        return false;
+    }
+
+    this->path = path;
+    headerBytes = layout.headerBytes;
+    startOffset = layout.startOffset;
+    endOffset = startOffset + (intact - headerBytes);
+    stopping = false;
+    failed = false;
+    flusher = std::thread(&Journal::flushLoop, this);
+    return true;
+}
+
+// The flusher is joined even when the descriptor is already gone, which is
+// how discardBefore leaves the journal if it cannot reopen the file.
+void Journal::close() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        flusher.join();
+    }
+    if (fd >= 0) {
+        FileIO::closeFile(fd);
+        fd = -1;
+    }
+}
+
+bool Journal::isOpen() const {
+    return fd >= 0;
+}
+
+void Journal::setCommitInterval(int milliseconds) {
+    std::lock_guard<std::mutex> guard(lock);
+    commitIntervalMs = milliseconds > 0 ? milliseconds : 1;
+}
+
+// Returns false once a write or fsync has failed: the record is dropped,
+// since nothing appended after a failed commit could be replayed anyway.
+bool Journal::append(const JournalRecord& record) {
+    bool eager;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (failed) {
+            return false;
+        }
+        size_t before = pending.size();
+        encode(record, pending);
+        endOffset += pending.size() - before;
+        appendedCount++;
+        eager = pending.size() >= EAGER_FLUSH_BYTES;
+    }
+    if (eager) {
+        wake.notify_one();
+    }
+    return true;
+}
+
+// Returns whether everything appended so far reached the disk. With no
+// journal open there is nothing to lose, so that counts as success.
+bool Journal::sync() {
+    std::unique_lock<std::mutex> guard(lock);
+    if (fd < 0) {
+        return !failed;
+    }
+    unsigned long long target = appendedCount;
+    syncRequested = true;
+    wake.notify_one();
+    committed.wait(guard, [&]() { return durableCount >= target || stopping || failed; });
+    return durableCount >= target;
+}
+
+
+void Journal::flushLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (!stopping) {
+        wake.wait_for(guard, std::chrono::milliseconds(commitIntervalMs), [&]() {
+            return stopping || syncRequested || pending.size() >= EAGER_FLUSH_BYTES;
+        });
+        writePending(guard);
+    }
+    writePending(guard);
+}
+
+// One write and one fsync for everything appended since the last commit.
+// Appenders keep filling the other buffer while this one is on its way out.
+// A failed write or fsync leaves the file in an unknown state, so the
+// journal stops there: durableCount stays put and everything after is
+// dropped, and sync() and append() report the failure from then on.
+void Journal::writePending(std::unique_lock<std::mutex>& guard) {
+    syncRequested = false;
+    if (failed) {
+        pending.clear();
+    }
+    if (pending.empty()) {
+        committed.notify_all();
+        return;
+    }
+    writing.swap(pending);
+    unsigned long long upTo = appendedCount;
+    flushing = true;
+    guard.unlock();
+
+    bool written = FileIO::writeAll(fd, writing.data(), writing.size()) && FileIO::syncFile(fd);
+    writing.clear();
+    if (!written) {
+        HQ_LOG(CRITICAL, LogEvent::JOURNAL_FAILED);
+    }
+
+    guard.lock();
+    flushing = false;
+    if (written) {
+        durableCount = upTo;
+    }
+    else {
+        failed = true;
+        pending.clear();
+    }
+    committed.notify_all();
+}
+
+// The logical offset just past the last record appended so far. Offsets
+// count record bytes from the start of the journal's life, so they stay
+// valid across discardBefore.
+unsigned long long Journal::position() {
+    std::lock_guard<std::mutex> guard(lock);
+    return endOffset;
+}
+
+// Rewrites the file without the records before logical offset `offset`,
+// which a snapshot now covers. Appends block while the retained tail is
+// copied; records still waiting for the flusher go to the new file.
+bool Journal::discardBefore(unsigned long long offset) {
+    std::unique_lock<std::mutex> guard(lock);
+    if (fd < 0) {
+        return false;
+    }
+    committed.wait(guard, [&]() { return !flushing; });
+    unsigned long long durableEnd = endOffset - pending.size();
+    if (offset <= startOffset || offset > durableEnd) {
+        return offset <= startOffset;
+    }
+
+    std::vector<char> bytes = header(offset);
+    {
+        std::ifstream file(path, std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(headerBytes + (offset - startOffset)));
+        size_t tail = static_cast<size_t>(durableEnd - offset);
+        bytes.resize(bytes.size() + tail);
+        if (!file.read(bytes.data() + bytes.size() - tail, tail)) {
+            return false;
+        }
+    }
+
+    std::string temporary = path + ".tmp";
+    int out = FileIO::createForWrite(temporary);
+    if (out < 0) {
+        return false;
+    }
+    bool written = FileIO::writeAll(out, bytes.data(), bytes.size()) && FileIO::syncFile(out);
+    FileIO::closeFile(out);
+
+    if (!written) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    // The file cannot be replaced while it is open on Windows, so the live
+    // descriptor goes first. Whichever file is at path afterwards, the new
+    // one or the untouched old one, is reopened; if that fails the journal
+    // has failed like a failed write, and the flusher drops what comes next.
+    FileIO::closeFile(fd);
+    bool replaced = FileIO::replaceFile(temporary, path);
+    if (replaced) {
+        headerBytes = HEADER_BYTES;
+        startOffset = offset;
+    }
+    else {
+        std::remove(temporary.c_str());
+    }
+    fd = FileIO::openForAppend(path);
+    if (fd < 0) {
+        failed = true;
+        pending.clear();
+        committed.notify_all();
+        HQ_LOG(CRITICAL, LogEvent::JOURNAL_FAILED);
+        return false;
+    }
+    return replaced;
+}
+
+// Applies the intact records at or past logical offset `from` and returns
+// how many there were, or -1 if the file is not a journal or its first
+// record lies past `from`, in which case records are missing.
+long long Journal::replay(const std::string& path, unsigned long long from,
+    const std::function<void(const JournalRecord&)>& apply) {
+    Layout layout;
+    long long records;
+    long long intact = scan(path, from, apply, layout, records);
+    if (intact < 0 || (intact > 0 && layout.startOffset > from)) {
+        return -1;
+    }
+    return records;
+}
+
+void Journal::encodeRecord(const JournalRecord& record, std::vector<char>& out) {
+    encode(record, out);
+}
+
+size_t Journal::decodeRecord(const char* data, size_t size, JournalRecord& record) {
+    unsigned short length;
+    if (size < sizeof(length)) return 0;
+    std::memcpy(&length, data, sizeof(length));
+    const char* body = data + sizeof(length);
+    if (length == 0 || size - sizeof(length) < length + sizeof(unsigned int)) return 0;
+    unsigned int crc;
+    std::memcpy(&crc, body + length, sizeof(crc));
+    if (crc != FileIO::crc32(body, length) || !decode(Reader{ body, body + length }, record, FORMAT_VERSION)) return 0;
+    return sizeof(length) + length + sizeof(crc);
+}
\ No newline at end of file
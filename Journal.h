@@ -0,0 +1,132 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "ServiceTypeRegistry.h"
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <ctime>
+
+enum class JournalOp : unsigned char {
+    ADMIT = 1,
+    SERVE,
+    REMOVE,
+    VISIT,
+    REDIRECT,
+    WEIGHTS,
+    SERVICE_TYPE,
+    FAIRNESS,
+    SCORING_MODE,
+    POLICY,
+    RETENTION,
+    SCORE_OVERRIDE,
+    TICK
+};
+
+// One state change. Each op uses only some of the fields; the factory
+// functions show which.
+struct JournalRecord {
+    JournalOp op;
+    bool countsVisit;
+    int patientId;
+    int urgency;
+    ServiceTypeId typeId;
+    ServiceTypeId toTypeId;
+    int limit;
+    int maxRecords;
+    time_t time;
+    float score;
+    float weights[3];
+    std::string name;
+
+    static JournalRecord admit(int patientId, int urgency, ServiceTypeId typeId, const std::string& serviceType,
+        time_t arrivalTime, bool countsVisit);
+    static JournalRecord serve(int patientId, time_t serviceTime, float finalScore);
+    static JournalRecord remove(int patientId);
+    static JournalRecord visit(int patientId);
+    static JournalRecord redirect(ServiceTypeId from, ServiceTypeId to);
+    static JournalRecord weightChange(float urgency, float waitTime, float serviceType);
+    static JournalRecord serviceTypeScore(const std::string& serviceType, float score);
+    static JournalRecord fairness(int maxWaitMinutes, float boost);
+    static JournalRecord scoringMode(int mode);
+    static JournalRecord policy(const std::string& policyName);
+    // appliedAt is the time history was compacted to the new limits.
+    static JournalRecord retention(int hours, int maxRecords, time_t appliedAt);
+    // A waiting patient's score set by hand, as it stood at `scoredAt`.
+    static JournalRecord scoreOverride(int patientId, float score, time_t scoredAt);
+    // An updatePriorities call.
+    static JournalRecord tick(time_t currentTime);
+};
+
+// Append-only binary log of QueueManager state changes.
+//
+// append() only encodes the record into an in-memory batch; a background
+// thread writes the batch and fsyncs it every commitIntervalMs, or sooner
+// once it grows large (group commit). Changes acknowledged in the last
+// interval can therefore be lost on a crash; sync() waits until everything
+// appended so far is on disk. A failed write or fsync is sticky: nothing is
+// acknowledged as durable past it, and append() and sync() return false.
+//
+// Each record is framed as [length][op][payload][crc32], so a torn write at
+// the tail is detected on replay and cut off when the file is reopened.
+// Records are addressed by logical byte offset, which keeps counting when
+// discardBefore drops the prefix a snapshot has made redundant.
+// Thread-safe; the journal lock is a leaf lock.
+class Journal {
+public:
+    static const int DEFAULT_COMMIT_INTERVAL_MS = 5;
+
+private:
+    static const size_t EAGER_FLUSH_BYTES = 64 * 1024;
+
+    int fd;
+    std::string path;
+    size_t headerBytes;
+    unsigned long long startOffset;
+    unsigned long long endOffset;
+    std::thread flusher;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable committed;
+    std::vector<char> pending;
+    std::vector<char> writing;
+    unsigned long long appendedCount;
+    unsigned long long durableCount;
+    bool syncRequested;
+    bool flushing;
+    bool stopping;
+    bool failed;
+    int commitIntervalMs;
+
+    void flushLoop();
+    void writePending(std::unique_lock<std::mutex>& guard);
+
+public:
+    Journal();
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    bool open(const std::string& path, unsigned long long startAt = 0);
+    void close();
+    bool isOpen() const;
+    bool append(const JournalRecord& record);
+    bool sync();
+    void setCommitInterval(int milliseconds);
+    unsigned long long position();
+    bool discardBefore(unsigned long long offset);
+
+    static long long replay(const std::string& path, unsigned long long from,
+        const std::function<void(const JournalRecord&)>& apply);
+
+    // The framed, checksummed form a record takes in a journal file, for
+    // carrying records in other files. decodeRecord returns the number of
+    // bytes the record took, or 0 if data does not start with an intact one.
+    static void encodeRecord(const JournalRecord& record, std::vector<char>& out);
+    static size_t decodeRecord(const char* data, size_t size, JournalRecord& record);
+};
+
+#endif
\ No newline at end of file
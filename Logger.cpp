@@ -0,0 +1,298 @@
+#include "Logger.h"
+#include "Clock.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    void copyName(char* to, const std::string& from) {
+        size_t length = std::min(from.size(), static_cast<size_t>(LogRecord::NAME_SIZE - 1));
+        std::memcpy(to, from.data(), length);
+        to[length] = '\0';
+    }
+
+    std::string lowered(const char* name) {
+        std::string text = name;
+        std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+        return text;
+    }
+}
+
+void writeLogRecord(std::ostream& text, const LogRecord& record) {
+    switch (record.event) {
+    case LogEvent::PATIENT_ADDED:
+        text << "Patient " << record.patientId << " added to " << record.name
+            << " queue (Score: " << record.score << ")";
+        break;
+    case LogEvent::PATIENT_UPDATED:
+        text << "Updated existing Patient " << record.patientId << " in " << record.name
+            << " queue (New Score: " << record.score << ")";
+        break;
+    case LogEvent::BATCH_ADDED:
+        text << "Added " << record.value << " patients";
+        if (record.patientId > 0) {
+            text << " (" << record.patientId << " updates to patients already waiting)";
+        }
+        break;
+    case LogEvent::PATIENT_SERVED:
+        text << "Serving from " << record.name << " queue: Patient " << record.patientId;
+        break;
+    case LogEvent::BATCH_SERVED:
+        text << "Served " << record.value << " patients";
+        break;
+    case LogEvent::COUNTER_SERVING:
+        text << record.name << " serving Patient " << record.patientId << " from " << record.otherName << " queue";
+        break;
+    case LogEvent::LANE_REDIRECTED:
+        text << record.name << " queue is now empty. Redirecting individuals from "
+            << lowered(record.otherName) << " queue to " << lowered(record.name) << " service counter.";
+        break;
+    case LogEvent::EMERGENCY_SERVED:
+        text << "Emergency! Serving Patient " << record.patientId << " immediately.";
+        break;
+    case LogEvent::PATIENT_NOT_FOUND:
+        text << "Patient " << record.patientId << " not found in any queue.";
+        break;
+    case LogEvent::PATIENT_REMOVED:
+        text << "Patient " << record.patientId << " removed from queue without service.";
+        break;
+    case LogEvent::SIMULATION_TIME:
+        text << "\n? Time: " << record.value << " minutes";
+        break;
+    case LogEvent::SIMULATION_ARRIVAL:
+        text << "?? New Patient Arrival:\n   ID: " << record.patientId << " | Urgency: " << record.value
+            << " | Type: " << record.name;
+        break;
+    case LogEvent::QUEUE_SIZE:
+        text << "   " << record.name << " queue: " << record.value << " waiting";
+        break;
+    case LogEvent::RECORDS_DROPPED:
+        text << "(" << record.value << " log records dropped)";
+        break;
+    case LogEvent::JOURNAL_FAILED:
+        text << "Journal write failed; changes from now on are not durable.";
+        break;
+    }
+}
+
+std::string formatLogRecord(const LogRecord& record) {
+    std::ostringstream text;
+    writeLogRecord(text, record);
+    return text.str();
+}
+
+LogSink::~LogSink() {
+}
+
+void LogSink::flush() {
+}
+
+StreamLogSink::StreamLogSink(std::ostream& out) : out(out) {
+}
+
+void StreamLogSink::write(const LogRecord& record) {
+    writeLogRecord(pending, record);
+    pending << '\n';
+}
+
+// A terminal stream writes each line separately, so lines are collected and
+// handed over once per drain pass.
+void StreamLogSink::flush() {
+    out << pending.str();
+    out.flush();
+    pending.str(std::string());
+}
+
+Logger::Logger() {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    this->enqueuePos = 0;
+    this->dequeuePos = 0;
+    this->dropped = 0;
+    this->reportedDrops = 0;
+    this->level = static_cast<int>(LogLevel::INFO);
+    this->clock = Clock::system();
+    this->sleeping = false;
+    this->sink = std::make_shared<StreamLogSink>(std::cout);
+    this->stopping = false;
+    this->drainer = std::thread(&Logger::drainLoop, this);
+}
+
+// Whatever was logged before exit is written out before the thread stops.
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> guard(drainLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    drainer.join();
+}
+
+Logger& Logger::get() {
+    static Logger instance;
+    return instance;
+}
+
+void Logger::setLevel(LogLevel level) {
+    this->level = static_cast<int>(level);
+}
+
+LogLevel Logger::getLevel() const {
+    return static_cast<LogLevel>(level.load(std::memory_order_relaxed));
+}
+
+bool Logger::isEnabled(LogLevel level) const {
+    return static_cast<int>(level) >= this->level.load(std::memory_order_relaxed) && level != LogLevel::OFF;
+}
+
+void Logger::setSink(std::shared_ptr<LogSink> sink) {
+    std::lock_guard<std::mutex> guard(sinkLock);
+    this->sink = sink;
+}
+
+void Logger::setClock(Clock* clock) {
+    this->clock.store(clock ? clock : Clock::system(), std::memory_order_release);
+}
+
+Clock* Logger::getClock() const {
+    return clock.load(std::memory_order_acquire);
+}
+
+void Logger::log(LogLevel level, LogEvent event, int patientId, int value, float score,
+    const std::string& name, const std::string& otherName) {
+    LogRecord record;
+    record.time = static_cast<long long>(getClock()->now());
+    record.patientId = patientId;
+    record.value = value;
+    record.score = score;
+    record.level = level;
+    record.event = event;
+    copyName(record.name, name);
+    copyName(record.otherName, otherName);
+    if (!tryPush(record)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (sleeping.load(std::memory_order_seq_cst)) {
+        wakeDrainer();
+    }
+}
+
+// Bounded multi-producer queue: each slot's sequence says whether it is free
+// for the producer at position pos (sequence == pos) or holds a record for
+// the consumer (sequence == pos + 1).
+bool Logger::tryPush(const LogRecord& record) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = slots[pos % CAPACITY];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        long long diff = static_cast<long long>(sequence) - static_cast<long long>(pos);
+        if (diff == 0) {
+            // Sequentially consistent so that it and the drainer's check
+            // of `sleeping` cannot both miss each other (see drainLoop).
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst,
+                std::memory_order_relaxed)) {
+                slot.record = record;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Writes every published record to the sink. Returns false if there was
+// nothing to write.
+bool Logger::drainOnce() {
+    std::lock_guard<std::mutex> guard(sinkLock);
+    bool wrote = false;
+    long long lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reportedDrops) {
+        LogRecord notice = LogRecord();
+        notice.time = static_cast<long long>(getClock()->now());
+        notice.level = LogLevel::WARNING;
+        notice.event = LogEvent::RECORDS_DROPPED;
+        notice.value = static_cast<int>(lost - reportedDrops);
+        reportedDrops = lost;
+        if (sink) sink->write(notice);
+        wrote = true;
+    }
+
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = slots[pos % CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+        if (sink) sink->write(slot.record);
+        slot.sequence.store(pos + CAPACITY, std::memory_order_release);
+        pos++;
+        dequeuePos.store(pos, std::memory_order_release);
+        wrote = true;
+    }
+    if (wrote && sink) {
+        sink->flush();
+    }
+    return wrote;
+}
+
+// Before sleeping the drainer announces it in `sleeping` and then looks at
+// enqueuePos once more. A producer claims its slot before it reads
+// `sleeping`, and both sides are sequentially consistent, so either the
+// drainer sees the claim and keeps going, or the producer sees it asleep and
+// wakes it. A slot claimed but not yet filled is waited out with a yield.
+void Logger::drainLoop() {
+    std::unique_lock<std::mutex> guard(drainLock);
+    while (true) {
+        guard.unlock();
+        bool wrote = drainOnce();
+        guard.lock();
+        drained.notify_all();
+        if (wrote) {
+            continue;
+        }
+        if (stopping) {
+            return;
+        }
+        sleeping.store(true, std::memory_order_seq_cst);
+        if (enqueuePos.load(std::memory_order_seq_cst) != dequeuePos.load(std::memory_order_relaxed) ||
+            dropped.load(std::memory_order_relaxed) != reportedDrops) {
+            sleeping.store(false, std::memory_order_relaxed);
+            guard.unlock();
+            std::this_thread::yield();
+            guard.lock();
+            continue;
+        }
+        wake.wait(guard, [this]() { return !sleeping.load(std::memory_order_relaxed) || stopping; });
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::wakeDrainer() {
+    {
+        std::lock_guard<std::mutex> guard(drainLock);
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+void Logger::flush() {
+    size_t target = enqueuePos.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> guard(drainLock);
+    sleeping.store(false, std::memory_order_relaxed);
+    wake.notify_one();
+    drained.wait(guard, [&]() { return dequeuePos.load(std::memory_order_acquire) >= target || stopping; });
+}
+
+long long Logger::droppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
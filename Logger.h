@@ -0,0 +1,169 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+class Clock;
+
+// Compile-time floor for HQ_LOG. Calls below it are removed entirely, along
+// with the evaluation of their arguments; build with
+// HQ_LOG_MIN_LEVEL=HQ_LOG_LEVEL_OFF to strip logging from the queue code.
+#define HQ_LOG_LEVEL_VERBOSE 0
+#define HQ_LOG_LEVEL_INFO 1
+#define HQ_LOG_LEVEL_WARNING 2
+#define HQ_LOG_LEVEL_CRITICAL 3
+#define HQ_LOG_LEVEL_OFF 4
+
+#ifndef HQ_LOG_MIN_LEVEL
+#define HQ_LOG_MIN_LEVEL HQ_LOG_LEVEL_VERBOSE
+#endif
+
+// HQ_LOG(INFO, LogEvent::PATIENT_ADDED, patientId, value, score, name, otherName)
+// Trailing fields may be left off. The record is copied into the ring and
+// formatted later on the logger's own thread.
+#define HQ_LOG(level, ...) \
+    do { \
+        if (HQ_LOG_LEVEL_##level >= HQ_LOG_MIN_LEVEL && Logger::get().isEnabled(LogLevel::level)) { \
+            Logger::get().log(LogLevel::level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+enum class LogLevel : unsigned char {
+    VERBOSE = HQ_LOG_LEVEL_VERBOSE,
+    INFO = HQ_LOG_LEVEL_INFO,
+    WARNING = HQ_LOG_LEVEL_WARNING,
+    CRITICAL = HQ_LOG_LEVEL_CRITICAL,
+    OFF = HQ_LOG_LEVEL_OFF
+};
+
+// What happened. Each event documents which LogRecord fields it fills.
+enum class LogEvent : unsigned char {
+    PATIENT_ADDED,        // patientId, score, name = service type
+    PATIENT_UPDATED,      // patientId, score, name = service type
+    BATCH_ADDED,          // value = admitted, patientId = updates to waiting patients
+    PATIENT_SERVED,       // patientId, name = service type
+    BATCH_SERVED,         // value = patients served
+    COUNTER_SERVING,      // patientId, name = counter, otherName = service type
+    LANE_REDIRECTED,      // name = emptied type, otherName = type moved into it
+    EMERGENCY_SERVED,     // patientId
+    PATIENT_NOT_FOUND,    // patientId
+    PATIENT_REMOVED,      // patientId
+    SIMULATION_TIME,      // value = minutes since start
+    SIMULATION_ARRIVAL,   // patientId, value = urgency, name = service type
+    QUEUE_SIZE,           // value = waiting, name = service type
+    RECORDS_DROPPED,      // value = records lost to a full ring
+    JOURNAL_FAILED        // no fields
+};
+
+// One log entry. Fixed size so the hot path only copies bytes; names
+// longer than NAME_SIZE - 1 are cut short.
+struct LogRecord {
+    static const int NAME_SIZE = 32;
+
+    long long time;
+    int patientId;
+    int value;
+    float score;
+    LogLevel level;
+    LogEvent event;
+    char name[NAME_SIZE];
+    char otherName[NAME_SIZE];
+};
+
+// The message text for a record, without a trailing newline.
+void writeLogRecord(std::ostream& out, const LogRecord& record);
+std::string formatLogRecord(const LogRecord& record);
+
+// Receives records on the logger thread, in the order they were logged.
+class LogSink {
+public:
+    virtual ~LogSink();
+    virtual void write(const LogRecord& record) = 0;
+    virtual void flush();
+};
+
+// Writes one message line per record to a stream, std::cout by default.
+class StreamLogSink : public LogSink {
+private:
+    std::ostream& out;
+    std::ostringstream pending;
+
+public:
+    StreamLogSink(std::ostream& out);
+    void write(const LogRecord& record) override;
+    void flush() override;
+};
+
+// Process-wide logger. log() claims a slot in a bounded ring with one
+// compare-and-swap and never blocks or allocates; if the ring is full the
+// record is dropped and counted. A background thread drains the ring into
+// the sink and sleeps while it is empty; a producer takes the drain lock to
+// wake it only when it is asleep, so logging to a busy logger stays
+// lock-free.
+class Logger {
+public:
+    static const size_t CAPACITY = 4096;
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    Slot slots[CAPACITY];
+    std::atomic<size_t> enqueuePos;
+    std::atomic<size_t> dequeuePos;
+    std::atomic<long long> dropped;
+    long long reportedDrops;
+    std::atomic<int> level;
+    std::atomic<Clock*> clock;
+
+    std::shared_ptr<LogSink> sink;
+    std::mutex sinkLock;
+    std::mutex drainLock;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::atomic<bool> sleeping;
+    bool stopping;
+    std::thread drainer;
+
+    Logger();
+    bool tryPush(const LogRecord& record);
+    bool drainOnce();
+    void drainLoop();
+    void wakeDrainer();
+
+public:
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& get();
+
+    void setLevel(LogLevel level);
+    LogLevel getLevel() const;
+    bool isEnabled(LogLevel level) const;
+    // Replaces the sink; nullptr discards records.
+    void setSink(std::shared_ptr<LogSink> sink);
+    // Where record times come from; nullptr is the wall clock. A simulation
+    // installs its virtual clock here so log times agree with the queue's,
+    // and puts the wall clock back before that clock goes away.
+    void setClock(Clock* clock);
+    Clock* getClock() const;
+
+    void log(LogLevel level, LogEvent event, int patientId = 0, int value = 0, float score = 0.0f,
+        const std::string& name = std::string(), const std::string& otherName = std::string());
+    // Blocks until everything logged before the call has reached the sink.
+    void flush();
+    long long droppedCount() const;
+};
+
+#endif
@@ -1,68 +1,80 @@
 #include "Patient.h"
+#include "PatientPool.h"
 #include <ctime>
 
-Patient::Patient(int id, int urgency, string serviceType) {
-    this->id = id;
-    this->urgency = urgency;
-    this->serviceType = serviceType;
-    this->arrivalTime = time(0);
-    this->serviceTime = 0;
-    this->priorityScore = 0.0f;
+Patient::Patient() {
+    this->slab = nullptr;
+    this->slot = 0;
 }
 
-Patient::Patient(const Patient& other) {
-    this->id = other.id;
-    this->urgency = other.urgency;
-    this->serviceType = other.serviceType;
-    this->arrivalTime = other.arrivalTime;
-    this->serviceTime = other.serviceTime;
-    this->priorityScore = other.priorityScore;
+Patient::Patient(PatientSlab* slab, unsigned int slot) {
+    this->slab = slab;
+    this->slot = slot;
 }
 
 int Patient::getId() {
-    return id;
+    return slab->id[slot];
 }
 
 int Patient::getUrgency() {
-    return urgency;
+    return slab->urgency[slot];
 }
 
-string Patient::getServiceType() {
-    return serviceType;
+const string& Patient::getServiceType() {
+    return slab->serviceType[slot];
+}
+
+int Patient::getServiceTypeId() {
+    return slab->serviceTypeId[slot];
 }
 
 time_t Patient::getArrivalTime() {
-    return arrivalTime;
+    return slab->arrivalTime[slot];
 }
 
 time_t Patient::getServiceTime() {
-    return serviceTime;
+    return slab->serviceTime[slot];
 }
 
 float Patient::getPriorityScore() {
-    return priorityScore;
+    return slab->priorityScore[slot];
+}
+
+float Patient::getStaticScore() {
+    return slab->staticScore[slot];
+}
+
+float Patient::getWaitRate() {
+    return slab->waitRate[slot];
 }
 
 void Patient::setPriorityScore(float score) {
-    priorityScore = score;
+    slab->priorityScore[slot] = score;
+}
+
+// Cached by PriorityEngine::cacheScoreParts while the patient waits.
+void Patient::setScoreParts(float staticScore, float waitRate) {
+    slab->staticScore[slot] = staticScore;
+    slab->waitRate[slot] = waitRate;
 }
 
 void Patient::setArrivalTime(time_t time) {
-    arrivalTime = time;
+    slab->arrivalTime[slot] = time;
 }
 
 void Patient::setServiceTime(time_t time) {
-    serviceTime = time;
+    slab->serviceTime[slot] = time;
 }
 
 void Patient::updateWaitTime(time_t currentTime) {
 }
 
 int Patient::getWaitTimeMinutes(time_t currentTime) {
-    return (currentTime - arrivalTime) / 60;
+    return (currentTime - getArrivalTime()) / 60;
 }
 
 int Patient::getTotalWaitTimeMinutes() {
+    time_t serviceTime = getServiceTime();
     if (serviceTime == 0) return 0;
-    return (serviceTime - arrivalTime) / 60;
+    return (serviceTime - getArrivalTime()) / 60;
 }
\ No newline at end of file
@@ -5,27 +5,32 @@
 #include <ctime>
 using namespace std;
 
+struct PatientSlab;
+
+// A view of one record in a PatientPool slab. The fields themselves live in
+// the slab's per-field columns, so heap and scoring loops can scan scores
+// without touching the rest of the record.
 class Patient {
 private:
-    int id;
-    int urgency;
-    string serviceType;
-    time_t arrivalTime;
-    time_t serviceTime;  
-    float priorityScore;
+    PatientSlab* slab;
+    unsigned int slot;
 
 public:
-    Patient(int id, int urgency, string serviceType);
-    Patient(const Patient& other);
+    Patient();
+    Patient(PatientSlab* slab, unsigned int slot);
 
     int getId();
     int getUrgency();
-    string getServiceType();
+    const string& getServiceType();
+    int getServiceTypeId();
     time_t getArrivalTime();
     time_t getServiceTime();
     float getPriorityScore();
+    float getStaticScore();
+    float getWaitRate();
 
     void setPriorityScore(float score);
+    void setScoreParts(float staticScore, float waitRate);
     void setArrivalTime(time_t time);
     void setServiceTime(time_t time);
     void updateWaitTime(time_t currentTime);
@@ -0,0 +1,70 @@
+#include "PatientPool.h"
+#include <stdexcept>
+
+PatientSlab::PatientSlab() {
+    for (unsigned int i = 0; i < SIZE; i++) {
+        views[i] = Patient(this, i);
+    }
+}
+
+PatientPool::PatientPool() {
+    this->constructed = 0;
+    // The slab table never reallocates, so get() can read it without locking.
+    slabs.reserve(MAX_SLABS);
+}
+
+PatientPool::~PatientPool() {
+    for (auto slab : slabs) {
+        delete slab;
+    }
+}
+
+void PatientPool::initSlot(PatientHandle handle, int id, int urgency, const std::string& serviceType, int serviceTypeId) {
+    PatientSlab* slab = slabs[handle / PatientSlab::SIZE];
+    unsigned int slot = handle % PatientSlab::SIZE;
+    slab->priorityScore[slot] = 0.0f;
+    slab->heapIndex[slot] = -1;
+    slab->staticScore[slot] = 0.0f;
+    slab->waitRate[slot] = 0.0f;
+    slab->id[slot] = id;
+    slab->urgency[slot] = urgency;
+    slab->serviceTypeId[slot] = serviceTypeId;
+    // The queue stamps arrivals from its own clock.
+    slab->arrivalTime[slot] = 0;
+    slab->serviceTime[slot] = 0;
+    slab->serviceType[slot] = serviceType;
+}
+
+PatientHandle PatientPool::allocate(int id, int urgency, const std::string& serviceType, int serviceTypeId) {
+    std::lock_guard<std::mutex> guard(lock);
+    PatientHandle handle;
+    if (!freeSlots.empty()) {
+        handle = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        if (constructed == slabs.size() * PatientSlab::SIZE) {
+            if (slabs.size() == MAX_SLABS) {
+                throw std::length_error("PatientPool is full");
+            }
+            slabs.push_back(new PatientSlab());
+        }
+        handle = constructed++;
+    }
+    initSlot(handle, id, urgency, serviceType, serviceTypeId);
+    return handle;
+}
+
+void PatientPool::release(PatientHandle handle) {
+    std::lock_guard<std::mutex> guard(lock);
+    freeSlots.push_back(handle);
+}
+
+Patient* PatientPool::get(PatientHandle handle) const {
+    return &slabs[handle / PatientSlab::SIZE]->views[handle % PatientSlab::SIZE];
+}
+
+int PatientPool::liveCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return static_cast<int>(constructed - freeSlots.size());
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef PATIENTPOOL_H
+#define PATIENTPOOL_H
+
+#include "Patient.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <ctime>
+
+typedef unsigned int PatientHandle;
+
+// One slab of patient records stored column by column. Heap comparisons and
+// re-scoring only read priorityScore, heapIndex and the cached score parts,
+// which stay packed together instead of being spread across whole records.
+struct PatientSlab {
+    static const unsigned int SIZE = 4096;
+
+    float priorityScore[SIZE];
+    int heapIndex[SIZE];
+    float staticScore[SIZE];
+    float waitRate[SIZE];
+    int id[SIZE];
+    int urgency[SIZE];
+    int serviceTypeId[SIZE];
+    time_t arrivalTime[SIZE];
+    time_t serviceTime[SIZE];
+    std::string serviceType[SIZE];
+    Patient views[SIZE];
+
+    PatientSlab();
+};
+
+// Slab allocator for Patient records. A handle keeps the same slot (and the
+// same Patient view address) until it is released; released slots are reused
+// before a new slab is carved, and every slab is freed at once when the pool
+// goes away.
+class PatientPool {
+private:
+    static const unsigned int MAX_SLABS = 65536;
+
+    std::vector<PatientSlab*> slabs;
+    std::vector<PatientHandle> freeSlots;
+    unsigned int constructed;
+    std::mutex lock;
+
+    void initSlot(PatientHandle handle, int id, int urgency, const std::string& serviceType, int serviceTypeId);
+
+public:
+    PatientPool();
+    ~PatientPool();
+    PatientPool(const PatientPool&) = delete;
+    PatientPool& operator=(const PatientPool&) = delete;
+
+    PatientHandle allocate(int id, int urgency, const std::string& serviceType, int serviceTypeId);
+    void release(PatientHandle handle);
+    Patient* get(PatientHandle handle) const;
+    int liveCount();
+
+    // Column access for the heap code; the caller owns the handle.
+    float& priorityScore(PatientHandle handle) const {
+        return slabs[handle / PatientSlab::SIZE]->priorityScore[handle % PatientSlab::SIZE];
+    }
+    int& heapIndex(PatientHandle handle) const {
+        return slabs[handle / PatientSlab::SIZE]->heapIndex[handle % PatientSlab::SIZE];
+    }
+    float staticScore(PatientHandle handle) const {
+        return slabs[handle / PatientSlab::SIZE]->staticScore[handle % PatientSlab::SIZE];
+    }
+    float waitRate(PatientHandle handle) const {
+        return slabs[handle / PatientSlab::SIZE]->waitRate[handle % PatientSlab::SIZE];
+    }
+    time_t arrivalTime(PatientHandle handle) const {
+        return slabs[handle / PatientSlab::SIZE]->arrivalTime[handle % PatientSlab::SIZE];
+    }
+};
+
+#endif
\ No newline at end of file
@@ -1,14 +1,148 @@
 #include "PriorityEngine.h"
 #include "QueueManager.h"
+#include <algorithm>
 
-PriorityEngine::PriorityEngine() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PRIORITY_ENGINE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts any intrinsic; GCC and Clang need the ISA enabled per function.
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+void ScoreBatch::resize(int count) {
+    staticScore.resize(count);
+    waitRate.resize(count);
+    waitSeconds.resize(count);
+    scores.resize(count);
+}
+
+int ScoreBatch::size() const {
+    return static_cast<int>(staticScore.size());
+}
+
+namespace {
+
+// scoreFromCache followed by the QueueManager fairness boost. The vector
+// kernels reproduce it bit for bit.
+void scoreScalar(ScoreBatch& batch, int begin, int end, const BatchParams& p) {
+    for (int i = begin; i < end; i++) {
+        int wait = batch.waitSeconds[i];
+        float score = batch.staticScore[i] + wait * batch.waitRate[i];
+
+        int waitMinutes = wait / 60;
+        if (waitMinutes > p.maxWaitMinutes) {
+            score += static_cast<float>(waitMinutes - p.maxWaitMinutes) * p.boostMultiplier;
+        }
+        batch.scores[i] = score;
+    }
+}
+
+#ifdef PRIORITY_ENGINE_X86
+// Minutes are taken as trunc(wait / 60.0f), which equals the integer
+// division for any wait below 2^24 seconds (about 194 days).
+TARGET_SSE2
+void scoreSse2(ScoreBatch& batch, int begin, int end, const BatchParams& p) {
+    const __m128 boost = _mm_set1_ps(p.boostMultiplier);
+    const __m128i maxWait = _mm_set1_epi32(p.maxWaitMinutes);
+    const __m128 sixty = _mm_set1_ps(60.0f);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 wait = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.waitSeconds[i])));
+        __m128 score = _mm_add_ps(_mm_loadu_ps(&batch.staticScore[i]),
+            _mm_mul_ps(wait, _mm_loadu_ps(&batch.waitRate[i])));
+
+        __m128i waitMinutes = _mm_cvttps_epi32(_mm_div_ps(wait, sixty));
+        __m128 overdue = _mm_castsi128_ps(_mm_cmpgt_epi32(waitMinutes, maxWait));
+        __m128 extra = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(waitMinutes, maxWait)), boost);
+        score = _mm_add_ps(score, _mm_and_ps(overdue, extra));
+
+        _mm_storeu_ps(&batch.scores[i], score);
+    }
+    scoreScalar(batch, i, end, p);
+}
+
+TARGET_AVX2
+void scoreAvx2(ScoreBatch& batch, int begin, int end, const BatchParams& p) {
+    const __m256 boost = _mm256_set1_ps(p.boostMultiplier);
+    const __m256i maxWait = _mm256_set1_epi32(p.maxWaitMinutes);
+    const __m256 sixty = _mm256_set1_ps(60.0f);
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 wait = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.waitSeconds[i])));
+        __m256 score = _mm256_add_ps(_mm256_loadu_ps(&batch.staticScore[i]),
+            _mm256_mul_ps(wait, _mm256_loadu_ps(&batch.waitRate[i])));
+
+        __m256i waitMinutes = _mm256_cvttps_epi32(_mm256_div_ps(wait, sixty));
+        __m256 overdue = _mm256_castsi256_ps(_mm256_cmpgt_epi32(waitMinutes, maxWait));
+        __m256 extra = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(waitMinutes, maxWait)), boost);
+        score = _mm256_add_ps(score, _mm256_and_ps(overdue, extra));
+
+        _mm256_storeu_ps(&batch.scores[i], score);
+    }
+    scoreScalar(batch, i, end, p);
+}
+
+bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) {
+        return false;
+    }
+    __cpuid(regs, 1);
+    bool osSavesYmm = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0 &&
+        (_xgetbv(0) & 6) == 6;
+    if (!osSavesYmm) {
+        return false;
+    }
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+BatchKernel bestKernel() {
+#ifdef PRIORITY_ENGINE_X86
+    static const BatchKernel best = cpuSupportsAvx2() ? BatchKernel::AVX2 : BatchKernel::SSE2;
+    return best;
+#else
+    return BatchKernel::SCALAR;
+#endif
+}
+
+}
+
+PriorityEngine::PriorityEngine() : PriorityEngine(ThreadPool::defaultWorkerCount()) {
+}
+
+PriorityEngine::PriorityEngine(int batchWorkers) : workers(batchWorkers) {
     urgencyWeight = 0.5f;
     waitTimeWeight = 0.3f;
     serviceTypeWeight = 0.2f;
 
-    serviceTypeScores["Emergency"] = 10.0f;
-    serviceTypeScores["Critical"] = 8.0f;
-    serviceTypeScores["Checkup"] = 5.0f;
+    for (int i = 0; i < ServiceTypeRegistry::MAX_TYPES; i++) {
+        serviceTypeScores[i] = 0.0f;
+    }
+    serviceTypeScores[ServiceTypeRegistry::EMERGENCY] = 10.0f;
+    serviceTypeScores[ServiceTypeRegistry::CRITICAL] = 8.0f;
+    serviceTypeScores[ServiceTypeRegistry::CHECKUP] = 5.0f;
+
+    usePolicy<LinearPolicy>();
+    batchKernel = BatchKernel::AUTO;
 }
 
 void PriorityEngine::setWeights(float urgency, float waitTime, float serviceType) {
@@ -17,28 +151,150 @@ void PriorityEngine::setWeights(float urgency, float waitTime, float serviceType
     serviceTypeWeight = serviceType;
 }
 
-void PriorityEngine::setServiceTypeScore(string type, float score) {
-    serviceTypeScores[type] = score;
+float PriorityEngine::getWaitTimeWeight() const {
+    return waitTimeWeight;
+}
+
+// Scoring a type that is not registered yet registers it, which also gives
+// it its own lane in QueueManager; its score is in place before anyone can
+// route a patient to it. Fails only when the registry is full.
+bool PriorityEngine::setServiceTypeScore(string type, float score) {
+    ServiceTypeId id = serviceTypes.registerType(type, [&](ServiceTypeId added) { serviceTypeScores[added] = score; });
+    if (id < 0) {
+        return false;
+    }
+    serviceTypeScores[id] = score;
+    return true;
+}
+
+ServiceTypeRegistry& PriorityEngine::getServiceTypes() {
+    return serviceTypes;
+}
+
+float PriorityEngine::getServiceTypeScore(ServiceTypeId id) const {
+    return (id >= 0 && id < ServiceTypeRegistry::MAX_TYPES) ? serviceTypeScores[id] : 0.0f;
+}
+
+ScoreInputs PriorityEngine::inputsFor(Patient& patient, const QueueManager* queueManager) const {
+    return inputsFor(patient, queueManager ? queueManager->getVisitCount(patient.getId()) : 0);
+}
+
+ScoreInputs PriorityEngine::inputsFor(Patient& patient, int visits) const {
+    int typeId = patient.getServiceTypeId();
+    ScoreInputs in;
+    in.urgency = patient.getUrgency();
+    in.serviceScore = (typeId >= 0) ? serviceTypeScores[typeId] : 0.0f;
+    in.visits = visits;
+    return in;
 }
 
 float PriorityEngine::calculatePriorityScore(Patient& patient, time_t currentTime, const QueueManager* queueManager) {
-    time_t waitTime = currentTime - patient.getArrivalTime();
-    float serviceScore = serviceTypeScores[patient.getServiceType()];
-
-    float visitBonus = 0.0f;
-    if (queueManager) {
-        int visits = queueManager->getVisitCount(patient.getId());
-        if (visits >= 25) {
-            visitBonus = 2.0f; 
-        } else if (visits >= 10) {
-            visitBonus = 1.0f;
-        } else if (visits >= 5) {
-            visitBonus = 0.5f;
-        }
+    ScoreInputs in = inputsFor(patient, queueManager);
+    PolicyWeights weights = currentWeights();
+    int waitSeconds = static_cast<int>(currentTime - patient.getArrivalTime());
+    return staticPart(in, weights) + waitSeconds * waitRatePart(in, weights);
+}
+
+void PriorityEngine::cacheScoreParts(Patient& patient, const QueueManager* queueManager) {
+    ScoreInputs in = inputsFor(patient, queueManager);
+    PolicyWeights weights = currentWeights();
+    patient.setScoreParts(staticPart(in, weights), waitRatePart(in, weights));
+}
+
+void PriorityEngine::cacheScoreParts(Patient& patient, int visits) {
+    ScoreInputs in = inputsFor(patient, visits);
+    PolicyWeights weights = currentWeights();
+    patient.setScoreParts(staticPart(in, weights), waitRatePart(in, weights));
+}
+
+// Same result as calculatePriorityScore while the cached parts are current.
+float PriorityEngine::scoreFromCache(Patient& patient, time_t currentTime) const {
+    int waitSeconds = static_cast<int>(currentTime - patient.getArrivalTime());
+    return patient.getStaticScore() + waitSeconds * patient.getWaitRate();
+}
+
+PolicyWeights PriorityEngine::currentWeights() const {
+    PolicyWeights weights = { urgencyWeight, waitTimeWeight, serviceTypeWeight };
+    return weights;
+}
+
+// For settings read back from a journal or snapshot, which store the name.
+bool PriorityEngine::usePolicyNamed(const std::string& name) {
+    if (name == LinearPolicy::NAME) {
+        usePolicy<LinearPolicy>();
     }
+    else if (name == LexicographicPolicy::NAME) {
+        usePolicy<LexicographicPolicy>();
+    }
+    else if (name == TieredSlaPolicy::NAME) {
+        usePolicy<TieredSlaPolicy>();
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+const char* PriorityEngine::getPolicyName() const {
+    return policyName;
+}
+
+bool PriorityEngine::hasSharedWaitSlope() const {
+    return sharedWaitSlope;
+}
+
+// How fast every waiting patient's score rises per second under the current
+// policy; only meaningful when hasSharedWaitSlope().
+float PriorityEngine::getWaitSlope() const {
+    return waitSlope(currentWeights());
+}
 
-    return (patient.getUrgency() * urgencyWeight)
-        + (waitTime * waitTimeWeight)
-        + (serviceScore * serviceTypeWeight)
-        + visitBonus;
+void PriorityEngine::setBatchKernel(BatchKernel kernel) {
+    batchKernel = kernel;
+}
+
+// AUTO resolves to the widest kernel this CPU runs; a kernel the CPU (or
+// the target) lacks falls back to the next narrower one.
+BatchKernel PriorityEngine::getBatchKernel() const {
+    BatchKernel best = bestKernel();
+    if (batchKernel == BatchKernel::AUTO || batchKernel > best) {
+        return best;
+    }
+    return batchKernel;
+}
+
+void PriorityEngine::scoreRange(ScoreBatch& batch, int begin, int end, const BatchParams& params, BatchKernel kernel) const {
+    switch (kernel) {
+#ifdef PRIORITY_ENGINE_X86
+    case BatchKernel::AVX2:
+        scoreAvx2(batch, begin, end, params);
+        break;
+    case BatchKernel::SSE2:
+        scoreSse2(batch, begin, end, params);
+        break;
+#endif
+    default:
+        scoreScalar(batch, begin, end, params);
+        break;
+    }
+}
+
+// Scores every patient in the batch from its cached parts plus the fairness
+// boost past maxWaitMinutes: a multiply-add per patient whatever the policy.
+// Batches of several chunks are split across the worker threads.
+void PriorityEngine::scoreBatch(ScoreBatch& batch, int maxWaitMinutes, float boostMultiplier) {
+    int count = batch.size();
+    batch.scores.resize(count);
+    BatchKernel kernel = getBatchKernel();
+    BatchParams params = { maxWaitMinutes, boostMultiplier };
+    int chunks = (count + BATCH_CHUNK - 1) / BATCH_CHUNK;
+    if (chunks < 2 || workers.size() == 0) {
+        scoreRange(batch, 0, count, params, kernel);
+        return;
+    }
+    workers.run(chunks, [&](int chunk) {
+        int begin = chunk * BATCH_CHUNK;
+        int end = std::min(count, begin + BATCH_CHUNK);
+        scoreRange(batch, begin, end, params, kernel);
+    });
 }
\ No newline at end of file
@@ -1,20 +1,104 @@
 #pragma once
 #include "Patient.h"
-#include <unordered_map>
+#include "ServiceTypeRegistry.h"
+#include "ScoringPolicies.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <string>
 
 using namespace std;
 
+// Column inputs for PriorityEngine::scoreBatch, one element per patient:
+// the score parts cached by cacheScoreParts and currentTime - arrival time.
+// scores receives the results.
+struct ScoreBatch {
+    std::vector<float> staticScore;
+    std::vector<float> waitRate;
+    std::vector<int> waitSeconds;
+    std::vector<float> scores;
+
+    void resize(int count);
+    int size() const;
+};
+
+// The QueueManager fairness rule, applied by the batch kernels.
+struct BatchParams {
+    int maxWaitMinutes;
+    float boostMultiplier;
+};
+
+enum class BatchKernel {
+    AUTO,
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
 class QueueManager; 
 class PriorityEngine {
 private:
+    static const int BATCH_CHUNK = 16384;
+
+    typedef float (*ScorePart)(const ScoreInputs&, const PolicyWeights&);
+    typedef float (*WaitSlope)(const PolicyWeights&);
+
     float urgencyWeight;
     float waitTimeWeight;
     float serviceTypeWeight;
-    unordered_map<string, float> serviceTypeScores;
+    ServiceTypeRegistry serviceTypes;
+    float serviceTypeScores[ServiceTypeRegistry::MAX_TYPES];
+
+    ScorePart staticPart;
+    ScorePart waitRatePart;
+    WaitSlope waitSlope;
+    bool sharedWaitSlope;
+    const char* policyName;
+
+    BatchKernel batchKernel;
+    ThreadPool workers;
+
+    ScoreInputs inputsFor(Patient& patient, const QueueManager* queueManager) const;
+    ScoreInputs inputsFor(Patient& patient, int visits) const;
+    void scoreRange(ScoreBatch& batch, int begin, int end, const BatchParams& params, BatchKernel kernel) const;
 
 public:
     PriorityEngine();
+    PriorityEngine(int batchWorkers);
     void setWeights(float urgency, float waitTime, float serviceType);
-    void setServiceTypeScore(string type, float score);
+    bool setServiceTypeScore(string type, float score);
+    ServiceTypeRegistry& getServiceTypes();
+    float getServiceTypeScore(ServiceTypeId id) const;
+    PolicyWeights currentWeights() const;
+    float getWaitTimeWeight() const;
     float calculatePriorityScore(Patient& patient, time_t currentTime, const QueueManager* queueManager = nullptr);
+
+    // The parts of a score that do not change while a patient waits, stored
+    // on the patient. They must be cached again after a change to the
+    // weights, service scores, policy or the patient's visit count.
+    void cacheScoreParts(Patient& patient, const QueueManager* queueManager);
+    // Same, for a caller that already knows the patient's visit count.
+    void cacheScoreParts(Patient& patient, int visits);
+    float scoreFromCache(Patient& patient, time_t currentTime) const;
+
+    // Switches the scoring formula by pointing the per-patient scoring calls
+    // at Policy's functions; batch scoring works from the cached parts and
+    // does not depend on the policy. Callers that already hold scores or
+    // cached parts must redo them (QueueManager::reconfigure does).
+    template <class Policy>
+    void usePolicy() {
+        staticPart = &Policy::staticScore;
+        waitRatePart = &Policy::waitRate;
+        waitSlope = &Policy::waitSlope;
+        sharedWaitSlope = Policy::SHARED_WAIT_SLOPE;
+        policyName = Policy::NAME;
+    }
+    bool usePolicyNamed(const std::string& name);
+    const char* getPolicyName() const;
+    bool hasSharedWaitSlope() const;
+    float getWaitSlope() const;
+
+    void scoreBatch(ScoreBatch& batch, int maxWaitMinutes, float boostMultiplier);
+    void setBatchKernel(BatchKernel kernel);
+    BatchKernel getBatchKernel() const;
+
 };
\ No newline at end of file
@@ -1,323 +1,1288 @@
 #include "QueueManager.h"
+#include "Logger.h"
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    bool moreVisits(const VisitCount& a, const VisitCount& b) {
+        return a.count != b.count ? a.count > b.count : a.patientId < b.patientId;
+    }
+}
 
 QueueManager::QueueManager(PriorityEngine* engine) {
     this->engine = engine;
+    this->serviceTypes = &engine->getServiceTypes();
     this->maxWaitTime = 25;
     this->boostMultiplier = 0.5f;
+    this->clock = Clock::system();
+    this->scoringMode = ScoringMode::RECOMPUTE;
+    this->anchorTime = clockNow();
+    this->currentTime = this->anchorTime;
+    this->snapshotOffset = 0;
+    this->tracer = nullptr;
+    this->counterCount = 0;
+    this->redirectCount = 0;
+    this->historyPinned = false;
+    this->compactionDeferred = false;
+    this->deferredCompactionTime = 0;
+    this->snapshotterStopping = false;
+    this->snapshotIntervalSeconds = 0;
+    for (int i = 0; i < ServiceTypeRegistry::MAX_TYPES; i++) {
+        lanes[i].queue = i;
+        queueOwners[i] = &lanes[i];
+    }
 }
 
 QueueManager::~QueueManager() {
-    for (auto patient : emergencyQueue) {
-        delete patient;
+    stopSnapshotter();
+}
+
+// Interned once per admission; unregistered names are queued as Checkup.
+ServiceTypeId QueueManager::resolveServiceType(const std::string& serviceType) {
+    ServiceTypeId id = serviceTypes->find(serviceType);
+    return (id >= 0) ? id : ServiceTypeRegistry::CHECKUP;
+}
+
+ServiceTypeRegistry& QueueManager::getServiceTypes() {
+    return *serviceTypes;
+}
+
+// The lanes of every registered type.
+std::vector<std::unique_lock<std::mutex>> QueueManager::lockAllLanes() {
+    return lockLanes(serviceTypes->size());
+}
+
+// Lanes 0 to count - 1; count may take in lanes not registered yet.
+std::vector<std::unique_lock<std::mutex>> QueueManager::lockLanes(int count) {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(count);
+    for (int i = 0; i < count; i++) {
+        locks.emplace_back(lanes[i].lock);
+    }
+    return locks;
+}
+
+TableShard& QueueManager::shardFor(int patientId) const {
+    return patientTable[static_cast<unsigned>(patientId) % TABLE_SHARDS];
+}
+
+// Claims patientTable[patient ID] for a new arrival while the caller holds the
+// lane lock, so no other thread can observe the entry before it is in a heap.
+// Returns nullptr if the patient is already waiting.
+QueueEntry* QueueManager::reserveEntry(Lane& lane, PatientHandle handle) {
+    Patient* patient = pool.get(handle);
+    TableShard& shard = shardFor(patient->getId());
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto result = shard.entries.emplace(patient->getId(), QueueEntry{ patient, handle, lane.queue, false });
+    if (!result.second) {
+        return nullptr;
+    }
+    return &result.first->second;
+}
+
+// Caller holds the lock of the lane whose heap contains handle.
+QueueEntry* QueueManager::entryFor(PatientHandle handle) {
+    int patientId = pool.get(handle)->getId();
+    TableShard& shard = shardFor(patientId);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return &shard.entries.at(patientId);
+}
+
+// Locks the lane that currently holds patientId. A lane redirect can move the
+// patient between reading the entry and taking the lock, so re-check and retry.
+QueueEntry* QueueManager::lockEntryLane(int patientId, std::unique_lock<std::mutex>& laneLock) {
+    TableShard& shard = shardFor(patientId);
+    while (true) {
+        Lane* lane;
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.entries.find(patientId);
+            if (it == shard.entries.end()) {
+                return nullptr;
+            }
+            lane = &laneOf(it->second);
+        }
+
+        laneLock = std::unique_lock<std::mutex>(lane->lock);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.entries.find(patientId);
+        if (it == shard.entries.end()) {
+            laneLock.unlock();
+            return nullptr;
+        }
+        if (&laneOf(it->second) == lane) {
+            return &it->second;
+        }
+        laneLock.unlock();
     }
-    for (auto patient : criticalQueue) {
-        delete patient;
+}
+
+void QueueManager::addPatient(int patientId, int urgency, const std::string& serviceType) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    float score;
+    time_t now = clockNow();
+    if (admitPatient(patientId, urgency, serviceType, resolveServiceType(serviceType), now, true, score)) {
+        HQ_LOG(INFO, LogEvent::PATIENT_ADDED, patientId, 0, score, serviceType);
     }
-    for (auto patient : checkupQueue) {
-        delete patient;
+    else {
+        HQ_LOG(INFO, LogEvent::PATIENT_UPDATED, patientId, 0, score, serviceType);
     }
-    for (auto patient : serviceHistory) {
-        delete patient;
+    if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+        trace->write(TraceRecord::addPatient(now, patientId, urgency, serviceType));
     }
 }
 
-std::vector<Patient*>& QueueManager::getQueueByType(const std::string& serviceType) {
-    if (serviceType == "Emergency") {
-        return emergencyQueue;
+// Admits a batch in one pass under every lane lock, with the same result as
+// calling addPatient (or addPatientAtTime, without countVisits) for each
+// arrival in order. New patients are appended unordered and each touched
+// heap is restored once at the end. A patient already waiting, or listed
+// earlier in the batch, is re-scored in place; patients re-scored in a
+// heap from before the batch are patched there, or the heap is rebuilt if
+// there are many of them. Returns how many patients were newly queued.
+int QueueManager::addPatients(const std::vector<PatientArrival>& arrivals, bool countVisits) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    auto locks = lockAllLanes();
+    int laneCount = static_cast<int>(locks.size());
+    time_t now = clockNow();
+
+    std::vector<size_t> firstNew(2 * laneCount);
+    std::vector<std::vector<PatientHandle>> rescored(2 * laneCount);
+    for (int i = 0; i < laneCount; i++) {
+        firstNew[2 * i] = lanes[i].waiting.size();
+        firstNew[2 * i + 1] = lanes[i].boosted.size();
     }
-    else if (serviceType == "Critical") {
-        return criticalQueue;
+
+    // Grow each shard's tables once for the whole batch rather than
+    // rehashing repeatedly as the arrivals go in.
+    std::vector<size_t> perShard(TABLE_SHARDS, 0);
+    for (const PatientArrival& arrival : arrivals) {
+        perShard[static_cast<unsigned>(arrival.patientId) % TABLE_SHARDS]++;
     }
-    else {
-        return checkupQueue;
+    for (int i = 0; i < TABLE_SHARDS; i++) {
+        if (perShard[i] == 0) continue;
+        std::lock_guard<std::mutex> guard(patientTable[i].lock);
+        patientTable[i].entries.reserve(patientTable[i].entries.size() + perShard[i]);
+        if (countVisits) {
+            patientTable[i].visits.reserve(patientTable[i].visits.size() + perShard[i]);
+        }
+    }
+
+    int admitted = 0;
+    for (const PatientArrival& arrival : arrivals) {
+        ServiceTypeId typeId = resolveServiceType(arrival.serviceType);
+        time_t arrivalTime = arrival.arrivalTime ? arrival.arrivalTime : now;
+        PatientHandle handle = pool.allocate(arrival.patientId, arrival.urgency, arrival.serviceType, typeId);
+        QueueEntry* entry = reserveEntry(lanes[typeId], handle);
+        bool isNew = entry != nullptr;
+        if (isNew) {
+            entry->patient->setArrivalTime(arrivalTime);
+            admitted++;
+        }
+        else {
+            pool.release(handle);
+            TableShard& shard = shardFor(arrival.patientId);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            entry = &shard.entries.at(arrival.patientId);
+        }
+
+        // Scored on the visit count before this arrival, then cached with
+        // the new one, as admitPatient does, at one table lookup.
+        Patient* patient = entry->patient;
+        int visits = countVisits ? bumpVisitCount(arrival.patientId) - 1 : getVisitCount(arrival.patientId);
+        engine->cacheScoreParts(*patient, visits);
+        patient->setPriorityScore(engine->scoreFromCache(*patient, arrivalTime));
+        if (countVisits) {
+            engine->cacheScoreParts(*patient, visits + 1);
+        }
+
+        if (isNew) {
+            admitToLane(lanes[typeId], entry, false);
+        }
+        else {
+            int heapId = static_cast<int>(&laneOf(*entry) - lanes) * 2 + (entry->boosted ? 1 : 0);
+            if (scoringMode == ScoringMode::ARRIVAL_ANCHORED) {
+                patient->setPriorityScore(anchoredKey(patient, entry->boosted));
+            }
+            if (static_cast<size_t>(pool.heapIndex(entry->handle)) < firstNew[heapId]) {
+                rescored[heapId].push_back(entry->handle);
+            }
+        }
+        journalRecord(JournalRecord::admit(arrival.patientId, arrival.urgency, typeId, arrival.serviceType,
+            arrivalTime, countVisits));
+    }
+
+    for (int i = 0; i < laneCount; i++) {
+        std::vector<PatientHandle>* heaps[] = { &lanes[i].waiting, &lanes[i].boosted };
+        for (int h = 0; h < 2; h++) {
+            if (rescored[2 * i + h].empty()) {
+                heapifyAppended(*heaps[h], firstNew[2 * i + h]);
+            }
+            else {
+                restoreRescoredHeap(*heaps[h], firstNew[2 * i + h], rescored[2 * i + h]);
+            }
+        }
+    }
+
+    if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+        std::vector<TraceRecord> records;
+        records.reserve(arrivals.size() + 1);
+        records.push_back(TraceRecord::addBatch(now, static_cast<int>(arrivals.size()), countVisits));
+        for (const PatientArrival& arrival : arrivals) {
+            records.push_back(TraceRecord::arrival(now, arrival.patientId, arrival.urgency, arrival.serviceType,
+                arrival.arrivalTime));
+        }
+        trace->write(records);
     }
+
+    HQ_LOG(INFO, LogEvent::BATCH_ADDED, static_cast<int>(arrivals.size()) - admitted, admitted);
+    return admitted;
 }
 
-void QueueManager::addPatient(Patient* patient) {
-    auto existingPatient = patientTable.find(patient->getId());
-    if (existingPatient != patientTable.end()) {
-        time_t now = time(0);
-        existingPatient->second->updateWaitTime(now);
-        float score = engine->calculatePriorityScore(*(existingPatient->second), now, this);
-        existingPatient->second->setPriorityScore(score);
-        
-        std::vector<Patient*>& targetQueue = getQueueByType(existingPatient->second->getServiceType());
-        auto it = std::find(targetQueue.begin(), targetQueue.end(), existingPatient->second);
-        if (it != targetQueue.end()) {
-            size_t index = it - targetQueue.begin();
-            heapifyUp(targetQueue, index);
-            heapifyDown(targetQueue, index);
+// Queues a new arrival, or re-scores the waiting record if the patient is
+// already queued, in which case it returns false. The journal record is
+// written under the lane lock, so admissions and removals of one patient
+// replay in the order they happened.
+bool QueueManager::admitPatient(int patientId, int urgency, const std::string& serviceType, ServiceTypeId typeId,
+    time_t arrivalTime, bool countsVisit, float& score) {
+    PatientHandle handle = pool.allocate(patientId, urgency, serviceType, typeId);
+    Patient* patient = pool.get(handle);
+    Lane& lane = lanes[typeId];
+    JournalRecord record = JournalRecord::admit(patientId, urgency, typeId, serviceType, arrivalTime, countsVisit);
+
+    while (true) {
+        std::unique_lock<std::mutex> laneLock(lane.lock);
+        QueueEntry* entry = reserveEntry(lane, handle);
+        if (entry) {
+            patient->setArrivalTime(arrivalTime);
+            engine->cacheScoreParts(*patient, this);
+            score = engine->scoreFromCache(*patient, arrivalTime);
+            patient->setPriorityScore(score);
+
+            admitToLane(lane, entry);
+            if (countsVisit) {
+                countVisit(*entry);
+            }
+            journalRecord(record);
+            return true;
         }
-        
-        std::cout << "Updated existing Patient " << patient->getId() 
-                  << " in " << patient->getServiceType()
-                  << " queue (New Score: " << score << ")\n";
-        delete patient;
-    } else {
-        time_t now = time(0);
-        patient->updateWaitTime(now);
-        float score = engine->calculatePriorityScore(*patient, now, this);
-        patient->setPriorityScore(score);
+        laneLock.unlock();
 
-        std::vector<Patient*>& targetQueue = getQueueByType(patient->getServiceType());
-        targetQueue.push_back(patient);
-        heapifyUp(targetQueue, targetQueue.size() - 1);
-         
-        std::cout << "Patient " << patient->getId() << " added to " << patient->getServiceType()
-            << " queue (Score: " << score << ")\n";
+        entry = lockEntryLane(patientId, laneLock);
+        if (entry) {
+            engine->cacheScoreParts(*entry->patient, this);
+            score = engine->scoreFromCache(*entry->patient, arrivalTime);
+            entry->patient->setPriorityScore(score);
+            rekeyEntry(*entry);
+            if (countsVisit) {
+                countVisit(*entry);
+            }
+            journalRecord(record);
+            laneLock.unlock();
 
-        patientTable[patient->getId()] = patient;
+            pool.release(handle);
+            return false;
+        }
+        // The waiting copy was served in between; admit this one as new.
     }
+}
 
-    incrementVisitCount(patient->getId());
+// The admission score above used the count before this visit; the refreshed
+// parts carry the new visit bonus from the next tick on, as a full re-score
+// would. Caller holds the entry's lane lock.
+void QueueManager::countVisit(QueueEntry& entry) {
+    bumpVisitCount(entry.patient->getId());
+    engine->cacheScoreParts(*entry.patient, this);
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED) {
+        rekeyEntry(entry);
+    }
 }
 
+// Returns the new count.
+int QueueManager::bumpVisitCount(int patientId) {
+    TableShard& shard = shardFor(patientId);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.visits.increment(patientId);
+}
 
 void QueueManager::incrementVisitCount(int patientId) {
-    patientVisitCount[patientId]++;
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    std::unique_lock<std::mutex> laneLock;
+    QueueEntry* entry = lockEntryLane(patientId, laneLock);
+    if (entry) {
+        countVisit(*entry);
+    }
+    else {
+        bumpVisitCount(patientId);
+    }
+    journalRecord(JournalRecord::visit(patientId));
 }
 
 int QueueManager::getVisitCount(int patientId) const {
-    auto it = patientVisitCount.find(patientId);
-    return (it != patientVisitCount.end()) ? it->second : 0;
+    TableShard& shard = shardFor(patientId);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.visits.get(patientId);
 }
 
+// Most visits first, ties by patient ID.
 std::vector<int> QueueManager::getFrequentVisitors(int threshold) const {
+    std::vector<VisitCount> counts;
+    for (int i = 0; i < TABLE_SHARDS; i++) {
+        std::lock_guard<std::mutex> guard(patientTable[i].lock);
+        patientTable[i].visits.appendAtLeast(threshold, counts);
+    }
+    std::sort(counts.begin(), counts.end(), moreVisits);
     std::vector<int> frequent;
-    for (const auto& entry : patientVisitCount) {
-        if (entry.second >= threshold)
-            frequent.push_back(entry.first);
+    frequent.reserve(counts.size());
+    for (const VisitCount& entry : counts) {
+        frequent.push_back(entry.patientId);
     }
     return frequent;
 }
 
-std::string QueueManager::getNextServiceType() {
-    if (!emergencyQueue.empty()) {
-        return "Emergency";
+// The k patients with the most visits, most first. Each shard offers its own
+// top k and the best k of those are kept, so which of several patients tied
+// at the cut-off count make the list is unspecified.
+std::vector<VisitCount> QueueManager::getTopVisitors(int k) const {
+    std::vector<VisitCount> top;
+    if (k <= 0) {
+        return top;
     }
-    else if (!criticalQueue.empty()) {
-        return "Critical";
+    for (int i = 0; i < TABLE_SHARDS; i++) {
+        std::lock_guard<std::mutex> guard(patientTable[i].lock);
+        patientTable[i].visits.appendTop(k, top);
     }
-    else if (!checkupQueue.empty()) {
-        return "Checkup";
+    size_t keep = std::min(top.size(), static_cast<size_t>(k));
+    std::partial_sort(top.begin(), top.begin() + keep, top.end(), moreVisits);
+    top.resize(keep);
+    return top;
+}
+
+std::string QueueManager::getNextServiceType() {
+    ServiceTypeId id = getNextServiceTypeId();
+    if (id < 0) {
+        return "";
+    }
+    return serviceTypes->nameOf(id);
+}
+
+ServiceTypeId QueueManager::getNextServiceTypeId() {
+    int count = serviceTypes->size();
+    for (int i = 0; i < count; i++) {
+        if (lanes[i].count > 0) {
+            return i;
+        }
     }
-    return ""; 
+    return -1;
 }
 
 Patient* QueueManager::serveNextPatient() {
-    std::string nextServiceType = getNextServiceType();
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    while (true) {
+        ServiceTypeId nextTypeId = getNextServiceTypeId();
+
+        if (nextTypeId < 0) {
+            if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+                trace->write(TraceRecord::serveNext(clockNow(), -1, 0));
+            }
+            return nullptr;
+        }
+
+        Lane& queue = lanes[nextTypeId];
+        std::unique_lock<std::mutex> laneLock(queue.lock);
+        if (queue.empty()) {
+            // Another counter took the last patient first; pick again.
+            continue;
+        }
+        time_t serviceTime = clockNow();
+        PatientHandle next = takeForService(queue, serviceTime);
+        bool laneEmptied = queue.empty();
+        laneLock.unlock();
 
-    if (nextServiceType.empty()) {
+        HQ_LOG(INFO, LogEvent::PATIENT_SERVED, pool.get(next)->getId(), 0, 0.0f, serviceTypes->nameOf(nextTypeId));
+
+        if (laneEmptied) {
+            redirectEmptyLanes();
+        }
+
+        Patient* patient = recordServiceCompletion(next, serviceTime);
+        if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+            trace->write(TraceRecord::serveNext(serviceTime, patient->getId(),
+                serviceTime - patient->getArrivalTime()));
+        }
+        return patient;
+    }
+}
+
+// Serves up to n patients in the order n calls to serveNextPatient would,
+// holding the lane locks once for the whole batch and recording the history
+// together. served is cleared and refilled, so a caller draining repeatedly
+// can reuse one buffer. Returns the number served.
+int QueueManager::serveNext(int n, std::vector<Patient*>& served) {
+    served.clear();
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    std::vector<PatientHandle> taken;
+    taken.reserve(n > 0 ? n : 0);
+    time_t serviceTime = clockNow();
+    {
+        auto locks = lockAllLanes();
+        int laneCount = static_cast<int>(locks.size());
+        while (static_cast<int>(taken.size()) < n) {
+            int next = 0;
+            while (next < laneCount && lanes[next].empty()) {
+                next++;
+            }
+            if (next == laneCount) {
+                break;
+            }
+            taken.push_back(takeForService(lanes[next], serviceTime));
+            if (lanes[next].empty()) {
+                redirectHeldLanes(laneCount);
+            }
+        }
+    }
+
+    recordServiceCompletions(taken, serviceTime, served);
+    if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+        std::vector<TraceRecord> records;
+        records.reserve(served.size() + 1);
+        records.push_back(TraceRecord::serveBatch(serviceTime, n, static_cast<int>(served.size())));
+        for (Patient* patient : served) {
+            records.push_back(TraceRecord::servedPatient(serviceTime, patient->getId(),
+                serviceTime - patient->getArrivalTime()));
+        }
+        trace->write(records);
+    }
+    if (!taken.empty()) {
+        HQ_LOG(INFO, LogEvent::BATCH_SERVED, 0, static_cast<int>(taken.size()));
+    }
+    return static_cast<int>(taken.size());
+}
+
+// Caller holds the lane lock and has checked that the lane is not empty.
+PatientHandle QueueManager::takeForService(Lane& lane, time_t serviceTime) {
+    PatientHandle next = takeFromLane(lane);
+    journalRecord(JournalRecord::serve(pool.get(next)->getId(), serviceTime, pool.priorityScore(next)));
+    return next;
+}
+
+// Registers a counter that serves the given service types, most preferred
+// first. Returns its ID, or -1 for an unknown type or once MAX_COUNTERS
+// counters exist.
+CounterId QueueManager::addCounter(const std::string& name, const std::vector<std::string>& serviceTypeNames) {
+    std::lock_guard<std::mutex> guard(counterMutex);
+    int id = counterCount;
+    if (id >= MAX_COUNTERS || serviceTypeNames.empty()) {
+        return -1;
+    }
+    std::vector<ServiceTypeId> drawsFrom;
+    for (const auto& typeName : serviceTypeNames) {
+        ServiceTypeId typeId = serviceTypes->find(typeName);
+        if (typeId < 0) {
+            return -1;
+        }
+        drawsFrom.push_back(typeId);
+    }
+    counters[id].name = name;
+    counters[id].lanes = drawsFrom;
+    // Publish only after the counter is filled in; dispatch reads it lock-free.
+    counterCount = id + 1;
+    return id;
+}
+
+// Called when a counter frees up: ends its current service and gives it the
+// best patient from the first of its lanes with anyone waiting, or leaves
+// it idle. Each counter is driven by one thread at a time.
+Patient* QueueManager::serveAtCounter(CounterId id) {
+    if (id < 0 || id >= counterCount) {
         return nullptr;
     }
+    counters[id].patientId = ServiceCounter::DISPATCHING;
+    return assignNextPatient(id);
+}
 
-    std::vector<Patient*>& queue = getQueueByType(nextServiceType);
-    Patient* next = queue.front();
+void QueueManager::finishService(CounterId id) {
+    if (id >= 0 && id < counterCount) {
+        counters[id].patientId = ServiceCounter::IDLE;
+    }
+}
 
-    std::swap(queue[0], queue.back());
-    queue.pop_back();
-    heapifyDown(queue, 0);
+// Gives a waiting patient to every idle counter that has one in its lanes,
+// for example after new arrivals. Safe to call from several threads: a
+// counter is claimed before a patient is chosen for it.
+std::vector<std::pair<CounterId, Patient*>> QueueManager::dispatchIdleCounters() {
+    std::vector<std::pair<CounterId, Patient*>> assigned;
+    int count = counterCount;
+    for (int i = 0; i < count; i++) {
+        int expected = ServiceCounter::IDLE;
+        if (!counters[i].patientId.compare_exchange_strong(expected, ServiceCounter::DISPATCHING)) {
+            continue;
+        }
+        Patient* patient = assignNextPatient(i);
+        if (patient) {
+            assigned.push_back({ i, patient });
+        }
+    }
+    return assigned;
+}
 
-    std::cout << "Serving from " << nextServiceType << " queue: Patient " << next->getId() << "\n";
+// The counter is DISPATCHING, so no one else assigns to it. Empty lanes are
+// skipped on their atomic count without taking their lock.
+Patient* QueueManager::assignNextPatient(CounterId id) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    ServiceCounter& counter = counters[id];
+    for (ServiceTypeId typeId : counter.lanes) {
+        Lane& lane = lanes[typeId];
+        if (lane.count == 0) {
+            continue;
+        }
+        std::unique_lock<std::mutex> laneLock(lane.lock);
+        if (lane.empty()) {
+            continue;
+        }
+        time_t serviceTime = clockNow();
+        PatientHandle next = takeForService(lane, serviceTime);
+        laneLock.unlock();
 
-    if (queue.empty()) {
-        mergeQueues();
+        int patientId = pool.get(next)->getId();
+        counter.busySince = static_cast<long long>(serviceTime);
+        counter.served++;
+        counter.patientId = patientId;
+        HQ_LOG(INFO, LogEvent::COUNTER_SERVING, patientId, 0, 0.0f, counter.name, serviceTypes->nameOf(typeId));
+        return recordServiceCompletion(next, serviceTime);
     }
+    counter.patientId = ServiceCounter::IDLE;
+    return nullptr;
+}
 
-    patientTable.erase(next->getId());
-    recordServiceCompletion(next, time(0));
+int QueueManager::getCounterCount() const {
+    return counterCount;
+}
 
-    return next;
+CounterStatus QueueManager::getCounterStatus(CounterId id) const {
+    CounterStatus status = { "", false, ServiceCounter::IDLE, 0, 0 };
+    if (id < 0 || id >= counterCount) {
+        return status;
+    }
+    const ServiceCounter& counter = counters[id];
+    int patientId = counter.patientId;
+    status.name = counter.name;
+    status.busy = patientId >= 0;
+    status.patientId = status.busy ? patientId : ServiceCounter::IDLE;
+    status.busySince = static_cast<time_t>(counter.busySince.load());
+    status.served = counter.served;
+    return status;
 }
 
+void QueueManager::printCounters() {
+    std::cout << "\n=== Service Counters ===\n";
+    int count = counterCount;
+    if (count == 0) {
+        std::cout << "None registered\n";
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        CounterStatus status = getCounterStatus(i);
+        std::cout << i + 1 << ". " << status.name << " | ";
+        if (status.busy) {
+            std::cout << "Busy with Patient " << status.patientId;
+        }
+        else {
+            std::cout << "Idle";
+        }
+        std::cout << " | Served: " << status.served << " | Draws from:";
+        for (ServiceTypeId typeId : counters[i].lanes) {
+            std::cout << " " << serviceTypes->nameOf(typeId);
+        }
+        std::cout << "\n";
+    }
+}
+
+// Each empty lane takes over the lane ranked just below it: a pass down the
+// lanes and a pass back up, which for the three built-in lanes is
+// Critical -> Emergency, Checkup -> Critical, Critical -> Emergency.
 void QueueManager::mergeQueues() {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    redirectEmptyLanes();
+}
+
+long long QueueManager::getRedirectCount() const {
+    return redirectCount;
+}
 
-    if (emergencyQueue.empty() && !criticalQueue.empty()) {
-        std::cout << "Emergency queue is now empty. Redirecting individuals from critical queue to emergency service counter.\n";
-        emergencyQueue = std::move(criticalQueue);
-        criticalQueue.clear();
-        rebuildHeap(emergencyQueue);
+void QueueManager::redirectEmptyLanes() {
+    int count = serviceTypes->size();
+    for (int i = 0; i + 1 < count; i++) {
+        redirectLane(i + 1, i);
     }
+    for (int i = count - 3; i >= 0; i--) {
+        redirectLane(i + 1, i);
+    }
+}
 
-    if (criticalQueue.empty() && !checkupQueue.empty()) {
-        std::cout << "Critical queue is now empty. Redirecting individuals from checkup queue to critical service counter.\n";
-        criticalQueue = std::move(checkupQueue);
-        checkupQueue.clear();
-        rebuildHeap(criticalQueue);
+// Same passes as redirectEmptyLanes, for a caller holding every lane lock.
+void QueueManager::redirectHeldLanes(int laneCount) {
+    for (int i = 0; i + 1 < laneCount; i++) {
+        redirectHeldLane(i + 1, i);
+    }
+    for (int i = laneCount - 3; i >= 0; i--) {
+        redirectHeldLane(i + 1, i);
     }
+}
+
+// Emptiness is re-checked under both lane locks: a new arrival may have
+// refilled the target lane since the caller saw it empty.
+void QueueManager::redirectLane(ServiceTypeId from, ServiceTypeId to) {
+    std::scoped_lock lock(lanes[to].lock, lanes[from].lock);
+    redirectHeldLane(from, to);
+}
 
-    if (emergencyQueue.empty() && !criticalQueue.empty()) {
-        std::cout << "Emergency queue is now empty. Redirecting individuals from critical queue to emergency service counter.\n";
-        emergencyQueue = std::move(criticalQueue);
-        criticalQueue.clear();
-        rebuildHeap(emergencyQueue);
+void QueueManager::redirectHeldLane(ServiceTypeId from, ServiceTypeId to) {
+    if (lanes[to].empty() && !lanes[from].empty()) {
+        HQ_LOG(INFO, LogEvent::LANE_REDIRECTED, 0, 0, 0.0f, serviceTypes->nameOf(to), serviceTypes->nameOf(from));
+        moveQueue(lanes[from], lanes[to]);
+        journalRecord(JournalRecord::redirect(from, to));
+        redirectCount++;
     }
 }
 
-void QueueManager::heapifyUp(std::vector<Patient*>& heap, int index) {
+// Hands from's heaps to the empty lane to in O(1): the heaps swap places
+// along with their QueueIds, and only the two owner slots change, so no
+// patient entry is touched however long the lane is. Caller holds both
+// lane locks.
+void QueueManager::moveQueue(Lane& from, Lane& to) {
+    std::swap(to.waiting, from.waiting);
+    std::swap(to.boosted, from.boosted);
+    std::swap(to.queue, from.queue);
+    queueOwners[to.queue] = &to;
+    queueOwners[from.queue] = &from;
+    to.count = to.size();
+    from.count = 0;
+}
+
+// Stable while the caller holds the returned lane's lock.
+Lane& QueueManager::laneOf(const QueueEntry& entry) const {
+    return *queueOwners[entry.queue].load();
+}
+
+std::vector<PatientHandle>& QueueManager::heapOf(const QueueEntry& entry) {
+    Lane& lane = laneOf(entry);
+    return entry.boosted ? lane.boosted : lane.waiting;
+}
+
+void QueueManager::swapSlots(std::vector<PatientHandle>& heap, int a, int b) {
+    std::swap(heap[a], heap[b]);
+    pool.heapIndex(heap[a]) = a;
+    pool.heapIndex(heap[b]) = b;
+}
+
+void QueueManager::heapifyUp(std::vector<PatientHandle>& heap, int index) {
     while (index > 0) {
         int parent = (index - 1) / 2;
-        if (heap[index]->getPriorityScore() <= heap[parent]->getPriorityScore()) break;
-        std::swap(heap[index], heap[parent]);
+        if (pool.priorityScore(heap[index]) <= pool.priorityScore(heap[parent])) break;
+        swapSlots(heap, index, parent);
         index = parent;
     }
 }
 
-void QueueManager::heapifyDown(std::vector<Patient*>& heap, int index) {
+void QueueManager::heapifyDown(std::vector<PatientHandle>& heap, int index) {
     int size = heap.size();
     while (true) {
         int left = 2 * index + 1;
         int right = 2 * index + 2;
         int largest = index;
 
-        if (left < size && heap[left]->getPriorityScore() > heap[largest]->getPriorityScore())
+        if (left < size && pool.priorityScore(heap[left]) > pool.priorityScore(heap[largest]))
             largest = left;
-        if (right < size && heap[right]->getPriorityScore() > heap[largest]->getPriorityScore())
+        if (right < size && pool.priorityScore(heap[right]) > pool.priorityScore(heap[largest]))
             largest = right;
 
         if (largest == index) break;
-        std::swap(heap[index], heap[largest]);
+        swapSlots(heap, index, largest);
         index = largest;
     }
 }
 
-void QueueManager::rebuildHeap(std::vector<Patient*>& heap) {
+void QueueManager::restoreHeapAt(std::vector<PatientHandle>& heap, int index) {
+    if (index > 0 &&
+        pool.priorityScore(heap[index]) > pool.priorityScore(heap[(index - 1) / 2])) {
+        heapifyUp(heap, index);
+    }
+    else {
+        heapifyDown(heap, index);
+    }
+}
+
+void QueueManager::rebuildHeap(std::vector<PatientHandle>& heap) {
     std::make_heap(heap.begin(), heap.end(),
-        [](Patient* a, Patient* b) { return a->getPriorityScore() < b->getPriorityScore(); });
+        [this](PatientHandle a, PatientHandle b) {
+            return pool.priorityScore(a) < pool.priorityScore(b);
+        });
+    for (int i = 0; i < static_cast<int>(heap.size()); i++) {
+        pool.heapIndex(heap[i]) = i;
+    }
 }
 
-void QueueManager::updatePriorities(time_t currentTime) {
-    for (auto& patient : emergencyQueue) {
-        time_t waitTimeSec = currentTime - patient->getArrivalTime();
-        patient->updateWaitTime(currentTime);
+// Without heapify the handle is only appended; the caller must restore the
+// heap with heapifyAppended before anyone else sees the lane.
+void QueueManager::insertIntoQueue(Lane& lane, QueueEntry* entry, bool boosted, bool heapify) {
+    std::vector<PatientHandle>& heap = boosted ? lane.boosted : lane.waiting;
+    heap.push_back(entry->handle);
+    int index = heap.size() - 1;
+    pool.heapIndex(entry->handle) = index;
+    entry->boosted = boosted;
+    lane.count++;
+    if (heapify) {
+        heapifyUp(heap, index);
+    }
+}
 
-        float newScore = engine->calculatePriorityScore(*patient, currentTime, this);
+// Restores a heap whose slots from firstNew on were appended unordered:
+// sifts each one up, or rebuilds the whole heap in O(n) (Floyd) when that
+// is cheaper.
+void QueueManager::heapifyAppended(std::vector<PatientHandle>& heap, size_t firstNew) {
+    size_t added = heap.size() - firstNew;
+    if (added == 0) {
+        return;
+    }
+    if (added * std::log2(static_cast<double>(heap.size())) >= static_cast<double>(heap.size())) {
+        rebuildHeap(heap);
+        return;
+    }
+    for (size_t i = firstNew; i < heap.size(); i++) {
+        heapifyUp(heap, static_cast<int>(i));
+    }
+}
 
-        int waitTimeMin = waitTimeSec / 60;
-        if (waitTimeMin > maxWaitTime) {
-            float extraWait = waitTimeMin - maxWaitTime;
-            newScore += extraWait * boostMultiplier;
-        }
+// Restores a heap whose slots before firstNew were in order until the
+// patients in `changed` were re-scored, and whose slots from firstNew on
+// were appended unordered. The changed slots are patched within the old
+// part with the new slots set aside, then the new slots are sifted in; when
+// so many changed that patching would cost more, the heap is rebuilt.
+void QueueManager::restoreRescoredHeap(std::vector<PatientHandle>& heap, size_t firstNew,
+    const std::vector<PatientHandle>& changed) {
+    if (changed.size() * std::log2(static_cast<double>(firstNew)) >= static_cast<double>(firstNew)) {
+        rebuildHeap(heap);
+        return;
+    }
+    std::vector<PatientHandle> appended(heap.begin() + firstNew, heap.end());
+    heap.resize(firstNew);
+    for (PatientHandle handle : changed) {
+        restoreHeapAt(heap, pool.heapIndex(handle));
+    }
+    // The appended slots go back where they were, so their indices hold.
+    heap.insert(heap.end(), appended.begin(), appended.end());
+    heapifyAppended(heap, firstNew);
+}
 
-        patient->setPriorityScore(newScore);
+// Detaches the entry from its heap but leaves it in patientTable.
+void QueueManager::removeFromQueue(QueueEntry* entry) {
+    removeSlot(laneOf(*entry), heapOf(*entry), pool.heapIndex(entry->handle));
+}
+
+void QueueManager::removeSlot(Lane& lane, std::vector<PatientHandle>& heap, int index) {
+    PatientHandle handle = heap[index];
+    int last = heap.size() - 1;
+    if (index != last) {
+        swapSlots(heap, index, last);
+    }
+    heap.pop_back();
+    lane.count--;
+    pool.heapIndex(handle) = -1;
+    if (index < static_cast<int>(heap.size())) {
+        restoreHeapAt(heap, index);
     }
+}
 
-    for (auto& patient : criticalQueue) {
-        time_t waitTimeSec = currentTime - patient->getArrivalTime();
-        patient->updateWaitTime(currentTime);
+void QueueManager::admitToLane(Lane& lane, QueueEntry* entry, bool heapify) {
+    Patient* patient = entry->patient;
+    if (scoringMode == ScoringMode::RECOMPUTE) {
+        insertIntoQueue(lane, entry, false, heapify);
+        return;
+    }
+    bool boosted = isPastFairnessLimit(patient, currentTime);
+    patient->setPriorityScore(anchoredKey(patient, boosted));
+    insertIntoQueue(lane, entry, boosted, heapify);
+    if (!boosted) {
+        std::lock_guard<std::mutex> guard(arrivalMutex);
+        unboostedByArrival.insert({ patient->getArrivalTime(), patient->getId() });
+    }
+}
 
-        float newScore = engine->calculatePriorityScore(*patient, currentTime, this);
+PatientHandle QueueManager::takeFromLane(Lane& lane) {
+    std::vector<PatientHandle>* source = &lane.waiting;
+    if (!lane.boosted.empty()) {
+        if (lane.waiting.empty() ||
+            liveScore(pool.get(lane.boosted[0]), true) > liveScore(pool.get(lane.waiting[0]), false)) {
+            source = &lane.boosted;
+        }
+    }
+    // The top slot is removed without looking its entry up first; the table
+    // is only touched once, to erase it.
+    PatientHandle handle = (*source)[0];
+    removeSlot(lane, *source, 0);
+    return retireEntry(handle, source == &lane.boosted);
+}
 
-        int waitTimeMin = waitTimeSec / 60;
-        if (waitTimeMin > maxWaitTime) {
-            float extraWait = waitTimeMin - maxWaitTime;
-            newScore += extraWait * boostMultiplier;
+// Caller holds the entry's lane lock. The entry is erased from patientTable,
+// so nothing may touch it after this returns.
+PatientHandle QueueManager::removeEntry(QueueEntry* entry) {
+    PatientHandle handle = entry->handle;
+    bool boosted = entry->boosted;
+    removeFromQueue(entry);
+    return retireEntry(handle, boosted);
+}
+
+// Finishes removing a patient already taken out of its heap: fixes its
+// final score and erases its patientTable entry.
+PatientHandle QueueManager::retireEntry(PatientHandle handle, bool boosted) {
+    Patient* patient = pool.get(handle);
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED) {
+        if (!boosted) {
+            std::lock_guard<std::mutex> guard(arrivalMutex);
+            unboostedByArrival.erase({ patient->getArrivalTime(), patient->getId() });
         }
+        patient->setPriorityScore(liveScore(patient, boosted));
+    }
 
-        patient->setPriorityScore(newScore);
+    TableShard& shard = shardFor(patient->getId());
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.entries.erase(patient->getId());
+    return handle;
+}
+
+void QueueManager::rekeyEntry(QueueEntry& entry) {
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED) {
+        entry.patient->setPriorityScore(anchoredKey(entry.patient, entry.boosted));
     }
+    restoreHeapAt(heapOf(entry), pool.heapIndex(entry.handle));
+}
 
-    for (auto& patient : checkupQueue) {
-        time_t waitTimeSec = currentTime - patient->getArrivalTime();
-        patient->updateWaitTime(currentTime);
+bool QueueManager::isPastFairnessLimit(Patient* patient, time_t now) const {
+    return now - patient->getArrivalTime() > static_cast<time_t>(maxWaitTime) * 60;
+}
+
+// Arrival-anchored keys fold everything that depends on "now" into a per-heap
+// slope: score(t) = key + (t - anchorTime) * slope. Within one heap the slope
+// is shared, so the order never changes until a patient crosses the fairness
+// limit and moves to the boosted heap. The boost accrues per second here
+// rather than in whole minutes, which is what keeps the key time-invariant.
+float QueueManager::anchoredSlope(bool boosted) const {
+    float slope = engine->getWaitSlope();
+    if (boosted) {
+        slope += boostMultiplier / 60.0f;
+    }
+    return slope;
+}
 
-        float newScore = engine->calculatePriorityScore(*patient, currentTime, this);
+float QueueManager::anchoredKey(Patient* patient, bool boosted) {
+    float base = engine->scoreFromCache(*patient, patient->getArrivalTime());
+    float key = base - (patient->getArrivalTime() - anchorTime) * anchoredSlope(boosted);
+    if (boosted) {
+        key -= maxWaitTime * boostMultiplier;
+    }
+    return key;
+}
 
-        int waitTimeMin = waitTimeSec / 60;
-        if (waitTimeMin > maxWaitTime) {
-            float extraWait = waitTimeMin - maxWaitTime;
-            newScore += extraWait * boostMultiplier;
+float QueueManager::liveScore(Patient* patient, bool boosted) const {
+    if (scoringMode == ScoringMode::RECOMPUTE) {
+        return patient->getPriorityScore();
+    }
+    return patient->getPriorityScore() + (currentTime - anchorTime) * anchoredSlope(boosted);
+}
+
+// Caller holds every lane lock.
+void QueueManager::promoteCrossedPatients(time_t now) {
+    time_t limit = now - static_cast<time_t>(maxWaitTime) * 60;
+    while (true) {
+        int patientId;
+        {
+            std::lock_guard<std::mutex> guard(arrivalMutex);
+            if (unboostedByArrival.empty() || unboostedByArrival.begin()->first >= limit) {
+                break;
+            }
+            patientId = unboostedByArrival.begin()->second;
+            unboostedByArrival.erase(unboostedByArrival.begin());
         }
 
-        patient->setPriorityScore(newScore);
+        QueueEntry* entry;
+        {
+            TableShard& shard = shardFor(patientId);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            entry = &shard.entries.at(patientId);
+        }
+        removeFromQueue(entry);
+        entry->patient->setPriorityScore(anchoredKey(entry->patient, true));
+        insertIntoQueue(laneOf(*entry), entry, true);
     }
+}
 
-    rebuildHeap(emergencyQueue);
-    rebuildHeap(criticalQueue);
-    rebuildHeap(checkupQueue);
+float QueueManager::scoreWithFairnessBoost(Patient* patient, time_t now) {
+    time_t waitTimeSec = now - patient->getArrivalTime();
+    patient->updateWaitTime(now);
+
+    float newScore = engine->scoreFromCache(*patient, now);
+
+    int waitTimeMin = waitTimeSec / 60;
+    if (waitTimeMin > maxWaitTime) {
+        float extraWait = waitTimeMin - maxWaitTime;
+        newScore += extraWait * boostMultiplier;
+    }
+    return newScore;
 }
 
-void QueueManager::printQueue() {
-    printAllQueues();
+bool QueueManager::updatePatientScore(int patientId, float newScore) {
+    return overridePatientScore(patientId, newScore, nullptr);
 }
 
-void QueueManager::printAllQueues() {
-    std::cout << "\n=== Emergency Queue ===\n";
-    if (emergencyQueue.empty()) {
-        std::cout << "Empty\n";
+// The score holds as of the last tick, or as of *scoredAt when one is
+// given; replay passes the journaled time. In RECOMPUTE mode the next tick replaces it; anchored, it
+// keeps growing from there at the heap's slope.
+bool QueueManager::overridePatientScore(int patientId, float score, const time_t* scoredAt) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    std::unique_lock<std::mutex> laneLock;
+    QueueEntry* entry = lockEntryLane(patientId, laneLock);
+    if (!entry) {
+        return false;
+    }
+    setEntryScore(*entry, score, scoredAt ? *scoredAt : currentTime);
+    return true;
+}
+
+// Recomputes one waiting patient's score as of `now`. It is journaled and
+// traced as an override of the score that comes out, which replays to the
+// same key.
+bool QueueManager::rescorePatient(int patientId, time_t now) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    std::unique_lock<std::mutex> laneLock;
+    QueueEntry* entry = lockEntryLane(patientId, laneLock);
+    if (!entry) {
+        return false;
+    }
+    float score;
+    if (scoringMode == ScoringMode::RECOMPUTE) {
+        score = scoreWithFairnessBoost(entry->patient, now);
     }
     else {
-        for (const auto& patient : emergencyQueue) {
-            std::cout << "ID: " << patient->getId()
-                << " | Score: " << std::fixed << std::setprecision(2)
-                << patient->getPriorityScore()
-                << " | Type: " << patient->getServiceType() << "\n";
+        score = anchoredKey(entry->patient, entry->boosted) + (now - anchorTime) * anchoredSlope(entry->boosted);
+    }
+    setEntryScore(*entry, score, now);
+    return true;
+}
+
+// Keys the entry so that its score is `score` at `asOf`, and journals that.
+// The caller holds the gate and the entry's lane.
+void QueueManager::setEntryScore(QueueEntry& entry, float score, time_t asOf) {
+    float key = score;
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED) {
+        key -= (asOf - anchorTime) * anchoredSlope(entry.boosted);
+    }
+    entry.patient->setPriorityScore(key);
+    restoreHeapAt(heapOf(entry), pool.heapIndex(entry.handle));
+    journalRecord(JournalRecord::scoreOverride(entry.patient->getId(), score, asOf));
+}
+
+void QueueManager::updatePriorities(time_t currentTime) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    auto locks = lockAllLanes();
+    int count = static_cast<int>(locks.size());
+    this->currentTime = currentTime;
+    if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+        trace->write(TraceRecord::updatePriorities(clockNow(), currentTime));
+    }
+    journalRecord(JournalRecord::tick(currentTime));
+
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED) {
+        // Keys are floats relative to anchorTime; keep the offset small.
+        if (patientCount(count) == 0) {
+            anchorTime = currentTime;
         }
+        else if (currentTime - anchorTime > 24 * 60 * 60) {
+            anchorTime = currentTime;
+            rekeyAllPatients(count);
+        }
+        promoteCrossedPatients(currentTime);
+        return;
     }
 
-    std::cout << "\n=== Critical Queue ===\n";
-    if (criticalQueue.empty()) {
-        std::cout << "Empty\n";
+    rescoreWaitingPatients(count, currentTime);
+}
+
+// Gathers the cached score parts of every waiting patient of the first
+// laneCount lanes into one batch so PriorityEngine can score them together,
+// then rebuilds each heap. Gives the same scores as scoreWithFairnessBoost.
+// Caller holds those lane locks.
+void QueueManager::rescoreWaitingPatients(int laneCount, time_t now) {
+    int total = 0;
+    for (int i = 0; i < laneCount; i++) {
+        total += static_cast<int>(lanes[i].waiting.size());
     }
-    else {
-        for (const auto& patient : criticalQueue) {
-            std::cout << "ID: " << patient->getId()
-                << " | Score: " << std::fixed << std::setprecision(2)
-                << patient->getPriorityScore()
-                << " | Type: " << patient->getServiceType() << "\n";
+    scoreScratch.resize(total);
+
+    int next = 0;
+    for (int i = 0; i < laneCount; i++) {
+        for (auto handle : lanes[i].waiting) {
+            scoreScratch.staticScore[next] = pool.staticScore(handle);
+            scoreScratch.waitRate[next] = pool.waitRate(handle);
+            scoreScratch.waitSeconds[next] = static_cast<int>(now - pool.arrivalTime(handle));
+            next++;
+        }
+    }
+
+    engine->scoreBatch(scoreScratch, maxWaitTime, boostMultiplier);
+
+    next = 0;
+    for (int i = 0; i < laneCount; i++) {
+        for (auto handle : lanes[i].waiting) {
+            pool.priorityScore(handle) = scoreScratch.scores[next++];
         }
+        rebuildHeap(lanes[i].waiting);
     }
+}
 
-    std::cout << "\n=== Checkup Queue ===\n";
-    if (checkupQueue.empty()) {
+int QueueManager::patientCount(int laneCount) {
+    int total = 0;
+    for (int i = 0; i < laneCount; i++) {
+        total += lanes[i].count;
+    }
+    return total;
+}
+
+void QueueManager::printQueue() {
+    printAllQueues();
+}
+
+void QueueManager::printAllQueues() {
+    auto locks = lockAllLanes();
+    for (int i = 0; i < static_cast<int>(locks.size()); i++) {
+        printLane(serviceTypes->nameOf(i), lanes[i]);
+    }
+}
+
+void QueueManager::printLane(const std::string& name, Lane& lane) {
+    std::cout << "\n=== " << name << " Queue ===\n";
+    if (lane.empty()) {
         std::cout << "Empty\n";
+        return;
     }
-    else {
-        for (const auto& patient : checkupQueue) {
-            std::cout << "ID: " << patient->getId()
-                << " | Score: " << std::fixed << std::setprecision(2)
-                << patient->getPriorityScore()
-                << " | Type: " << patient->getServiceType() << "\n";
-        }
+    for (auto handle : lane.boosted) {
+        Patient* patient = pool.get(handle);
+        std::cout << "ID: " << patient->getId()
+            << " | Score: " << std::fixed << std::setprecision(2)
+            << liveScore(patient, true)
+            << " | Type: " << patient->getServiceType() << " (boosted)\n";
+    }
+    for (auto handle : lane.waiting) {
+        Patient* patient = pool.get(handle);
+        std::cout << "ID: " << patient->getId()
+            << " | Score: " << std::fixed << std::setprecision(2)
+            << liveScore(patient, false)
+            << " | Type: " << patient->getServiceType() << "\n";
     }
 }
 
 void QueueManager::setFairnessParams(int maxWait, float boost) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    auto locks = lockAllLanes();
     maxWaitTime = maxWait;
     boostMultiplier = boost;
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED) {
+        rekeyAllPatients(static_cast<int>(locks.size()));
+    }
+    journalRecord(JournalRecord::fairness(maxWait, boost));
+}
+
+// Arrival-anchored keys need every score to rise at the same rate, so they
+// are refused under a policy without a shared wait slope.
+bool QueueManager::setScoringMode(ScoringMode mode) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    auto locks = lockAllLanes();
+    if (mode == ScoringMode::ARRIVAL_ANCHORED && !engine->hasSharedWaitSlope()) {
+        return false;
+    }
+    if (mode == scoringMode) {
+        return true;
+    }
+    scoringMode = mode;
+    anchorTime = currentTime;
+    rekeyAllPatients(static_cast<int>(locks.size()));
+    journalRecord(JournalRecord::scoringMode(static_cast<int>(mode)));
+    return true;
+}
+
+ScoringMode QueueManager::getScoringMode() {
+    std::lock_guard<std::mutex> guard(lanes[0].lock);
+    return scoringMode;
+}
+
+// Moving to another clock moves "now", possibly by years, so waiting
+// patients are re-scored against the new clock and anchored keys are
+// re-based on it. Patients keep their original arrival times.
+void QueueManager::setClock(Clock* clock) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    auto locks = lockAllLanes();
+    this->clock = clock ? clock : Clock::system();
+    currentTime = clockNow();
+    anchorTime = currentTime;
+    rekeyAllPatients(static_cast<int>(locks.size()));
+}
+
+Clock* QueueManager::getClock() const {
+    return clock.load();
+}
+
+time_t QueueManager::clockNow() const {
+    return clock.load(std::memory_order_acquire)->now();
+}
+
+// Runs an engine change (weights, service scores, new service types, scoring
+// policy) while no patient is being scored, then re-scores the waiting
+// patients so old and new scores never share a heap. A lane registered by
+// the change is still empty. A policy that cannot be anchored drops the
+// queue back to RECOMPUTE.
+void QueueManager::reconfigure(const std::function<void()>& change) {
+    applyReconfiguration(change, nullptr);
+}
+
+// As above, journaling `record` as the description of the change.
+void QueueManager::reconfigure(const std::function<void()>& change, const JournalRecord& record) {
+    applyReconfiguration(change, &record);
+}
+
+// Every lane a change could register is locked too, so nobody can admit to
+// a new lane until its record is in the journal ahead of the admission.
+void QueueManager::applyReconfiguration(const std::function<void()>& change, const JournalRecord* record) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    auto locks = lockLanes(ServiceTypeRegistry::MAX_TYPES);
+    change();
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED && !engine->hasSharedWaitSlope()) {
+        scoringMode = ScoringMode::RECOMPUTE;
+    }
+    rekeyAllPatients(serviceTypes->size());
+    if (record) {
+        journalRecord(*record);
+    }
+}
+
+// Re-admits every waiting patient under the current weights, fairness rules
+// and scoring mode. O(n log n); only needed after an admin change. Caller
+// holds the locks of the first laneCount lanes.
+void QueueManager::rekeyAllPatients(int laneCount) {
+    {
+        std::lock_guard<std::mutex> guard(arrivalMutex);
+        unboostedByArrival.clear();
+    }
+    for (int i = 0; i < laneCount; i++) {
+        Lane* lane = &lanes[i];
+        std::vector<PatientHandle> handles = std::move(lane->waiting);
+        handles.insert(handles.end(), lane->boosted.begin(), lane->boosted.end());
+        lane->waiting.clear();
+        lane->boosted.clear();
+        lane->count = 0;
+
+        for (auto handle : handles) {
+            QueueEntry* entry = entryFor(handle);
+            engine->cacheScoreParts(*entry->patient, this);
+            if (scoringMode == ScoringMode::RECOMPUTE) {
+                entry->patient->setPriorityScore(scoreWithFairnessBoost(entry->patient, currentTime));
+            }
+            admitToLane(*lane, entry);
+        }
+    }
 }
 
 bool QueueManager::isQueueEmpty(const std::string& serviceType) {
-    return getQueueByType(serviceType).empty();
+    return lanes[resolveServiceType(serviceType)].count == 0;
 }
 
 int QueueManager::getQueueSize(const std::string& serviceType) {
-    return getQueueByType(serviceType).size();
+    return lanes[resolveServiceType(serviceType)].count;
 }
 
-void QueueManager::recordServiceCompletion(Patient* patient, time_t serviceTime) {
-    Patient* historyPatient = new Patient(*patient);
-    historyPatient->setServiceTime(serviceTime);
-    serviceHistory.push_back(historyPatient);
+// The served record stays in its pool slot and becomes the history entry
+// until retention evicts it; evicted slots go back to the pool.
+Patient* QueueManager::recordServiceCompletion(PatientHandle handle, time_t serviceTime) {
+    Patient* patient = pool.get(handle);
+    patient->setServiceTime(serviceTime);
+    std::vector<PatientHandle> evicted;
+    {
+        std::lock_guard<std::mutex> guard(historyMutex);
+        serviceHistory.record(handle, serviceTime, patient->getServiceTypeId(), patient->getTotalWaitTimeMinutes());
+        evicted = compactHistory(serviceTime);
+    }
+    releaseAll(evicted);
+    return patient;
 }
 
-std::vector<Patient*> QueueManager::getServiceHistory(time_t startTime, time_t endTime) {
-    std::vector<Patient*> filtered;
-    for (auto patient : serviceHistory) {
-        time_t serviceTime = patient->getServiceTime();
-        if (serviceTime >= startTime && serviceTime <= endTime) {
-            filtered.push_back(patient);
+// Batch form of recordServiceCompletion: one history lock and one
+// retention pass for the lot. Appends the served records to served.
+void QueueManager::recordServiceCompletions(const std::vector<PatientHandle>& handles, time_t serviceTime,
+    std::vector<Patient*>& served) {
+    std::vector<PatientHandle> evicted;
+    {
+        std::lock_guard<std::mutex> guard(historyMutex);
+        for (auto handle : handles) {
+            Patient* patient = pool.get(handle);
+            patient->setServiceTime(serviceTime);
+            serviceHistory.record(handle, serviceTime, patient->getServiceTypeId(), patient->getTotalWaitTimeMinutes());
+            served.push_back(patient);
         }
+        evicted = compactHistory(serviceTime);
     }
-    return filtered;
+    releaseAll(evicted);
+}
+
+// Caller holds historyMutex. Eviction is monotonic in time, so running a
+// deferred one later with the latest time evicts exactly what the skipped
+// ones would have.
+std::vector<PatientHandle> QueueManager::compactHistory(time_t now) {
+    if (historyPinned) {
+        deferredCompactionTime = compactionDeferred ? std::max(deferredCompactionTime, now) : now;
+        compactionDeferred = true;
+        return std::vector<PatientHandle>();
+    }
+    return serviceHistory.compact(now);
+}
+
+// Caller holds historyMutex; returns what the deferred eviction released.
+std::vector<PatientHandle> QueueManager::unpinHistory() {
+    historyPinned = false;
+    serviceHistory.unpin();
+    if (!compactionDeferred) {
+        return std::vector<PatientHandle>();
+    }
+    compactionDeferred = false;
+    return serviceHistory.compact(deferredCompactionTime);
+}
+
+void QueueManager::releaseAll(const std::vector<PatientHandle>& handles) {
+    for (auto handle : handles) {
+        pool.release(handle);
+    }
+}
+
+std::vector<Patient*> QueueManager::toPatients(const std::vector<PatientHandle>& handles) const {
+    std::vector<Patient*> patients;
+    patients.reserve(handles.size());
+    for (auto handle : handles) {
+        patients.push_back(pool.get(handle));
+    }
+    return patients;
+}
+
+std::vector<Patient*> QueueManager::getServiceHistory(time_t startTime, time_t endTime) {
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return toPatients(serviceHistory.between(startTime, endTime));
 }
 
 std::vector<Patient*> QueueManager::getServiceHistoryByPriority(float minPriority, float maxPriority) {
+    std::lock_guard<std::mutex> guard(historyMutex);
     std::vector<Patient*> filtered;
-    for (auto patient : serviceHistory) {
+    for (auto handle : serviceHistory.everything()) {
+        Patient* patient = pool.get(handle);
         float priority = patient->getPriorityScore();
         if (priority >= minPriority && priority <= maxPriority) {
             filtered.push_back(patient);
@@ -327,61 +1292,542 @@ std::vector<Patient*> QueueManager::getServiceHistoryByPriority(float minPriorit
 }
 
 std::vector<Patient*> QueueManager::getServiceHistoryByQueueType(const std::string& queueType) {
-    std::vector<Patient*> filtered;
-    for (auto patient : serviceHistory) {
-        if (patient->getServiceType() == queueType) {
-            filtered.push_back(patient);
-        }
-    }
-    return filtered;
+    ServiceTypeId typeId = serviceTypes->find(queueType);
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return toPatients(serviceHistory.ofType(typeId));
 }
 
 std::vector<Patient*> QueueManager::getServiceHistoryByQueueType(const std::string& queueType, time_t startTime, time_t endTime) {
-    std::vector<Patient*> filtered;
-    for (auto patient : serviceHistory) {
-        time_t serviceTime = patient->getServiceTime();
-        if (patient->getServiceType() == queueType &&
-            serviceTime >= startTime && serviceTime <= endTime) {
-            filtered.push_back(patient);
-        }
+    ServiceTypeId typeId = serviceTypes->find(queueType);
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return toPatients(serviceHistory.ofTypeBetween(typeId, startTime, endTime));
+}
+
+int QueueManager::getServedCount(time_t startTime, time_t endTime) {
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return serviceHistory.countBetween(startTime, endTime);
+}
+
+int QueueManager::getServedCount(ServiceTypeId typeId, time_t startTime, time_t endTime) {
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return serviceHistory.countOfTypeBetween(typeId, startTime, endTime);
+}
+
+double QueueManager::getAverageWaitMinutes(time_t startTime, time_t endTime) {
+    std::lock_guard<std::mutex> guard(historyMutex);
+    int count = serviceHistory.countBetween(startTime, endTime);
+    if (count == 0) {
+        return 0.0;
     }
-    return filtered;
+    return static_cast<double>(serviceHistory.waitMinutesBetween(startTime, endTime)) / count;
+}
+
+void QueueManager::setHistoryRetention(int hours, int maxRecords) {
+    applyHistoryRetention(hours, maxRecords, clockNow());
+}
+
+// Replay passes the journaled time, so history is cut where it was live
+// rather than where the recovering clock has got to.
+void QueueManager::applyHistoryRetention(int hours, int maxRecords, time_t now) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    HistoryRetention limits;
+    limits.hours = hours;
+    limits.maxRecords = maxRecords;
+    std::vector<PatientHandle> evicted;
+    {
+        std::lock_guard<std::mutex> guard(historyMutex);
+        serviceHistory.setRetention(limits);
+        evicted = compactHistory(now);
+    }
+    journalRecord(JournalRecord::retention(hours, maxRecords, now));
+    releaseAll(evicted);
 }
 
-void QueueManager::addPatientAtTime(Patient* patient, time_t timestamp) {
-    patient->setArrivalTime(timestamp);
+HistoryRetention QueueManager::getHistoryRetention() {
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return serviceHistory.getRetention();
+}
 
-    float score = engine->calculatePriorityScore(*patient, timestamp, this);
-    patient->setPriorityScore(score);
+int QueueManager::getRetainedHistoryCount() {
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return serviceHistory.retainedCount();
+}
 
-    std::vector<Patient*>& targetQueue = getQueueByType(patient->getServiceType());
-    targetQueue.push_back(patient);
-    heapifyUp(targetQueue, targetQueue.size() - 1);
+std::vector<HistoryRollup> QueueManager::getHistoryRollups() {
+    std::lock_guard<std::mutex> guard(historyMutex);
+    return serviceHistory.getRollups();
+}
 
-    patientTable[patient->getId()] = patient;
+void QueueManager::addPatientAtTime(int patientId, int urgency, const std::string& serviceType, time_t timestamp) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    float score;
+    admitPatient(patientId, urgency, serviceType, resolveServiceType(serviceType), timestamp, false, score);
+    if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+        trace->write(TraceRecord::addAtTime(clockNow(), patientId, urgency, serviceType, timestamp));
+    }
 }
 
 std::string QueueManager::getQueueStatus() {
-    return "Emergency: " + std::to_string(emergencyQueue.size()) +
-        ", Critical: " + std::to_string(criticalQueue.size()) +
-        ", Checkup: " + std::to_string(checkupQueue.size());
+    std::string status;
+    int count = serviceTypes->size();
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            status += ", ";
+        }
+        status += serviceTypes->nameOf(i) + ": " + std::to_string(lanes[i].count);
+    }
+    return status;
 }
 
 Patient* QueueManager::servePatientById(int patientId) {
-    std::vector<std::vector<Patient*>*> queues = { &emergencyQueue, &criticalQueue, &checkupQueue };
-    for (auto queue : queues) {
-        auto it = std::find_if(queue->begin(), queue->end(),
-            [patientId](Patient* p) { return p->getId() == patientId; });
-        if (it != queue->end()) {
-            Patient* patient = *it;
-            queue->erase(it);
-            rebuildHeap(*queue); 
-            patientTable.erase(patientId);
-            recordServiceCompletion(patient, time(0));
-            std::cout << "Emergency! Serving Patient " << patientId << " immediately.\n";
-            return patient;
-        }
-    }
-    std::cout << "Patient " << patientId << " not found in any queue.\n";
-    return nullptr;
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    std::unique_lock<std::mutex> laneLock;
+    QueueEntry* entry = lockEntryLane(patientId, laneLock);
+    if (!entry) {
+        if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+            trace->write(TraceRecord::serveById(clockNow(), patientId, false, 0));
+        }
+        HQ_LOG(INFO, LogEvent::PATIENT_NOT_FOUND, patientId);
+        return nullptr;
+    }
+    PatientHandle handle = removeEntry(entry);
+    time_t serviceTime = clockNow();
+    journalRecord(JournalRecord::serve(patientId, serviceTime, pool.priorityScore(handle)));
+    laneLock.unlock();
+    Patient* patient = recordServiceCompletion(handle, serviceTime);
+    if (TraceWriter* trace = tracer.load(std::memory_order_acquire)) {
+        trace->write(TraceRecord::serveById(serviceTime, patientId, true, serviceTime - patient->getArrivalTime()));
+    }
+    HQ_LOG(INFO, LogEvent::EMERGENCY_SERVED, patientId);
+    return patient;
+}
+
+bool QueueManager::removePatientById(int patientId) {
+    std::shared_lock<std::shared_mutex> gate(snapshotGate);
+    std::unique_lock<std::mutex> laneLock;
+    QueueEntry* entry = lockEntryLane(patientId, laneLock);
+    TraceWriter* trace = tracer.load(std::memory_order_acquire);
+    if (!entry) {
+        if (trace) {
+            trace->write(TraceRecord::remove(clockNow(), patientId, false));
+        }
+        return false;
+    }
+    PatientHandle handle = removeEntry(entry);
+    journalRecord(JournalRecord::remove(patientId));
+    laneLock.unlock();
+    pool.release(handle);
+    if (trace) {
+        trace->write(TraceRecord::remove(clockNow(), patientId, true));
+    }
+    HQ_LOG(INFO, LogEvent::PATIENT_REMOVED, patientId);
+    return true;
+}
+
+// Admissions, serves, removals, redirects and ticks reach a trace as the
+// calls that caused them; visits and admin changes have no call of their
+// own there and are recorded as their journal records.
+void QueueManager::journalRecord(const JournalRecord& record) {
+    if (journal.isOpen()) {
+        journal.append(record);
+    }
+    TraceWriter* trace = tracer.load(std::memory_order_acquire);
+    if (trace && record.op != JournalOp::ADMIT && record.op != JournalOp::SERVE && record.op != JournalOp::REMOVE &&
+        record.op != JournalOp::REDIRECT && record.op != JournalOp::TICK) {
+        trace->write(TraceRecord::journalChange(clockNow(), record));
+    }
+}
+
+void QueueManager::setTraceWriter(TraceWriter* writer) {
+    tracer.store(writer, std::memory_order_release);
+}
+
+// Rebuilds the queues, visit counts, history and admin settings from the
+// journal at path, then keeps appending to it. Returns the number of records
+// replayed, or -1 if the journal cannot be opened. Call before serving.
+long long QueueManager::openJournal(const std::string& path) {
+    return recover("", path);
+}
+
+// As openJournal, but starts from the snapshot at snapshotPath when there is
+// one and replays only the journal records written after it. Snapshots
+// taken later (writeSnapshot, setSnapshotInterval) go to the same path.
+// Returns -1 if the journal cannot be opened or is missing records that no
+// snapshot covers. Call on a new QueueManager, before serving.
+long long QueueManager::recover(const std::string& snapshotPath, const std::string& journalPath) {
+    stopSnapshotter();
+    journal.close();
+    this->snapshotPath = snapshotPath;
+
+    unsigned long long from = 0;
+    {
+        Snapshot snapshot;
+        if (!snapshotPath.empty() && snapshot.open(snapshotPath)) {
+            restoreSnapshot(snapshot);
+            from = snapshot.getHeader().journalOffset;
+        }
+    }
+    snapshotOffset = from;
+
+    long long replayed = Journal::replay(journalPath, from, [this](const JournalRecord& record) { applyJournalRecord(record); });
+    if (replayed < 0 || !journal.open(journalPath, from)) {
+        return -1;
+    }
+    return replayed;
+}
+
+// Waits until every change so far is on disk. Returns false if the journal
+// could not write or fsync them; it stays failed until reopened.
+bool QueueManager::syncJournal() {
+    return journal.sync();
+}
+
+void QueueManager::applyJournalRecord(const JournalRecord& record) {
+    switch (record.op) {
+    case JournalOp::ADMIT: {
+        // The lane it went to, not the one its name resolves to now: an
+        // admission that looked up its lane just before a type with its name
+        // was registered is journaled after the registration.
+        ServiceTypeId typeId = (record.typeId >= 0 && record.typeId < serviceTypes->size())
+            ? record.typeId : resolveServiceType(record.name);
+        float score;
+        admitPatient(record.patientId, record.urgency, record.name, typeId, record.time, record.countsVisit, score);
+        break;
+    }
+    case JournalOp::SERVE:
+    case JournalOp::REMOVE: {
+        std::unique_lock<std::mutex> laneLock;
+        QueueEntry* entry = lockEntryLane(record.patientId, laneLock);
+        if (!entry) {
+            break;
+        }
+        PatientHandle handle = removeEntry(entry);
+        laneLock.unlock();
+        if (record.op == JournalOp::REMOVE) {
+            pool.release(handle);
+            break;
+        }
+        pool.priorityScore(handle) = record.score;
+        recordServiceCompletion(handle, record.time);
+        break;
+    }
+    case JournalOp::VISIT:
+        incrementVisitCount(record.patientId);
+        break;
+    case JournalOp::REDIRECT: {
+        if (record.typeId >= serviceTypes->size() || record.toTypeId >= serviceTypes->size()) {
+            break;
+        }
+        std::scoped_lock lock(lanes[record.toTypeId].lock, lanes[record.typeId].lock);
+        if (lanes[record.toTypeId].empty() && !lanes[record.typeId].empty()) {
+            moveQueue(lanes[record.typeId], lanes[record.toTypeId]);
+        }
+        break;
+    }
+    case JournalOp::WEIGHTS:
+        reconfigure([&]() { engine->setWeights(record.weights[0], record.weights[1], record.weights[2]); });
+        break;
+    case JournalOp::SERVICE_TYPE:
+        reconfigure([&]() { engine->setServiceTypeScore(record.name, record.score); });
+        break;
+    case JournalOp::POLICY:
+        reconfigure([&]() { engine->usePolicyNamed(record.name); });
+        break;
+    case JournalOp::FAIRNESS:
+        setFairnessParams(record.limit, record.score);
+        break;
+    case JournalOp::SCORING_MODE:
+        setScoringMode(static_cast<ScoringMode>(record.limit));
+        break;
+    case JournalOp::RETENTION:
+        // Records from before format 3 carry no time.
+        applyHistoryRetention(record.limit, record.maxRecords, record.time != 0 ? record.time : clockNow());
+        break;
+    case JournalOp::SCORE_OVERRIDE:
+        overridePatientScore(record.patientId, record.score, &record.time);
+        break;
+    case JournalOp::TICK:
+        updatePriorities(record.time);
+        break;
+    }
+}
+
+// Writes a point-in-time snapshot to the recovery path, then drops the
+// journal records it covers. Serving pauses only while the state is copied
+// out; the file is written and synced after every lock is released.
+bool QueueManager::writeSnapshot() {
+    std::lock_guard<std::mutex> writer(snapshotWriteMutex);
+    if (snapshotPath.empty()) {
+        return false;
+    }
+    SnapshotState state;
+    captureSnapshot(state);
+
+    // A snapshot must never be ahead of the durable journal, or a crash
+    // could leave a journal whose new records sort before the snapshot.
+    if (!journal.sync()) {
+        return false;
+    }
+    if (!Snapshot::write(snapshotPath, state)) {
+        return false;
+    }
+    snapshotOffset = state.journalOffset;
+    if (journal.isOpen()) {
+        journal.discardBefore(state.journalOffset);
+    }
+    return true;
+}
+
+// Every `seconds`, snapshots if anything was journaled since the last
+// snapshot. Zero turns periodic snapshots off.
+void QueueManager::setSnapshotInterval(int seconds) {
+    stopSnapshotter();
+    if (seconds <= 0) {
+        return;
+    }
+    snapshotIntervalSeconds = seconds;
+    snapshotterStopping = false;
+    snapshotter = std::thread(&QueueManager::snapshotLoop, this);
+}
+
+void QueueManager::snapshotLoop() {
+    std::unique_lock<std::mutex> guard(snapshotterMutex);
+    while (!snapshotterWake.wait_for(guard, std::chrono::seconds(snapshotIntervalSeconds),
+        [this]() { return snapshotterStopping; })) {
+        guard.unlock();
+        if (journal.isOpen() && journal.position() != snapshotOffset) {
+            writeSnapshot();
+        }
+        guard.lock();
+    }
+}
+
+void QueueManager::stopSnapshotter() {
+    if (!snapshotter.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(snapshotterMutex);
+        snapshotterStopping = true;
+    }
+    snapshotterWake.notify_all();
+    snapshotter.join();
+}
+
+// Copies everything a snapshot holds into plain records. Holding the gate
+// exclusively means no operation is half done, and the lane locks keep
+// ticks from changing the queues being copied. History can be up to a
+// million records, so only its size and rollups are taken under the gate:
+// eviction is then held off, which keeps the first `retained` records
+// exactly as they were, and they are copied once serving has resumed.
+// Anything served meanwhile is appended after them and left to the journal.
+void QueueManager::captureSnapshot(SnapshotState& state) {
+    std::unique_lock<std::shared_mutex> gate(snapshotGate);
+    auto locks = lockAllLanes();
+    int laneCount = static_cast<int>(locks.size());
+    state.journalOffset = journal.isOpen() ? journal.position() : 0;
+
+    SnapshotSettings& settings = state.settings;
+    settings = SnapshotSettings();
+    settings.anchorTime = anchorTime;
+    settings.currentTime = currentTime;
+    PolicyWeights weights = engine->currentWeights();
+    settings.weights[0] = weights.urgency;
+    settings.weights[1] = weights.waitTime;
+    settings.weights[2] = weights.serviceType;
+    settings.serviceTypeCount = laneCount;
+    for (int i = 0; i < laneCount; i++) {
+        settings.serviceTypeScores[i] = engine->getServiceTypeScore(i);
+        state.names.push_back(serviceTypes->nameOf(i));
+    }
+    settings.maxWaitTime = maxWaitTime;
+    settings.boostMultiplier = boostMultiplier;
+    settings.scoringMode = static_cast<int>(scoringMode);
+    std::strncpy(settings.policyName, engine->getPolicyName(), sizeof(settings.policyName) - 1);
+
+    // A patient's service-type name is its lane's name unless it was queued
+    // under an unregistered type; those names go after the registered ones.
+    std::unordered_map<std::string, unsigned int> otherNames;
+    auto toRecord = [&](PatientHandle handle) {
+        Patient* patient = pool.get(handle);
+        SnapshotPatient record = SnapshotPatient();
+        record.arrivalTime = static_cast<long long>(patient->getArrivalTime());
+        record.serviceTime = static_cast<long long>(patient->getServiceTime());
+        record.id = patient->getId();
+        record.urgency = patient->getUrgency();
+        record.serviceTypeId = patient->getServiceTypeId();
+        record.priorityScore = patient->getPriorityScore();
+        record.staticScore = patient->getStaticScore();
+        record.waitRate = patient->getWaitRate();
+
+        const std::string& name = patient->getServiceType();
+        if (record.serviceTypeId >= 0 && record.serviceTypeId < laneCount && name == state.names[record.serviceTypeId]) {
+            record.nameIndex = record.serviceTypeId;
+        }
+        else {
+            auto it = otherNames.emplace(name, static_cast<unsigned int>(state.names.size())).first;
+            if (it->second == state.names.size()) {
+                state.names.push_back(name);
+            }
+            record.nameIndex = it->second;
+        }
+        return record;
+    };
+
+    size_t waitingCount = 0;
+    for (int i = 0; i < laneCount; i++) {
+        waitingCount += lanes[i].waiting.size() + lanes[i].boosted.size();
+    }
+    state.waiting.reserve(waitingCount);
+    for (int i = 0; i < laneCount; i++) {
+        const std::vector<PatientHandle>* heaps[] = { &lanes[i].waiting, &lanes[i].boosted };
+        for (int boosted = 0; boosted < 2; boosted++) {
+            for (auto handle : *heaps[boosted]) {
+                SnapshotPatient record = toRecord(handle);
+                record.lane = static_cast<unsigned char>(i);
+                record.boosted = static_cast<unsigned char>(boosted);
+                state.waiting.push_back(record);
+            }
+        }
+    }
+
+    for (int i = 0; i < TABLE_SHARDS; i++) {
+        std::lock_guard<std::mutex> guard(patientTable[i].lock);
+        patientTable[i].visits.forEach([&](int patientId, int count) {
+            state.visits.push_back(SnapshotVisits{ patientId, count });
+        });
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(historyMutex);
+        HistoryRetention retention = serviceHistory.getRetention();
+        settings.retentionHours = retention.hours;
+        settings.retentionMaxRecords = retention.maxRecords;
+        for (const auto& day : serviceHistory.getRollups()) {
+            SnapshotRollup rollup = SnapshotRollup();
+            rollup.dayStart = static_cast<long long>(day.dayStart);
+            rollup.waitMinutes = day.waitMinutes;
+            rollup.served = day.served;
+            std::memcpy(rollup.servedByType, day.servedByType, sizeof(rollup.servedByType));
+            state.rollups.push_back(rollup);
+        }
+        serviceHistory.pin();
+        historyPinned = true;
+    }
+    locks.clear();
+    gate.unlock();
+
+    std::vector<PatientHandle> served;
+    {
+        std::lock_guard<std::mutex> guard(historyMutex);
+        served = serviceHistory.pinned();
+    }
+    // Served records never change, and none is released while pinned.
+    state.history.reserve(served.size());
+    for (auto handle : served) {
+        state.history.push_back(toRecord(handle));
+    }
+
+    std::vector<PatientHandle> evicted;
+    {
+        std::lock_guard<std::mutex> guard(historyMutex);
+        evicted = unpinHistory();
+    }
+    releaseAll(evicted);
+}
+
+// Reads a mapped snapshot straight into the pool, lanes and history in one
+// pass per section. Waiting patients come back with their heap keys in heap
+// order, and history arrives in service-time order, so nothing is re-scored
+// or re-sorted. Expects an empty QueueManager.
+void QueueManager::restoreSnapshot(const Snapshot& snapshot) {
+    const SnapshotSettings& settings = snapshot.getHeader().settings;
+    std::vector<std::string> names(snapshot.getHeader().sections[SNAPSHOT_NAMES].count);
+    for (size_t i = 0; i < names.size(); i++) {
+        names[i] = snapshot.nameAt(static_cast<unsigned int>(i));
+    }
+
+    for (int i = 0; i < settings.serviceTypeCount; i++) {
+        engine->setServiceTypeScore(names[i], settings.serviceTypeScores[i]);
+    }
+    engine->setWeights(settings.weights[0], settings.weights[1], settings.weights[2]);
+    engine->usePolicyNamed(std::string(settings.policyName, strnlen(settings.policyName, sizeof(settings.policyName))));
+
+    auto locks = lockAllLanes();
+    int laneCount = static_cast<int>(locks.size());
+    maxWaitTime = settings.maxWaitTime;
+    boostMultiplier = settings.boostMultiplier;
+    scoringMode = static_cast<ScoringMode>(settings.scoringMode);
+    if (scoringMode == ScoringMode::ARRIVAL_ANCHORED && !engine->hasSharedWaitSlope()) {
+        scoringMode = ScoringMode::RECOMPUTE;
+    }
+    anchorTime = static_cast<time_t>(settings.anchorTime);
+    currentTime = static_cast<time_t>(settings.currentTime);
+
+    for (const SnapshotVisits& visits : snapshot.visits()) {
+        TableShard& shard = shardFor(visits.patientId);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.visits.set(visits.patientId, visits.count);
+    }
+
+    for (const SnapshotPatient& record : snapshot.waiting()) {
+        if (record.lane >= laneCount) {
+            continue;
+        }
+        Lane& lane = lanes[record.lane];
+        PatientHandle handle = restorePatient(record, names);
+        QueueEntry* entry = reserveEntry(lane, handle);
+        if (!entry) {
+            pool.release(handle);
+            continue;
+        }
+        entry->boosted = record.boosted != 0;
+        heapOf(*entry).push_back(handle);
+        lane.count++;
+        if (scoringMode == ScoringMode::ARRIVAL_ANCHORED && !entry->boosted) {
+            std::lock_guard<std::mutex> guard(arrivalMutex);
+            unboostedByArrival.insert({ static_cast<time_t>(record.arrivalTime), record.id });
+        }
+    }
+    // The stored order is already a heap. It is kept exactly rather than
+    // re-heapified, since make_heap may reorder equal scores, and ties must
+    // be served in the order the live queue would have served them.
+    for (int i = 0; i < laneCount; i++) {
+        for (std::vector<PatientHandle>* heap : { &lanes[i].waiting, &lanes[i].boosted }) {
+            for (int slot = 0; slot < static_cast<int>(heap->size()); slot++) {
+                pool.heapIndex((*heap)[slot]) = slot;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(historyMutex);
+    HistoryRetention retention;
+    retention.hours = settings.retentionHours;
+    retention.maxRecords = settings.retentionMaxRecords;
+    serviceHistory.setRetention(retention);
+    for (const SnapshotPatient& record : snapshot.history()) {
+        PatientHandle handle = restorePatient(record, names);
+        serviceHistory.record(handle, static_cast<time_t>(record.serviceTime), record.serviceTypeId,
+            pool.get(handle)->getTotalWaitTimeMinutes());
+    }
+    for (const SnapshotRollup& rollup : snapshot.rollups()) {
+        HistoryRollup day = {};
+        day.dayStart = static_cast<time_t>(rollup.dayStart);
+        day.served = rollup.served;
+        day.waitMinutes = rollup.waitMinutes;
+        std::memcpy(day.servedByType, rollup.servedByType, sizeof(day.servedByType));
+        serviceHistory.restoreRollup(day);
+    }
+}
+
+PatientHandle QueueManager::restorePatient(const SnapshotPatient& record, const std::vector<std::string>& names) {
+    static const std::string unnamed;
+    const std::string& name = record.nameIndex < names.size() ? names[record.nameIndex] : unnamed;
+    PatientHandle handle = pool.allocate(record.id, record.urgency, name, record.serviceTypeId);
+    Patient* patient = pool.get(handle);
+    patient->setArrivalTime(static_cast<time_t>(record.arrivalTime));
+    patient->setServiceTime(static_cast<time_t>(record.serviceTime));
+    patient->setScoreParts(record.staticScore, record.waitRate);
+    patient->setPriorityScore(record.priorityScore);
+    return handle;
 }
\ No newline at end of file
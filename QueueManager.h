@@ -1,66 +1,334 @@
 #ifndef QUEUEMANAGER_H
 #define QUEUEMANAGER_H
 
+#include "Clock.h"
 #include "Patient.h"
 #include "PriorityEngine.h"
+#include "PatientPool.h"
+#include "ServiceTypeRegistry.h"
+#include "ServiceHistory.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "Trace.h"
+#include "VisitCounter.h"
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <set>
+#include <utility>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
 #include <ctime>
 
+enum class ScoringMode {
+    RECOMPUTE,
+    ARRIVAL_ANCHORED
+};
+
+// A lane's pair of heaps is named by a QueueId that travels with the heaps
+// when a redirect hands them to another lane, so the patients in them never
+// need updating; QueueManager maps each QueueId to the lane holding it.
+typedef int QueueId;
+
+// Where a waiting patient currently sits: which heaps and which of the two.
+// The slot within the heap is the pool's heapIndex column, which every swap
+// keeps current, so lookups by ID never scan a lane.
+struct QueueEntry {
+    Patient* patient;
+    PatientHandle handle;
+    QueueId queue;
+    bool boosted;
+};
+
+// In RECOMPUTE mode every patient lives in `waiting`. In ARRIVAL_ANCHORED mode
+// `waiting` holds patients below the fairness limit and `boosted` those past
+// it; each heap is keyed by a score that does not change while time passes.
+// Heaps hold pool handles and compare the pool's packed score column.
+struct Lane {
+    std::vector<PatientHandle> waiting;
+    std::vector<PatientHandle> boosted;
+    QueueId queue;
+    std::mutex lock;
+    std::atomic<int> count{ 0 };
+
+    bool empty() const { return waiting.empty() && boosted.empty(); }
+    int size() const { return static_cast<int>(waiting.size() + boosted.size()); }
+};
+
+// patientTable and the visit counts are split into shards so that threads
+// working on different patients rarely contend on the same mutex.
+struct TableShard {
+    std::mutex lock;
+    std::unordered_map<int, QueueEntry> entries;
+    VisitCounter visits;
+};
+
+// One patient for QueueManager::addPatients. An arrivalTime of 0 means now.
+struct PatientArrival {
+    int patientId;
+    int urgency;
+    std::string serviceType;
+    time_t arrivalTime;
+};
+
+typedef int CounterId;
+
+// A service counter and the lanes it draws from, most preferred first.
+// patientId is the patient being served, IDLE, or DISPATCHING while a
+// patient is being chosen for it; name and lanes never change once the
+// counter is registered.
+struct ServiceCounter {
+    static const int IDLE = -1;
+    static const int DISPATCHING = -2;
+
+    std::string name;
+    std::vector<ServiceTypeId> lanes;
+    std::atomic<int> patientId{ IDLE };
+    std::atomic<long long> busySince{ 0 };
+    std::atomic<int> served{ 0 };
+};
+
+struct CounterStatus {
+    std::string name;
+    bool busy;
+    int patientId;
+    time_t busySince;
+    int served;
+};
+
+// Owns every Patient record, waiting or served, through its PatientPool.
+// Pointers returned by serveNextPatient, serveNext, servePatientById and the
+// history queries are views into that pool; callers must not delete them. A
+// served record stays valid until history retention evicts it, after which
+// its slot is reused.
+//
+// There is one lane per registered service type, indexed by ServiceTypeId;
+// lower IDs are served first. serveNextPatient models a single server that
+// takes over emptied lanes; registered counters (addCounter) instead each
+// draw from their own lanes, and only lock the lane they take a patient from.
+//
+// Thread-safe: any number of threads may add and serve patients at once.
+// Each lane has its own lock; operations spanning lanes take them in ID
+// order. A lane lock is always taken before a table shard lock, and shard,
+// history and arrival locks are never held while taking another lock.
+//
+// With a journal open (openJournal or recover), every change to the queues,
+// visit counts, history or admin settings is appended to it while the locks
+// that order the change are held; the journal's own lock is a leaf lock.
+// Each public operation that changes state holds snapshotGate shared from
+// start to finish, so a snapshot, which takes it exclusively, always sees
+// a state that matches a journal position. It is taken before any lane lock.
+// A trace writer (setTraceWriter), like the journal, only takes a leaf lock.
 class QueueManager {
 private:
+    static const int TABLE_SHARDS = 64;
+    static const int MAX_COUNTERS = 64;
+
     PriorityEngine* engine;
+    ServiceTypeRegistry* serviceTypes;
+    PatientPool pool;
 
-    std::vector<Patient*> emergencyQueue;
-    std::vector<Patient*> criticalQueue;
-    std::vector<Patient*> checkupQueue;
-    std::unordered_map<int, Patient*> patientTable;
+    Lane lanes[ServiceTypeRegistry::MAX_TYPES];
+    // Changed only while holding the locks of both lanes involved.
+    std::atomic<Lane*> queueOwners[ServiceTypeRegistry::MAX_TYPES];
+    mutable TableShard patientTable[TABLE_SHARDS];
 
     int maxWaitTime;
     float boostMultiplier;
 
-    std::vector<Patient*> serviceHistory;
+    // Every timestamp the queue takes itself (arrivals, service times,
+    // retention cut-offs) comes from here.
+    std::atomic<Clock*> clock;
+
+    ScoringMode scoringMode;
+    time_t anchorTime;
+    time_t currentTime;
+    std::set<std::pair<time_t, int>> unboostedByArrival;
+    std::mutex arrivalMutex;
+
+    ServiceHistory serviceHistory;
+    std::mutex historyMutex;
+    // While a snapshot copies history out, eviction waits, so the records it
+    // is copying keep their pool slots; guarded by historyMutex.
+    bool historyPinned;
+    bool compactionDeferred;
+    time_t deferredCompactionTime;
+
+    ServiceCounter counters[MAX_COUNTERS];
+    std::atomic<int> counterCount;
+    std::mutex counterMutex;
+    std::atomic<long long> redirectCount;
+
+    ScoreBatch scoreScratch;
+    Journal journal;
+    // Null unless a session is being recorded; see setTraceWriter.
+    std::atomic<TraceWriter*> tracer;
+
+    std::shared_mutex snapshotGate;
+    std::mutex snapshotWriteMutex;
+    std::string snapshotPath;
+    std::atomic<unsigned long long> snapshotOffset;
+    std::thread snapshotter;
+    std::mutex snapshotterMutex;
+    std::condition_variable snapshotterWake;
+    bool snapshotterStopping;
+    int snapshotIntervalSeconds;
+
+    void heapifyUp(std::vector<PatientHandle>& heap, int index);
+    void heapifyDown(std::vector<PatientHandle>& heap, int index);
+    void rebuildHeap(std::vector<PatientHandle>& heap);
+    void swapSlots(std::vector<PatientHandle>& heap, int a, int b);
+    void restoreHeapAt(std::vector<PatientHandle>& heap, int index);
+    void moveQueue(Lane& from, Lane& to);
+    void redirectLane(ServiceTypeId from, ServiceTypeId to);
+    void redirectHeldLane(ServiceTypeId from, ServiceTypeId to);
+    void redirectEmptyLanes();
+    void redirectHeldLanes(int laneCount);
+    std::vector<std::unique_lock<std::mutex>> lockAllLanes();
+    std::vector<std::unique_lock<std::mutex>> lockLanes(int count);
 
-    std::unordered_map<int, int> patientVisitCount;
+    void insertIntoQueue(Lane& lane, QueueEntry* entry, bool boosted = false, bool heapify = true);
+    void heapifyAppended(std::vector<PatientHandle>& heap, size_t firstNew);
+    void restoreRescoredHeap(std::vector<PatientHandle>& heap, size_t firstNew,
+        const std::vector<PatientHandle>& changed);
+    void removeFromQueue(QueueEntry* entry);
+    void removeSlot(Lane& lane, std::vector<PatientHandle>& heap, int index);
+    Lane& laneOf(const QueueEntry& entry) const;
+    std::vector<PatientHandle>& heapOf(const QueueEntry& entry);
 
-    void heapifyUp(std::vector<Patient*>& heap, int index);
-    void heapifyDown(std::vector<Patient*>& heap, int index);
-    void rebuildHeap(std::vector<Patient*>& heap);
+    TableShard& shardFor(int patientId) const;
+    QueueEntry* entryFor(PatientHandle handle);
+    QueueEntry* reserveEntry(Lane& lane, PatientHandle handle);
+    QueueEntry* lockEntryLane(int patientId, std::unique_lock<std::mutex>& laneLock);
 
-    std::vector<Patient*>& getQueueByType(const std::string& serviceType);
+    bool admitPatient(int patientId, int urgency, const std::string& serviceType, ServiceTypeId typeId,
+        time_t arrivalTime, bool countsVisit, float& score);
+    void admitToLane(Lane& lane, QueueEntry* entry, bool heapify = true);
+    void countVisit(QueueEntry& entry);
+    int bumpVisitCount(int patientId);
+    PatientHandle takeFromLane(Lane& lane);
+    PatientHandle takeForService(Lane& lane, time_t serviceTime);
+    Patient* assignNextPatient(CounterId id);
+    PatientHandle removeEntry(QueueEntry* entry);
+    PatientHandle retireEntry(PatientHandle handle, bool boosted);
+    void rekeyEntry(QueueEntry& entry);
+    void rekeyAllPatients(int laneCount);
+    time_t clockNow() const;
+    void rescoreWaitingPatients(int laneCount, time_t now);
+    int patientCount(int laneCount);
+    float scoreWithFairnessBoost(Patient* patient, time_t now);
+    void printLane(const std::string& name, Lane& lane);
+
+    bool isPastFairnessLimit(Patient* patient, time_t now) const;
+    float anchoredKey(Patient* patient, bool boosted);
+    float anchoredSlope(bool boosted) const;
+    float liveScore(Patient* patient, bool boosted) const;
+    void promoteCrossedPatients(time_t now);
+
+    ServiceTypeId resolveServiceType(const std::string& serviceType);
+    std::vector<PatientHandle> compactHistory(time_t now);
+    std::vector<PatientHandle> unpinHistory();
+    Patient* recordServiceCompletion(PatientHandle handle, time_t serviceTime);
+    void recordServiceCompletions(const std::vector<PatientHandle>& handles, time_t serviceTime,
+        std::vector<Patient*>& served);
+    void releaseAll(const std::vector<PatientHandle>& handles);
+    std::vector<Patient*> toPatients(const std::vector<PatientHandle>& handles) const;
+
+    void applyReconfiguration(const std::function<void()>& change, const JournalRecord* record);
+    void journalRecord(const JournalRecord& record);
+    bool overridePatientScore(int patientId, float score, const time_t* scoredAt);
+    void setEntryScore(QueueEntry& entry, float score, time_t asOf);
+    void applyHistoryRetention(int hours, int maxRecords, time_t now);
+
+    void captureSnapshot(SnapshotState& state);
+    void restoreSnapshot(const Snapshot& snapshot);
+    PatientHandle restorePatient(const SnapshotPatient& record, const std::vector<std::string>& names);
+    void snapshotLoop();
+    void stopSnapshotter();
 
 public:
     QueueManager(PriorityEngine* engine);
     ~QueueManager();
+    QueueManager(const QueueManager&) = delete;
+    QueueManager& operator=(const QueueManager&) = delete;
 
-    void addPatient(Patient* patient);
+    void addPatient(int id, int urgency, const std::string& serviceType);
+    int addPatients(const std::vector<PatientArrival>& arrivals, bool countVisits = true);
     Patient* serveNextPatient();
-    Patient* servePatientById(int patientId); 
+    int serveNext(int n, std::vector<Patient*>& served);
+    Patient* servePatientById(int patientId);
+    bool removePatientById(int patientId);
+    bool updatePatientScore(int patientId, float newScore);
+    bool rescorePatient(int patientId, time_t currentTime);
     void updatePriorities(time_t currentTime);
 
     void mergeQueues();
+    // Lane redirects since the queue was created, from mergeQueues or from
+    // serving emptying a lane.
+    long long getRedirectCount() const;
     bool isQueueEmpty(const std::string& serviceType);
     int getQueueSize(const std::string& serviceType);
-    std::string getNextServiceType(); 
+    std::string getNextServiceType();
+    ServiceTypeId getNextServiceTypeId();
+    ServiceTypeRegistry& getServiceTypes();
 
     void printQueue();
     void printAllQueues();
 
+    CounterId addCounter(const std::string& name, const std::vector<std::string>& serviceTypes);
+    Patient* serveAtCounter(CounterId counter);
+    void finishService(CounterId counter);
+    std::vector<std::pair<CounterId, Patient*>> dispatchIdleCounters();
+    int getCounterCount() const;
+    CounterStatus getCounterStatus(CounterId counter) const;
+    void printCounters();
+
     void setFairnessParams(int maxWait, float boost);
+    bool setScoringMode(ScoringMode mode);
+    ScoringMode getScoringMode();
+    void setClock(Clock* clock);
+    Clock* getClock() const;
+    void reconfigure(const std::function<void()>& change);
+    void reconfigure(const std::function<void()>& change, const JournalRecord& record);
+
+    long long openJournal(const std::string& path);
+    long long recover(const std::string& snapshotPath, const std::string& journalPath);
+    bool syncJournal();
+    // Applies one journal record the way recovery does; trace replay uses it
+    // for recorded admin changes.
+    void applyJournalRecord(const JournalRecord& record);
+    bool writeSnapshot();
+    void setSnapshotInterval(int seconds);
+
+    // Records every public call that changes the queue to writer, with its
+    // outcome, until called again with nullptr. The writer must outlive the
+    // recording. Counter serving is not recorded.
+    void setTraceWriter(TraceWriter* writer);
 
     std::vector<Patient*> getServiceHistory(time_t startTime, time_t endTime);
     std::vector<Patient*> getServiceHistoryByPriority(float minPriority, float maxPriority);
     std::vector<Patient*> getServiceHistoryByQueueType(const std::string& queueType);
     std::vector<Patient*> getServiceHistoryByQueueType(const std::string& queueType, time_t startTime, time_t endTime);
-    void recordServiceCompletion(Patient* patient, time_t serviceTime);
+    int getServedCount(time_t startTime, time_t endTime);
+    int getServedCount(ServiceTypeId typeId, time_t startTime, time_t endTime);
+    double getAverageWaitMinutes(time_t startTime, time_t endTime);
+
+    void setHistoryRetention(int hours, int maxRecords);
+    HistoryRetention getHistoryRetention();
+    int getRetainedHistoryCount();
+    std::vector<HistoryRollup> getHistoryRollups();
 
-    void addPatientAtTime(Patient* patient, time_t timestamp);
+    void addPatientAtTime(int id, int urgency, const std::string& serviceType, time_t timestamp);
     std::string getQueueStatus();
 
     void incrementVisitCount(int patientId);
     int getVisitCount(int patientId) const;
     std::vector<int> getFrequentVisitors(int threshold) const;
+    std::vector<VisitCount> getTopVisitors(int k) const;
 };
 
 #endif
\ No newline at end of file
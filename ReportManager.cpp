@@ -134,7 +134,7 @@ void ReportManager::generateQueueTypeTimeReport(const std::string& queueType,
 }
 
 void ReportManager::generateFullReport(SortBy sortBy, SortOrder order) {
-    time_t now = time(0);
+    time_t now = queueManager->getClock()->now();
     time_t dayAgo = now - (24 * 60 * 60); 
 
     std::vector<Patient*> allPatients = queueManager->getServiceHistory(dayAgo, now);
@@ -243,12 +243,7 @@ void ReportManager::showReportMenu() {
         }
         case 3: {
             std::cout << "\nQueue Type Report\n";
-            std::cout << "Select queue type:\n";
-            std::cout << "1. Emergency\n2. Critical\n3. Checkup\n";
-            std::cout << "Choice (1-3): ";
-            int queueChoice = getIntInput(1, 3);
-            std::string queueTypes[] = { "Emergency", "Critical", "Checkup" };
-            std::string selectedQueue = queueTypes[queueChoice - 1];
+            std::string selectedQueue = selectQueueType();
 
             std::cout << "\nSort by:\n1. Entry Time\n2. Waiting Time\n3. Priority Score\n";
             std::cout << "Choice (1-3): ";
@@ -265,12 +260,7 @@ void ReportManager::showReportMenu() {
         }
         case 4: {
             std::cout << "\nQueue Type + Time Report\n";
-            std::cout << "Select queue type:\n";
-            std::cout << "1. Emergency\n2. Critical\n3. Checkup\n";
-            std::cout << "Choice (1-3): ";
-            int queueChoice = getIntInput(1, 3);
-            std::string queueTypes[] = { "Emergency", "Critical", "Checkup" };
-            std::string selectedQueue = queueTypes[queueChoice - 1];
+            std::string selectedQueue = selectQueueType();
 
             std::cout << "\nEnter start time:\n";
             time_t startTime = getTimeInput();
@@ -322,45 +312,38 @@ void ReportManager::showStatistics() {
     std::cout << "Average wait time: " << formatDuration(static_cast<int>(avgWait)) << "\n";
 
     if (totalServed > 0) {
-        time_t now = time(0);
+        time_t now = queueManager->getClock()->now();
         time_t dayAgo = now - (24 * 60 * 60);
-        std::vector<Patient*> recentPatients = queueManager->getServiceHistory(dayAgo, now);
+        std::cout << "Patients served (last 24h): " << queueManager->getServedCount(dayAgo, now) << "\n";
 
-        std::cout << "Patients served (last 24h): " << recentPatients.size() << "\n";
-
-        int emergency = 0, critical = 0, checkup = 0;
-        for (auto patient : recentPatients) {
-            if (patient->getServiceType() == "Emergency") emergency++;
-            else if (patient->getServiceType() == "Critical") critical++;
-            else if (patient->getServiceType() == "Checkup") checkup++;
+        const ServiceTypeRegistry& types = queueManager->getServiceTypes();
+        std::cout << "\nService Type Breakdown (24h):\n";
+        for (int i = 0; i < types.size(); i++) {
+            std::cout << "  " << types.nameOf(i) << ": " << queueManager->getServedCount(i, dayAgo, now) << "\n";
         }
+    }
 
-        std::cout << "\nService Type Breakdown (24h):\n";
-        std::cout << "  Emergency: " << emergency << "\n";
-        std::cout << "  Critical: " << critical << "\n";
-        std::cout << "  Checkup: " << checkup << "\n";
+    std::vector<HistoryRollup> rollups = queueManager->getHistoryRollups();
+    if (!rollups.empty()) {
+        int rolledUp = 0;
+        for (const auto& day : rollups) {
+            rolledUp += day.served;
+        }
+        std::cout << "\nOlder history (rolled up): " << rolledUp << " patients over "
+            << rollups.size() << " day(s), since " << formatTime(rollups.front().dayStart) << "\n";
     }
 }
 
 double ReportManager::getAverageWaitTime() {
-    time_t now = time(0);
+    time_t now = queueManager->getClock()->now();
     time_t weekAgo = now - (7 * 24 * 60 * 60); 
-    std::vector<Patient*> patients = queueManager->getServiceHistory(weekAgo, now);
-
-    if (patients.empty()) return 0.0;
-
-    int totalWaitTime = 0;
-    for (auto patient : patients) {
-        totalWaitTime += patient->getTotalWaitTimeMinutes();
-    }
-
-    return static_cast<double>(totalWaitTime) / patients.size();
+    return queueManager->getAverageWaitMinutes(weekAgo, now);
 }
 
 int ReportManager::getTotalPatientsServed() {
-    time_t now = time(0);
+    time_t now = queueManager->getClock()->now();
     time_t weekAgo = now - (7 * 24 * 60 * 60); 
-    return queueManager->getServiceHistory(weekAgo, now).size();
+    return queueManager->getServedCount(weekAgo, now);
 }
 
 int ReportManager::getIntInput(int min, int max) {
@@ -403,6 +386,17 @@ time_t ReportManager::getTimeInput() {
     std::cout << "Enter hours ago (0-168): ";
     int hoursAgo = getIntInput(0, 168); 
 
-    time_t now = time(0);
+    time_t now = queueManager->getClock()->now();
     return now - (hoursAgo * 60 * 60);
+}
+
+std::string ReportManager::selectQueueType() {
+    const ServiceTypeRegistry& types = queueManager->getServiceTypes();
+    int count = types.size();
+    std::cout << "Select queue type:\n";
+    for (int i = 0; i < count; i++) {
+        std::cout << i + 1 << ". " << types.nameOf(i) << "\n";
+    }
+    std::cout << "Choice (1-" << count << "): ";
+    return types.nameOf(getIntInput(1, count) - 1);
 }
\ No newline at end of file
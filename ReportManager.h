@@ -33,6 +33,7 @@ private:
     int getIntInput(int min, int max);
     float getFloatInput(float min, float max);
     time_t getTimeInput();
+    std::string selectQueueType();
     void displayPatients(const std::vector<Patient*>& patients, const std::string& title);
 
 public:
@@ -0,0 +1,115 @@
+#ifndef SCORINGPOLICIES_H
+#define SCORINGPOLICIES_H
+
+// Scoring policies for PriorityEngine. Each policy is a type with static
+// members, and PriorityEngine::usePolicy<Policy>() stores pointers to them,
+// so scoring one patient from scratch (calculatePriorityScore,
+// cacheScoreParts) makes an indirect call per part. Every policy scores as
+//
+//   staticScore(inputs) + waitSeconds * waitRate(inputs)
+//
+// so the two parts are cached per patient, and a tick or a scoreBatch is one
+// multiply-add on the cached parts that never calls into the policy. The
+// QueueManager fairness boost is added on top.
+//
+// A policy provides:
+//   NAME                 shown in the admin console
+//   SHARED_WAIT_SLOPE    true if waitRate is the same for every patient
+//                        (needed for arrival-anchored keys)
+//   waitSlope(weights)   that rate, when it is shared
+//   staticScore(inputs, weights), waitRate(inputs, weights)
+
+// What a policy knows about one patient, apart from how long it has waited.
+struct ScoreInputs {
+    int urgency;
+    float serviceScore;
+    int visits;
+};
+
+struct PolicyWeights {
+    float urgency;
+    float waitTime;
+    float serviceType;
+};
+
+inline float visitBonusFor(int visits) {
+    if (visits >= 25) {
+        return 2.0f;
+    } else if (visits >= 10) {
+        return 1.0f;
+    } else if (visits >= 5) {
+        return 0.5f;
+    }
+    return 0.0f;
+}
+
+// The original formula: weighted urgency, wait and service-type score plus
+// the frequent-visitor bonus.
+struct LinearPolicy {
+    static constexpr const char* NAME = "Linear (weighted sum)";
+    static const bool SHARED_WAIT_SLOPE = true;
+
+    static float waitSlope(const PolicyWeights& weights) {
+        return weights.waitTime;
+    }
+
+    static float staticScore(const ScoreInputs& in, const PolicyWeights& weights) {
+        return (in.urgency * weights.urgency)
+            + (in.serviceScore * weights.serviceType)
+            + visitBonusFor(in.visits);
+    }
+
+    static float waitRate(const ScoreInputs&, const PolicyWeights& weights) {
+        return weights.waitTime;
+    }
+};
+
+// Urgency first, then longest wait. One urgency level outranks any wait
+// under URGENCY_STEP seconds (about 11 days); weights are ignored.
+struct LexicographicPolicy {
+    static constexpr const char* NAME = "Lexicographic (urgency, then wait)";
+    static const bool SHARED_WAIT_SLOPE = true;
+    static constexpr float URGENCY_STEP = 1000000.0f;
+
+    static float waitSlope(const PolicyWeights&) {
+        return 1.0f;
+    }
+
+    static float staticScore(const ScoreInputs& in, const PolicyWeights&) {
+        return in.urgency * URGENCY_STEP;
+    }
+
+    static float waitRate(const ScoreInputs&, const PolicyWeights&) {
+        return 1.0f;
+    }
+};
+
+// Each urgency level has a target wait (its SLA). The score is the share of
+// that target already used, times ten, plus the weighted service-type score,
+// so a patient about to breach a short SLA overtakes one early in a long
+// one. Scores rise at different rates, so this policy cannot be anchored.
+struct TieredSlaPolicy {
+    static constexpr const char* NAME = "Tiered SLA (share of target wait used)";
+    static const bool SHARED_WAIT_SLOPE = false;
+
+    static int targetMinutes(int urgency) {
+        static const int targets[] = { 240, 240, 120, 60, 30, 10 };
+        if (urgency < 1) return targets[0];
+        if (urgency > 5) return targets[5];
+        return targets[urgency];
+    }
+
+    static float waitSlope(const PolicyWeights&) {
+        return 0.0f;
+    }
+
+    static float staticScore(const ScoreInputs& in, const PolicyWeights& weights) {
+        return in.serviceScore * weights.serviceType;
+    }
+
+    static float waitRate(const ScoreInputs& in, const PolicyWeights&) {
+        return 10.0f / (targetMinutes(in.urgency) * 60.0f);
+    }
+};
+
+#endif
\ No newline at end of file
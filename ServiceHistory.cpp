@@ -0,0 +1,235 @@
+#include "ServiceHistory.h"
+#include <algorithm>
+
+namespace {
+    const time_t SECONDS_PER_DAY = 24 * 60 * 60;
+}
+
+ServiceHistory::Index::Index() {
+    waitMinutesBefore.push_back(0);
+}
+
+// Service times arrive in order except when two counters finish within the
+// same second and record in the other order; those land in place. Returns
+// the position the record took.
+size_t ServiceHistory::Index::append(const Record& record, int waitMinutes) {
+    if (records.empty() || records.back().serviceTime <= record.serviceTime) {
+        records.push_back(record);
+        waitMinutesBefore.push_back(waitMinutesBefore.back() + waitMinutes);
+        return records.size() - 1;
+    }
+
+    auto pos = std::upper_bound(records.begin(), records.end(), record.serviceTime,
+        [](time_t t, const Record& r) { return t < r.serviceTime; });
+    size_t at = pos - records.begin();
+    records.insert(pos, record);
+    waitMinutesBefore.insert(waitMinutesBefore.begin() + at + 1, waitMinutesBefore[at] + waitMinutes);
+    for (size_t i = at + 2; i < waitMinutesBefore.size(); i++) {
+        waitMinutesBefore[i] += waitMinutes;
+    }
+    return at;
+}
+
+// Drops the oldest record and returns its wait minutes. The running totals
+// are differences, so the remaining ones need no adjusting.
+int ServiceHistory::Index::popFront() {
+    int waitMinutes = static_cast<int>(waitMinutesBefore[1] - waitMinutesBefore[0]);
+    records.pop_front();
+    waitMinutesBefore.pop_front();
+    return waitMinutes;
+}
+
+// Positions [first, second) of the records served within [startTime, endTime].
+std::pair<size_t, size_t> ServiceHistory::Index::range(time_t startTime, time_t endTime) const {
+    if (startTime > endTime) {
+        return { 0, 0 };
+    }
+    auto first = std::lower_bound(records.begin(), records.end(), startTime,
+        [](const Record& r, time_t t) { return r.serviceTime < t; });
+    auto last = std::upper_bound(first, records.end(), endTime,
+        [](time_t t, const Record& r) { return t < r.serviceTime; });
+    return { static_cast<size_t>(first - records.begin()), static_cast<size_t>(last - records.begin()) };
+}
+
+ServiceHistory::ServiceHistory() {
+    retention.hours = DEFAULT_RETENTION_HOURS;
+    retention.maxRecords = DEFAULT_MAX_RECORDS;
+    pinActive = false;
+    pinnedCount = 0;
+}
+
+void ServiceHistory::record(PatientHandle handle, time_t serviceTime, ServiceTypeId typeId, int waitMinutes) {
+    Record record = { serviceTime, handle, typeId };
+    size_t at = all.append(record, waitMinutes);
+    if (pinActive && at < pinnedCount) {
+        pinnedCount++;
+        insertedWhilePinned.push_back(handle);
+    }
+    if (typeId >= 0 && typeId < ServiceTypeRegistry::MAX_TYPES) {
+        byType[typeId].append(record, waitMinutes);
+    }
+}
+
+bool ServiceHistory::isExpired(const Record& oldest, time_t now) const {
+    if (retention.maxRecords > 0 && all.records.size() > static_cast<size_t>(retention.maxRecords)) {
+        return true;
+    }
+    return retention.hours > 0 && oldest.serviceTime < now - static_cast<time_t>(retention.hours) * 60 * 60;
+}
+
+void ServiceHistory::rollUp(const Record& record, int waitMinutes) {
+    time_t dayStart = record.serviceTime - record.serviceTime % SECONDS_PER_DAY;
+    auto it = rollups.find(dayStart);
+    if (it == rollups.end()) {
+        HistoryRollup fresh = {};
+        fresh.dayStart = dayStart;
+        it = rollups.emplace(dayStart, fresh).first;
+    }
+    HistoryRollup& day = it->second;
+    day.served++;
+    day.waitMinutes += waitMinutes;
+    if (record.typeId >= 0 && record.typeId < ServiceTypeRegistry::MAX_TYPES) {
+        day.servedByType[record.typeId]++;
+    }
+}
+
+// Folds every record past the retention limits into its day's rollup and
+// returns their handles, which the caller gives back to the pool. A record
+// is always the oldest of its type too, so the per-type index pops in step.
+std::vector<PatientHandle> ServiceHistory::compact(time_t now) {
+    std::vector<PatientHandle> evicted;
+    while (!all.records.empty() && isExpired(all.records.front(), now)) {
+        Record oldest = all.records.front();
+        rollUp(oldest, all.popFront());
+        if (oldest.typeId >= 0 && oldest.typeId < ServiceTypeRegistry::MAX_TYPES) {
+            byType[oldest.typeId].popFront();
+        }
+        evicted.push_back(oldest.handle);
+    }
+    return evicted;
+}
+
+void ServiceHistory::setRetention(const HistoryRetention& limits) {
+    retention = limits;
+}
+
+HistoryRetention ServiceHistory::getRetention() const {
+    return retention;
+}
+
+std::vector<PatientHandle> ServiceHistory::slice(const Index& index, size_t first, size_t last) {
+    std::vector<PatientHandle> handles;
+    handles.reserve(last - first);
+    for (size_t i = first; i < last; i++) {
+        handles.push_back(index.records[i].handle);
+    }
+    return handles;
+}
+
+void ServiceHistory::pin() {
+    pinActive = true;
+    pinnedCount = all.records.size();
+    insertedWhilePinned.clear();
+}
+
+// Records only ever join the pinned range out of order, so the ones to skip
+// are few; usually there are none.
+std::vector<PatientHandle> ServiceHistory::pinned() const {
+    if (insertedWhilePinned.empty()) {
+        return slice(all, 0, pinnedCount);
+    }
+    std::vector<PatientHandle> skipped(insertedWhilePinned);
+    std::sort(skipped.begin(), skipped.end());
+    std::vector<PatientHandle> handles;
+    handles.reserve(pinnedCount - skipped.size());
+    for (size_t i = 0; i < pinnedCount; i++) {
+        PatientHandle handle = all.records[i].handle;
+        if (!std::binary_search(skipped.begin(), skipped.end(), handle)) {
+            handles.push_back(handle);
+        }
+    }
+    return handles;
+}
+
+void ServiceHistory::unpin() {
+    pinActive = false;
+    pinnedCount = 0;
+    insertedWhilePinned.clear();
+}
+
+std::vector<PatientHandle> ServiceHistory::everything() const {
+    return slice(all, 0, all.records.size());
+}
+
+std::vector<PatientHandle> ServiceHistory::ofType(ServiceTypeId typeId) const {
+    if (typeId < 0 || typeId >= ServiceTypeRegistry::MAX_TYPES) {
+        return std::vector<PatientHandle>();
+    }
+    return slice(byType[typeId], 0, byType[typeId].records.size());
+}
+
+std::vector<PatientHandle> ServiceHistory::between(time_t startTime, time_t endTime) const {
+    auto bounds = all.range(startTime, endTime);
+    return slice(all, bounds.first, bounds.second);
+}
+
+std::vector<PatientHandle> ServiceHistory::ofTypeBetween(ServiceTypeId typeId, time_t startTime, time_t endTime) const {
+    if (typeId < 0 || typeId >= ServiceTypeRegistry::MAX_TYPES) {
+        return std::vector<PatientHandle>();
+    }
+    auto bounds = byType[typeId].range(startTime, endTime);
+    return slice(byType[typeId], bounds.first, bounds.second);
+}
+
+// Rolled-up days are only counted when the window covers the whole day.
+template <class Fn>
+void ServiceHistory::forRollupsWithin(time_t startTime, time_t endTime, Fn fn) const {
+    for (auto it = rollups.lower_bound(startTime); it != rollups.end(); ++it) {
+        if (it->first + SECONDS_PER_DAY - 1 > endTime) {
+            break;
+        }
+        fn(it->second);
+    }
+}
+
+int ServiceHistory::countBetween(time_t startTime, time_t endTime) const {
+    auto bounds = all.range(startTime, endTime);
+    int count = static_cast<int>(bounds.second - bounds.first);
+    forRollupsWithin(startTime, endTime, [&](const HistoryRollup& day) { count += day.served; });
+    return count;
+}
+
+int ServiceHistory::countOfTypeBetween(ServiceTypeId typeId, time_t startTime, time_t endTime) const {
+    if (typeId < 0 || typeId >= ServiceTypeRegistry::MAX_TYPES) {
+        return 0;
+    }
+    auto bounds = byType[typeId].range(startTime, endTime);
+    int count = static_cast<int>(bounds.second - bounds.first);
+    forRollupsWithin(startTime, endTime, [&](const HistoryRollup& day) { count += day.servedByType[typeId]; });
+    return count;
+}
+
+long long ServiceHistory::waitMinutesBetween(time_t startTime, time_t endTime) const {
+    auto bounds = all.range(startTime, endTime);
+    long long total = all.waitMinutesBefore[bounds.second] - all.waitMinutesBefore[bounds.first];
+    forRollupsWithin(startTime, endTime, [&](const HistoryRollup& day) { total += day.waitMinutes; });
+    return total;
+}
+
+int ServiceHistory::retainedCount() const {
+    return static_cast<int>(all.records.size());
+}
+
+std::vector<HistoryRollup> ServiceHistory::getRollups() const {
+    std::vector<HistoryRollup> days;
+    days.reserve(rollups.size());
+    for (const auto& day : rollups) {
+        days.push_back(day.second);
+    }
+    return days;
+}
+
+// For state read back from a snapshot; replaces any rollup of the same day.
+void ServiceHistory::restoreRollup(const HistoryRollup& day) {
+    rollups[day.dayStart] = day;
+}
\ No newline at end of file
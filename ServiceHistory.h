@@ -0,0 +1,106 @@
+#ifndef SERVICEHISTORY_H
+#define SERVICEHISTORY_H
+
+#include "PatientPool.h"
+#include "ServiceTypeRegistry.h"
+#include <vector>
+#include <deque>
+#include <map>
+#include <utility>
+#include <ctime>
+
+// How much detailed history to keep. Records older than `hours` or beyond
+// the newest `maxRecords` are folded into daily rollups and evicted; zero
+// disables that limit.
+struct HistoryRetention {
+    int hours;
+    int maxRecords;
+};
+
+// Totals for the evicted records of one UTC day.
+struct HistoryRollup {
+    time_t dayStart;
+    int served;
+    long long waitMinutes;
+    int servedByType[ServiceTypeRegistry::MAX_TYPES];
+};
+
+// Served patients in service-time order, with one sub-index per service
+// type, so a time-window query is a binary search plus a contiguous range.
+// Each index also keeps running totals of wait minutes, which makes window
+// counts and average waits O(log n) without touching the records.
+//
+// The indexes are segmented queues, so evicting the oldest records is O(1)
+// and memory stays flat once a retention limit is reached. Counts and wait
+// totals still include rolled-up days that lie wholly inside the window.
+// Not thread-safe; QueueManager guards it with historyMutex.
+class ServiceHistory {
+public:
+    // History is kept in full until a limit is set, so reports over any
+    // window see every served patient unless retention was chosen.
+    static const int DEFAULT_RETENTION_HOURS = 0;
+    static const int DEFAULT_MAX_RECORDS = 0;
+
+private:
+    struct Record {
+        time_t serviceTime;
+        PatientHandle handle;
+        ServiceTypeId typeId;
+    };
+
+    struct Index {
+        std::deque<Record> records;
+        std::deque<long long> waitMinutesBefore;
+
+        Index();
+        size_t append(const Record& record, int waitMinutes);
+        int popFront();
+        std::pair<size_t, size_t> range(time_t startTime, time_t endTime) const;
+    };
+
+    Index all;
+    Index byType[ServiceTypeRegistry::MAX_TYPES];
+    HistoryRetention retention;
+    std::map<time_t, HistoryRollup> rollups;
+    // While pinned, the records pinned() returns: the first pinnedCount in
+    // `all`, less the out-of-order ones recorded in among them since.
+    bool pinActive;
+    size_t pinnedCount;
+    std::vector<PatientHandle> insertedWhilePinned;
+
+    static std::vector<PatientHandle> slice(const Index& index, size_t first, size_t last);
+    bool isExpired(const Record& oldest, time_t now) const;
+    void rollUp(const Record& record, int waitMinutes);
+    template <class Fn>
+    void forRollupsWithin(time_t startTime, time_t endTime, Fn fn) const;
+
+public:
+    ServiceHistory();
+
+    void record(PatientHandle handle, time_t serviceTime, ServiceTypeId typeId, int waitMinutes);
+    std::vector<PatientHandle> compact(time_t now);
+    void setRetention(const HistoryRetention& limits);
+    HistoryRetention getRetention() const;
+
+    // pin() fixes the set of records a later pinned() returns, in
+    // service-time order, however many are recorded in between. Nothing may
+    // be compacted until unpin().
+    void pin();
+    std::vector<PatientHandle> pinned() const;
+    void unpin();
+
+    std::vector<PatientHandle> everything() const;
+    std::vector<PatientHandle> ofType(ServiceTypeId typeId) const;
+    std::vector<PatientHandle> between(time_t startTime, time_t endTime) const;
+    std::vector<PatientHandle> ofTypeBetween(ServiceTypeId typeId, time_t startTime, time_t endTime) const;
+
+    int countBetween(time_t startTime, time_t endTime) const;
+    int countOfTypeBetween(ServiceTypeId typeId, time_t startTime, time_t endTime) const;
+    long long waitMinutesBetween(time_t startTime, time_t endTime) const;
+
+    int retainedCount() const;
+    std::vector<HistoryRollup> getRollups() const;
+    void restoreRollup(const HistoryRollup& day);
+};
+
+#endif
\ No newline at end of file
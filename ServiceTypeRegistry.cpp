@@ -0,0 +1,45 @@
+#include "ServiceTypeRegistry.h"
+
+ServiceTypeRegistry::ServiceTypeRegistry() : count(0) {
+    registerType("Emergency");
+    registerType("Critical");
+    registerType("Checkup");
+}
+
+// Returns the existing ID for a known name, or -1 once MAX_TYPES is reached.
+ServiceTypeId ServiceTypeRegistry::registerType(const std::string& name) {
+    return registerType(name, [](ServiceTypeId) {});
+}
+
+ServiceTypeId ServiceTypeRegistry::registerType(const std::string& name,
+    const std::function<void(ServiceTypeId)>& initialize) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    int id = count;
+    if (id >= MAX_TYPES) {
+        return -1;
+    }
+    initialize(id);
+    names[id] = name;
+    ids[name] = id;
+    // Publish only after the name is written; readers index names[] lock-free.
+    count = id + 1;
+    return id;
+}
+
+ServiceTypeId ServiceTypeRegistry::find(const std::string& name) const {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = ids.find(name);
+    return (it != ids.end()) ? it->second : -1;
+}
+
+const std::string& ServiceTypeRegistry::nameOf(ServiceTypeId id) const {
+    return names[id];
+}
+
+int ServiceTypeRegistry::size() const {
+    return count;
+}
\ No newline at end of file
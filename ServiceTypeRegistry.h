@@ -0,0 +1,41 @@
+#ifndef SERVICETYPEREGISTRY_H
+#define SERVICETYPEREGISTRY_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+typedef int ServiceTypeId;
+
+// Interns service-type names to small dense IDs so lanes and score tables can
+// be plain arrays. Registration order is also serving order: Emergency,
+// Critical and Checkup are always 0, 1 and 2, and types added at runtime
+// rank below them. IDs are never reused or removed.
+class ServiceTypeRegistry {
+public:
+    static const int MAX_TYPES = 32;
+    static const ServiceTypeId EMERGENCY = 0;
+    static const ServiceTypeId CRITICAL = 1;
+    static const ServiceTypeId CHECKUP = 2;
+
+private:
+    std::string names[MAX_TYPES];
+    std::unordered_map<std::string, ServiceTypeId> ids;
+    std::atomic<int> count;
+    mutable std::mutex lock;
+
+public:
+    ServiceTypeRegistry();
+
+    ServiceTypeId registerType(const std::string& name);
+    // As above; a new type's ID is passed to initialize before any reader
+    // can find it, so tables indexed by ID can be filled in first.
+    ServiceTypeId registerType(const std::string& name, const std::function<void(ServiceTypeId)>& initialize);
+    ServiceTypeId find(const std::string& name) const;
+    const std::string& nameOf(ServiceTypeId id) const;
+    int size() const;
+};
+
+#endif
\ No newline at end of file
@@ -1,14 +1,39 @@
 #include "SimulationManager.h"
+#include "Logger.h"
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <stdexcept>
+#include <climits>
 
-SimulationManager::SimulationManager(QueueManager* qm) {
+SimulationManager::SimulationManager(QueueManager* qm) : clock(0) {
     this->queueManager = qm;
-    this->simulationStartTime = time(0);
+    this->running = nullptr;
+    this->simulationTime = 0;
+    this->simulationStartTime = 0;
+    this->headlessStartTime = DEFAULT_HEADLESS_START;
+    this->previousClock = nullptr;
+}
+
+// The queue goes back to the clock it had before the first run, and the
+// logger to the wall clock.
+SimulationManager::~SimulationManager() {
+    if (previousClock && queueManager->getClock() == &clock) {
+        queueManager->setClock(previousClock);
+    }
+    if (Logger::get().getClock() == &clock) {
+        Logger::get().setClock(nullptr);
+    }
+}
+
+void SimulationManager::installClock(time_t start) {
+    clock.set(start);
+    if (queueManager->getClock() != &clock) {
+        previousClock = queueManager->getClock();
+    }
+    queueManager->setClock(&clock);
+    Logger::get().setClock(&clock);
 }
 
 bool SimulationManager::loadSimulation(const std::string& filename) {
@@ -23,140 +48,401 @@ bool SimulationManager::loadSimulation(const std::string& filename) {
 }
 
 void SimulationManager::loadEventsFromJson(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    EventReader reader;
+    if (!reader.open(filename)) {
         throw std::runtime_error("Cannot open file: " + filename);
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    parseJsonEvents(buffer.str());
+    scenario.clear();
+    SimulationEvent event;
+    while (reader.next(event)) {
+        addEvent(event.timestamp, event.patientId, event.urgency, event.serviceType);
+    }
+    reportReadErrors(reader, filename);
+    if (reader.failed()) {
+        scenario.clear();
+        throw std::runtime_error(filename + " is not a usable simulation file");
+    }
 }
 
-void SimulationManager::parseJsonEvents(const std::string& jsonContent) {
-    events.clear();
+void SimulationManager::reportReadErrors(const EventReader& reader, const std::string& filename) {
+    for (const EventReadError& error : reader.getErrors()) {
+        std::cerr << filename << ": byte " << error.offset << ": " << error.message;
+        if (error.recordOffset >= 0) {
+            std::cerr << " (event at byte " << error.recordOffset << " skipped)";
+        }
+        std::cerr << "\n";
+    }
+    long long unlisted = reader.skippedCount() - static_cast<long long>(reader.getErrors().size())
+        + (reader.failed() ? 1 : 0);
+    if (unlisted > 0) {
+        std::cerr << filename << ": " << unlisted << " more malformed events skipped\n";
+    }
+}
 
-    std::istringstream iss(jsonContent);
-    std::string line;
+void SimulationManager::runSimulation() {
+    if (scenario.empty()) {
+        std::cout << "No simulation events loaded!\n";
+        return;
+    }
 
-    SimulationEvent currentEvent;
-    bool inEvent = false;
+    std::cout << "\n?? Starting simulation with " << scenario.size() << " events...\n";
+    std::cout << "================================================\n";
 
-    while (std::getline(iss, line)) {
-        line.erase(std::remove_if(line.begin(), line.end(), ::isspace), line.end());
+    EventQueue run = scenario;
+    running = &run;
+    simulationTime = 0;
+    simulationStartTime = time(0);
+    installClock(simulationStartTime);
+    beginStaffing();
+    const ServiceTypeRegistry& types = queueManager->getServiceTypes();
+    SimulationSummary summary;
+    long long currentMinute = 0;
+    ScheduledEvent event;
 
-        if (line.find("{") != std::string::npos) {
-            inEvent = true;
-            currentEvent = SimulationEvent();
-        }
-        else if (line.find("}") != std::string::npos && inEvent) {
-            events.push_back(currentEvent);
-            inEvent = false;
+    while (!run.empty()) {
+        advanceTo(run.top().time);
+        if (simulationTime / 60 > currentMinute) {
+            currentMinute = simulationTime / 60;
+            HQ_LOG(INFO, LogEvent::SIMULATION_TIME, 0, static_cast<int>(currentMinute));
         }
-        else if (inEvent) {
-            if (line.find("\"timestamp\":") != std::string::npos) {
-                size_t pos = line.find(":") + 1;
-                size_t end = line.find(",");
-                if (end == std::string::npos) end = line.length();
-                currentEvent.timestamp = std::stoi(line.substr(pos, end - pos));
+        time_t currentActualTime = simulationStartTime + simulationTime;
+
+        while (!run.empty() && run.top().time == simulationTime) {
+            run.pop(event);
+            if (event.kind != SimEventKind::ARRIVAL) {
+                dispatch(event, summary);
+                continue;
             }
-            else if (line.find("\"patientId\":") != std::string::npos) {
-                size_t pos = line.find(":") + 1;
-                size_t end = line.find(",");
-                if (end == std::string::npos) end = line.length();
-                currentEvent.patientId = std::stoi(line.substr(pos, end - pos));
+
+            HQ_LOG(INFO, LogEvent::SIMULATION_ARRIVAL, event.patientId, event.urgency, 0.0f, event.serviceType);
+
+            queueManager->addPatientAtTime(event.patientId, event.urgency, event.serviceType, currentActualTime);
+            // Per-lane sizes after every arrival are only worth their cost
+            // when verbose logging is on.
+            for (int i = 0; i < types.size(); i++) {
+                HQ_LOG(VERBOSE, LogEvent::QUEUE_SIZE, 0, queueManager->getQueueSize(types.nameOf(i)), 0.0f,
+                    types.nameOf(i));
             }
-            else if (line.find("\"urgency\":") != std::string::npos) {
-                size_t pos = line.find(":") + 1;
-                size_t end = line.find(",");
-                if (end == std::string::npos) end = line.length();
-                currentEvent.urgency = std::stoi(line.substr(pos, end - pos));
+        }
+
+        queueManager->updatePriorities(currentActualTime);
+        serveIdleCounters();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    finishStaffing();
+    running = nullptr;
+
+    Logger::get().flush();
+    std::cout << "\n? Simulation completed!\n";
+    if (staffing.enabled()) {
+        std::cout << "Served " << staffingReport.served << " patients; median wait "
+            << staffingReport.waitP50Minutes << " min, 90th percentile " << staffingReport.waitP90Minutes
+            << " min, " << staffingReport.redirects << " lane redirects\n";
+        queueManager->printCounters();
+    }
+    std::cout << "Final queue status:\n";
+    queueManager->printAllQueues();
+}
+
+SimulationSummary SimulationManager::runHeadless() {
+    return fastForward([](SimulationEvent&) { return false; }, false);
+}
+
+SimulationSummary SimulationManager::runHeadless(const std::string& filename) {
+    EventReader reader;
+    if (!reader.open(filename)) {
+        std::cerr << "Cannot open file: " << filename << std::endl;
+        SimulationSummary summary;
+        summary.startTime = headlessStartTime;
+        summary.endTime = headlessStartTime;
+        summary.complete = false;
+        return summary;
+    }
+    SimulationSummary summary = fastForward([&](SimulationEvent& event) { return reader.next(event); }, false);
+    summary.skipped = reader.skippedCount();
+    summary.complete = !reader.failed();
+    reportReadErrors(reader, filename);
+    return summary;
+}
+
+SimulationSummary SimulationManager::runHeadless(WorkloadGenerator& generator) {
+    return fastForward([&](SimulationEvent& event) { return generator.next(event); },
+        generator.getConfig().countVisits);
+}
+
+// Arrivals due at the same time, whether streamed or scheduled, are
+// admitted in one addPatients call with the clock set to that time; other
+// events due then are handled first, one at a time. Arrivals alone never
+// need a waiting patient's score before the end, since scores depend only
+// on the time they are computed at, so they are brought up to date once at
+// the end; staffing re-scores them at its own interval, and an event
+// handler that serves patients refreshes them itself.
+// Arrivals count as visits only if countVisits is set; scenario files are
+// admitted as addPatientAtTime would admit them, without.
+SimulationSummary SimulationManager::fastForward(const std::function<bool(SimulationEvent&)>& nextArrival,
+    bool countVisits) {
+    SimulationSummary summary;
+    summary.startTime = headlessStartTime;
+    summary.endTime = headlessStartTime;
+    EventQueue run = scenario;
+    SimulationEvent streamed;
+    bool haveStreamed = nextArrival(streamed);
+    if (!haveStreamed && run.empty()) {
+        return summary;
+    }
+
+    LogLevel level = Logger::get().getLevel();
+    if (level < LogLevel::WARNING) {
+        Logger::get().setLevel(LogLevel::WARNING);
+    }
+    running = &run;
+    simulationTime = 0;
+    simulationStartTime = headlessStartTime;
+    installClock(headlessStartTime);
+    beginStaffing();
+
+    std::vector<PatientArrival> group;
+    ScheduledEvent event;
+    while (haveStreamed || !run.empty()) {
+        long long streamedAt = haveStreamed ? static_cast<long long>(streamed.timestamp) * 60 : LLONG_MAX;
+        long long due = run.empty() ? streamedAt : std::min(streamedAt, run.top().time);
+        // Time never runs backwards; a late arrival keeps its own time.
+        advanceTo(due);
+        summary.endTime = headlessStartTime + simulationTime;
+
+        if (!run.empty() && run.top().time == due && run.top().kind != SimEventKind::ARRIVAL) {
+            run.pop(event);
+            dispatch(event, summary);
+            continue;
+        }
+
+        group.clear();
+        time_t arrivalTime = headlessStartTime + due;
+        while (true) {
+            if (haveStreamed && static_cast<long long>(streamed.timestamp) * 60 == due) {
+                group.push_back(PatientArrival{ streamed.patientId, streamed.urgency, streamed.serviceType, arrivalTime });
+                haveStreamed = nextArrival(streamed);
+            }
+            else if (!run.empty() && run.top().time == due && run.top().kind == SimEventKind::ARRIVAL) {
+                run.pop(event);
+                group.push_back(PatientArrival{ event.patientId, event.urgency, event.serviceType, arrivalTime });
             }
-            else if (line.find("\"serviceType\":") != std::string::npos) {
-                size_t start = line.find("\"", line.find(":")) + 1;
-                size_t end = line.find("\"", start);
-                currentEvent.serviceType = line.substr(start, end - start);
+            else {
+                break;
             }
         }
+        summary.arrivals += static_cast<int>(group.size());
+        summary.admitted += queueManager->addPatients(group, countVisits);
+        serveIdleCounters();
     }
+    queueManager->updatePriorities(summary.endTime);
+    finishStaffing();
+    running = nullptr;
 
-    std::sort(events.begin(), events.end(),
-        [](const SimulationEvent& a, const SimulationEvent& b) {
-            return a.timestamp < b.timestamp;
-        });
+    Logger::get().setLevel(level);
+    const ServiceTypeRegistry& types = queueManager->getServiceTypes();
+    for (int i = 0; i < types.size(); i++) {
+        summary.waiting += queueManager->getQueueSize(types.nameOf(i));
+    }
+    return summary;
 }
 
-void SimulationManager::runSimulation() {
-    if (events.empty()) {
-        std::cout << "No simulation events loaded!\n";
-        return;
+// Handles everything but arrivals, which each kind of run admits its own way.
+void SimulationManager::dispatch(const ScheduledEvent& event, SimulationSummary& summary) {
+    switch (event.kind) {
+    case SimEventKind::DEPARTURE:
+        if (queueManager->removePatientById(event.patientId)) {
+            summary.departed++;
+        }
+        break;
+    case SimEventKind::SERVICE_COMPLETE:
+        summary.completed++;
+        if (staffing.enabled()) {
+            servicesStarted.clear();
+            staffing.complete(*queueManager, event, simulationTime, servicesStarted);
+            scheduleServicesStarted();
+        }
+        break;
+    case SimEventKind::ARRIVAL:
+    case SimEventKind::TIMER:
+        break;
+    }
+    if (eventHandler) {
+        eventHandler(event);
     }
+}
 
-    std::cout << "\n?? Starting simulation with " << events.size() << " events...\n";
-    std::cout << "================================================\n";
+// Moves simulated time and the clock forward to `time`, stopping at each
+// of the staffing model's interval boundaries on the way.
+void SimulationManager::advanceTo(long long time) {
+    if (staffing.enabled()) {
+        for (long long boundary = staffing.nextBoundary(); boundary <= time; boundary = staffing.nextBoundary()) {
+            if (boundary > simulationTime) {
+                simulationTime = boundary;
+                clock.set(simulationStartTime + simulationTime);
+            }
+            staffing.boundary(*queueManager, boundary);
+        }
+    }
+    if (time > simulationTime) {
+        simulationTime = time;
+        clock.set(simulationStartTime + simulationTime);
+    }
+}
 
-    simulationStartTime = time(0);
-    int currentTime = 0;
-    size_t eventIndex = 0;
+void SimulationManager::beginStaffing() {
+    if (staffing.enabled()) {
+        staffing.begin(*queueManager, simulationStartTime, simulationTime);
+    }
+}
 
-    while (eventIndex < events.size()) {
-        SimulationEvent& event = events[eventIndex];
+void SimulationManager::serveIdleCounters() {
+    if (staffing.enabled()) {
+        servicesStarted.clear();
+        staffing.dispatch(*queueManager, simulationTime, servicesStarted);
+        scheduleServicesStarted();
+    }
+}
 
-        if (event.timestamp > currentTime) {
-            std::cout << "\n? Time: " << event.timestamp << " minutes\n";
-            currentTime = event.timestamp;
-        }
+void SimulationManager::scheduleServicesStarted() {
+    for (ScheduledEvent& completion : servicesStarted) {
+        schedule(std::move(completion));
+    }
+    servicesStarted.clear();
+}
 
-        while (eventIndex < events.size() && events[eventIndex].timestamp == currentTime) {
-            SimulationEvent& e = events[eventIndex];
+void SimulationManager::finishStaffing() {
+    if (staffing.enabled()) {
+        staffingReport = staffing.finish(*queueManager, simulationTime);
+    }
+}
 
-            Patient* patient = new Patient(e.patientId, e.urgency, e.serviceType);
-            time_t eventTime = simulationStartTime + (e.timestamp * 60);
+void SimulationManager::setStaffing(const StaffingConfig& config) {
+    staffing.configure(config);
+}
 
-            std::cout << "?? New Patient Arrival:\n";
-            std::cout << "   ID: " << e.patientId
-                << " | Urgency: " << e.urgency
-                << " | Type: " << e.serviceType << "\n";
+const StaffingReport& SimulationManager::getStaffingReport() const {
+    return staffingReport;
+}
 
-            queueManager->addPatientAtTime(patient, eventTime);
-            std::cout << "   Queue Status: " << queueManager->getQueueStatus() << "\n";
+// Groups events and advances time as fastForward does, writing each group
+// as one batch admission.
+long long SimulationManager::exportTrace(const std::string& jsonPath, const std::string& tracePath) {
+    EventReader reader;
+    if (!reader.open(jsonPath)) {
+        std::cerr << "Cannot open file: " << jsonPath << std::endl;
+        return -1;
+    }
+    TraceWriter writer;
+    if (!writer.open(tracePath)) {
+        std::cerr << "Cannot create file: " << tracePath << std::endl;
+        return -1;
+    }
 
-            eventIndex++;
+    long long written = 0;
+    time_t now = headlessStartTime;
+    std::vector<TraceRecord> group;
+    SimulationEvent event;
+    bool haveEvent = reader.next(event);
+    while (haveEvent) {
+        int timestamp = event.timestamp;
+        time_t eventTime = headlessStartTime + (static_cast<time_t>(timestamp) * 60);
+        if (eventTime > now) {
+            now = eventTime;
         }
 
-        time_t currentActualTime = simulationStartTime + (currentTime * 60);
-        queueManager->updatePriorities(currentActualTime);
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        group.assign(1, TraceRecord());
+        while (haveEvent && event.timestamp == timestamp) {
+            group.push_back(TraceRecord::arrival(now, event.patientId, event.urgency, event.serviceType, eventTime));
+            haveEvent = reader.next(event);
+        }
+        group[0] = TraceRecord::addBatch(now, static_cast<int>(group.size()) - 1, false);
+        writer.write(group);
+        written += static_cast<long long>(group.size()) - 1;
     }
+    if (written > 0) {
+        writer.write(TraceRecord::updatePriorities(now, now));
+    }
+    writer.close();
 
-    std::cout << "\n? Simulation completed!\n";
-    std::cout << "Final queue status:\n";
-    queueManager->printAllQueues();
+    reportReadErrors(reader, jsonPath);
+    return reader.failed() ? -1 : written;
+}
+
+void SimulationManager::setHeadlessStartTime(time_t start) {
+    headlessStartTime = start;
 }
 
 void SimulationManager::addEvent(int timestamp, int patientId, int urgency, const std::string& serviceType) {
-    SimulationEvent event;
-    event.timestamp = timestamp;
-    event.patientId = patientId;
-    event.urgency = urgency;
-    event.serviceType = serviceType;
+    scheduleArrival(static_cast<long long>(timestamp) * 60, patientId, urgency, serviceType);
+}
 
-    events.push_back(event);
+void SimulationManager::schedule(ScheduledEvent&& event) {
+    if (running) {
+        event.time = std::max(event.time, simulationTime);
+        running->push(std::move(event));
+    }
+    else {
+        scenario.push(std::move(event));
+    }
+}
 
-    std::sort(events.begin(), events.end(),
-        [](const SimulationEvent& a, const SimulationEvent& b) {
-            return a.timestamp < b.timestamp;
-        });
+void SimulationManager::scheduleArrival(long long time, int patientId, int urgency, const std::string& serviceType) {
+    schedule(ScheduledEvent::arrival(time, patientId, urgency, serviceType));
+}
+
+void SimulationManager::scheduleServiceCompletion(long long time, int counter, int patientId) {
+    schedule(ScheduledEvent::serviceComplete(time, counter, patientId));
+}
+
+void SimulationManager::scheduleDeparture(long long time, int patientId) {
+    schedule(ScheduledEvent::departure(time, patientId));
+}
+
+void SimulationManager::scheduleTimer(long long time, int timerId) {
+    schedule(ScheduledEvent::timer(time, timerId));
+}
+
+void SimulationManager::setEventHandler(const std::function<void(const ScheduledEvent&)>& handler) {
+    eventHandler = handler;
+}
+
+long long SimulationManager::getSimulationTime() const {
+    return simulationTime;
+}
+
+size_t SimulationManager::getScheduledCount() const {
+    return running ? running->size() : scenario.size();
 }
 
 void SimulationManager::printEvents() {
     std::cout << "\n?? Simulation Events:\n";
     std::cout << "=====================\n";
 
-    for (const auto& event : events) {
-        std::cout << "Time " << event.timestamp << "min: Patient "
-            << event.patientId << " (" << event.serviceType
-            << ", Urgency " << event.urgency << ")\n";
+    EventQueue ordered = scenario;
+    ScheduledEvent event;
+    while (!ordered.empty()) {
+        ordered.pop(event);
+        std::cout << "Time " << event.time / 60 << "min";
+        if (event.time % 60 != 0) {
+            std::cout << " " << event.time % 60 << "s";
+        }
+        switch (event.kind) {
+        case SimEventKind::ARRIVAL:
+            std::cout << ": Patient " << event.patientId << " (" << event.serviceType
+                << ", Urgency " << event.urgency << ")\n";
+            break;
+        case SimEventKind::SERVICE_COMPLETE:
+            std::cout << ": Counter " << event.tag << " finishes Patient " << event.patientId << "\n";
+            break;
+        case SimEventKind::DEPARTURE:
+            std::cout << ": Patient " << event.patientId << " leaves if still waiting\n";
+            break;
+        case SimEventKind::TIMER:
+            std::cout << ": Timer " << event.tag << "\n";
+            break;
+        }
     }
 }
\ No newline at end of file
@@ -1,44 +1,130 @@
 #ifndef SIMULATIONMANAGER_H
 #define SIMULATIONMANAGER_H
 
+#include "Clock.h"
+#include "EventQueue.h"
+#include "EventReader.h"
 #include "QueueManager.h"
+#include "StaffingModel.h"
+#include "Trace.h"
+#include "WorkloadGenerator.h"
 #include "Patient.h"
 #include <vector>
 #include <string>
 #include <ctime>
+#include <functional>
 
-struct SimulationEvent {
-    int timestamp = 0;      
-    int patientId = -1;    
-    int urgency = 0;      
-    std::string serviceType = ""; 
-
-    SimulationEvent() = default;
-
-    SimulationEvent(int ts, int pid, int urg, const std::string& st)
-        : timestamp(ts), patientId(pid), urgency(urg), serviceType(st) {
-    }
+// What a headless run did, in virtual time.
+struct SimulationSummary {
+    int arrivals = 0;
+    int admitted = 0;
+    int waiting = 0;
+    time_t startTime = 0;
+    time_t endTime = 0;
+    // Malformed events left out, and whether the input was read to the end.
+    long long skipped = 0;
+    bool complete = true;
+    // Departure events that found the patient still waiting, and service
+    // completions handled.
+    long long departed = 0;
+    long long completed = 0;
 };
 
-
+// Runs a scenario of scheduled events against a QueueManager. Events are
+// kept in a future-event queue in time order; each run works on its own
+// copy, so a scenario can be run again, and anything scheduled during a run
+// (from the event handler, say) goes into that run only. With staffing
+// set, counters serve patients as the run goes. While a run is in
+// progress and until the manager is destroyed, the queue and the logger
+// read time from the manager's virtual clock, so arrival stamps, service
+// times, reports and log records all agree on simulated time.
 class SimulationManager {
 private:
     QueueManager* queueManager;
-    std::vector<SimulationEvent> events;
+    EventQueue scenario;
+    EventQueue* running;
+    long long simulationTime;
     time_t simulationStartTime;
+    time_t headlessStartTime;
+    VirtualClock clock;
+    Clock* previousClock;
+    std::function<void(const ScheduledEvent&)> eventHandler;
+    StaffingModel staffing;
+    StaffingReport staffingReport;
+    std::vector<ScheduledEvent> servicesStarted;
 
     void loadEventsFromJson(const std::string& filename);
-    void parseJsonEvents(const std::string& jsonContent);
+    void reportReadErrors(const EventReader& reader, const std::string& filename);
+    void schedule(ScheduledEvent&& event);
+    void dispatch(const ScheduledEvent& event, SimulationSummary& summary);
+    void advanceTo(long long time);
+    void beginStaffing();
+    void serveIdleCounters();
+    void scheduleServicesStarted();
+    void finishStaffing();
+    void installClock(time_t start);
+    SimulationSummary fastForward(const std::function<bool(SimulationEvent&)>& nextArrival, bool countVisits);
 
 public:
+    // Headless runs start here unless told otherwise: 2024-01-01 00:00 UTC.
+    static const time_t DEFAULT_HEADLESS_START = 1704067200;
+
     SimulationManager(QueueManager* qm);
+    ~SimulationManager();
 
     bool loadSimulation(const std::string& filename);
 
+    // Paced for watching: logs every arrival and pauses between timestamps.
+    // Virtual time starts at the wall clock.
     void runSimulation();
+    // Fast-forward: no pauses and no per-event logging, with virtual time
+    // starting at a fixed instant so the same events give the same result on
+    // every run.
+    SimulationSummary runHeadless();
+    // As above, streaming arrivals from a JSON file without loading them
+    // first, alongside any events already scheduled. The file should be in
+    // timestamp order; an event earlier than one already admitted is
+    // admitted late, with its own arrival time.
+    SimulationSummary runHeadless(const std::string& filename);
+    // As above, with arrivals drawn from the generator as they are needed,
+    // so a run of any length uses constant memory. The generator is read to
+    // the end; reset() it to run the same scenario again.
+    SimulationSummary runHeadless(WorkloadGenerator& generator);
+    void setHeadlessStartTime(time_t start);
 
+    // Converts a JSON scenario into a trace of the calls runHeadless(filename)
+    // would make for it, so it can be replayed with TraceReplayer. Returns
+    // the number of events written, or -1 if either file cannot be used.
+    long long exportTrace(const std::string& jsonPath, const std::string& tracePath);
+
+    // An arrival `timestamp` minutes into the run.
     void addEvent(int timestamp, int patientId, int urgency, const std::string& serviceType);
 
+    // Times below are in seconds from the start of the run. Outside a run
+    // they add to the scenario; during one they add to the current run,
+    // and a time already past means now. Each is O(log n).
+    void scheduleArrival(long long time, int patientId, int urgency, const std::string& serviceType);
+    void scheduleServiceCompletion(long long time, int counter, int patientId);
+    // The patient leaves unserved (a no-show) if still waiting by then.
+    void scheduleDeparture(long long time, int patientId);
+    void scheduleTimer(long long time, int timerId);
+
+    // Serves patients in later runs: each counter takes the next patient
+    // when it frees up, for a service time drawn for that patient's service
+    // type, and schedules the completion as an event. Idle counters are
+    // given patients after every arrival. Without staffing (the default)
+    // patients only wait.
+    void setStaffing(const StaffingConfig& config);
+    // What the counters did in the last staffed run.
+    const StaffingReport& getStaffingReport() const;
+
+    // Called for every event other than an arrival, after the manager has
+    // handled it, with the clock at the event's time. It may schedule more.
+    void setEventHandler(const std::function<void(const ScheduledEvent&)>& handler);
+    // Seconds since the start of the current or last run.
+    long long getSimulationTime() const;
+    size_t getScheduledCount() const;
+
     void printEvents();
 };
 
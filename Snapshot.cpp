@@ -0,0 +1,179 @@
+#include "Snapshot.h"
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
+
+static_assert(sizeof(SnapshotPatient) == 48, "snapshot patient layout changed");
+static_assert(sizeof(SnapshotVisits) == 8, "snapshot visits layout changed");
+static_assert(sizeof(SnapshotRollup) == 152, "snapshot rollup layout changed");
+static_assert(sizeof(SnapshotSettings) == 216, "snapshot settings layout changed");
+static_assert(sizeof(SnapshotHeader) == 344, "snapshot header layout changed");
+
+namespace {
+    const char MAGIC[4] = { 'H', 'Q', 'S', '1' };
+    const size_t ALIGNMENT = 8;
+    const size_t CRC_START = offsetof(SnapshotHeader, reserved);
+    const size_t ITEM_SIZES[SNAPSHOT_SECTION_COUNT] = {
+        sizeof(SnapshotName), 1, sizeof(SnapshotPatient), sizeof(SnapshotVisits),
+        sizeof(SnapshotPatient), sizeof(SnapshotRollup)
+    };
+
+    size_t aligned(size_t size) {
+        return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    unsigned int headerCrc(const SnapshotHeader& header) {
+        const char* bytes = reinterpret_cast<const char*>(&header);
+        return FileIO::crc32(bytes + CRC_START, sizeof(SnapshotHeader) - CRC_START);
+    }
+
+    // Sections are written back to back in SnapshotSectionId order, each
+    // padded to the alignment.
+    struct SectionWriter {
+        int fd;
+        bool ok;
+
+        bool write(const void* data, size_t size) {
+            static const char padding[ALIGNMENT] = {};
+            ok = ok && FileIO::writeAll(fd, static_cast<const char*>(data), size);
+            ok = ok && FileIO::writeAll(fd, padding, aligned(size) - size);
+            return ok;
+        }
+    };
+}
+
+Snapshot::Snapshot() {
+    this->header = nullptr;
+}
+
+bool Snapshot::write(const std::string& path, const SnapshotState& state) {
+    std::vector<SnapshotName> names;
+    std::string chars;
+    names.reserve(state.names.size());
+    for (const auto& name : state.names) {
+        names.push_back(SnapshotName{ static_cast<unsigned int>(chars.size()), static_cast<unsigned int>(name.size()) });
+        chars += name;
+    }
+
+    SnapshotHeader header = SnapshotHeader();
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.journalOffset = state.journalOffset;
+    header.createdAt = static_cast<long long>(time(0));
+    header.settings = state.settings;
+
+    const size_t counts[SNAPSHOT_SECTION_COUNT] = {
+        names.size(), chars.size(), state.waiting.size(), state.visits.size(),
+        state.history.size(), state.rollups.size()
+    };
+    size_t offset = aligned(sizeof(SnapshotHeader));
+    for (int i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        header.sections[i].offset = offset;
+        header.sections[i].count = counts[i];
+        offset += aligned(counts[i] * ITEM_SIZES[i]);
+    }
+    header.headerCrc = headerCrc(header);
+
+    std::string temporary = path + ".tmp";
+    int fd = FileIO::createForWrite(temporary);
+    if (fd < 0) {
+        return false;
+    }
+    SectionWriter out = { fd, true };
+    out.write(&header, sizeof(header));
+    out.write(names.data(), names.size() * sizeof(SnapshotName));
+    out.write(chars.data(), chars.size());
+    out.write(state.waiting.data(), state.waiting.size() * sizeof(SnapshotPatient));
+    out.write(state.visits.data(), state.visits.size() * sizeof(SnapshotVisits));
+    out.write(state.history.data(), state.history.size() * sizeof(SnapshotPatient));
+    out.write(state.rollups.data(), state.rollups.size() * sizeof(SnapshotRollup));
+    bool ok = out.ok && FileIO::syncFile(fd);
+    FileIO::closeFile(fd);
+
+    if (!ok || !FileIO::replaceFile(temporary, path)) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// A missing file, a bad header or a section running past the end of the
+// file all leave the snapshot closed.
+bool Snapshot::open(const std::string& path) {
+    close();
+    if (!file.open(path) || file.size() < sizeof(SnapshotHeader)) {
+        close();
+        return false;
+    }
+    const SnapshotHeader* candidate = reinterpret_cast<const SnapshotHeader*>(file.data());
+    if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0 || candidate->version != FORMAT_VERSION ||
+        candidate->headerCrc != headerCrc(*candidate)) {
+        close();
+        return false;
+    }
+
+    for (int i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        const SnapshotSectionEntry& entry = candidate->sections[i];
+        if (entry.offset % ALIGNMENT != 0 || entry.offset > file.size() ||
+            entry.count > (file.size() - entry.offset) / ITEM_SIZES[i]) {
+            close();
+            return false;
+        }
+    }
+    if (candidate->settings.serviceTypeCount < 0 ||
+        candidate->settings.serviceTypeCount > ServiceTypeRegistry::MAX_TYPES ||
+        static_cast<size_t>(candidate->settings.serviceTypeCount) > candidate->sections[SNAPSHOT_NAMES].count) {
+        close();
+        return false;
+    }
+    header = candidate;
+    return true;
+}
+
+void Snapshot::close() {
+    file.close();
+    header = nullptr;
+}
+
+bool Snapshot::isOpen() const {
+    return header != nullptr;
+}
+
+const SnapshotHeader& Snapshot::getHeader() const {
+    return *header;
+}
+
+template <class T>
+SnapshotSection<T> Snapshot::section(SnapshotSectionId id) const {
+    const SnapshotSectionEntry& entry = header->sections[id];
+    SnapshotSection<T> span = { reinterpret_cast<const T*>(file.data() + entry.offset), static_cast<size_t>(entry.count) };
+    return span;
+}
+
+// An index or span outside the table gives an empty name.
+std::string Snapshot::nameAt(unsigned int index) const {
+    SnapshotSection<SnapshotName> names = section<SnapshotName>(SNAPSHOT_NAMES);
+    SnapshotSection<char> chars = section<char>(SNAPSHOT_NAME_CHARS);
+    if (index >= names.count || names.items[index].offset > chars.count ||
+        names.items[index].length > chars.count - names.items[index].offset) {
+        return std::string();
+    }
+    return std::string(chars.items + names.items[index].offset, names.items[index].length);
+}
+
+SnapshotSection<SnapshotPatient> Snapshot::waiting() const {
+    return section<SnapshotPatient>(SNAPSHOT_WAITING);
+}
+
+SnapshotSection<SnapshotVisits> Snapshot::visits() const {
+    return section<SnapshotVisits>(SNAPSHOT_VISITS);
+}
+
+SnapshotSection<SnapshotPatient> Snapshot::history() const {
+    return section<SnapshotPatient>(SNAPSHOT_HISTORY);
+}
+
+SnapshotSection<SnapshotRollup> Snapshot::rollups() const {
+    return section<SnapshotRollup>(SNAPSHOT_ROLLUPS);
+}
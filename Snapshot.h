@@ -0,0 +1,146 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "FileIO.h"
+#include "ServiceTypeRegistry.h"
+#include <vector>
+#include <string>
+
+// The on-disk layout is these structs as laid out in memory, so a mapped
+// snapshot is read in place. Every field has a fixed size and every section
+// starts 8-byte aligned; the static_asserts in Snapshot.cpp pin the sizes.
+
+// One patient, waiting or served. Waiting patients are stored lane by lane
+// in heap order with their heap keys, so they restore without re-scoring.
+struct SnapshotPatient {
+    long long arrivalTime;
+    long long serviceTime;
+    int id;
+    int urgency;
+    int serviceTypeId;
+    unsigned int nameIndex;
+    float priorityScore;
+    float staticScore;
+    float waitRate;
+    unsigned char lane;
+    unsigned char boosted;
+    unsigned short reserved;
+};
+
+struct SnapshotVisits {
+    int patientId;
+    int count;
+};
+
+struct SnapshotRollup {
+    long long dayStart;
+    long long waitMinutes;
+    int served;
+    int servedByType[ServiceTypeRegistry::MAX_TYPES];
+    int reserved;
+};
+
+// A span of the name table's character section.
+struct SnapshotName {
+    unsigned int offset;
+    unsigned int length;
+};
+
+// Admin settings and the scoring clock. Service types are names[0..count),
+// registered in ID order.
+struct SnapshotSettings {
+    long long anchorTime;
+    long long currentTime;
+    float weights[3];
+    float serviceTypeScores[ServiceTypeRegistry::MAX_TYPES];
+    int serviceTypeCount;
+    int maxWaitTime;
+    float boostMultiplier;
+    int scoringMode;
+    int retentionHours;
+    int retentionMaxRecords;
+    int reserved;
+    char policyName[32];
+};
+
+enum SnapshotSectionId {
+    SNAPSHOT_NAMES,
+    SNAPSHOT_NAME_CHARS,
+    SNAPSHOT_WAITING,
+    SNAPSHOT_VISITS,
+    SNAPSHOT_HISTORY,
+    SNAPSHOT_ROLLUPS,
+    SNAPSHOT_SECTION_COUNT
+};
+
+struct SnapshotSectionEntry {
+    unsigned long long offset;
+    unsigned long long count;
+};
+
+// headerCrc covers every header byte after it.
+struct SnapshotHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int headerCrc;
+    unsigned int reserved;
+    unsigned long long journalOffset;
+    long long createdAt;
+    SnapshotSettings settings;
+    SnapshotSectionEntry sections[SNAPSHOT_SECTION_COUNT];
+};
+
+// QueueManager state captured for writing: the header fields plus each
+// section's records.
+struct SnapshotState {
+    unsigned long long journalOffset;
+    SnapshotSettings settings;
+    std::vector<std::string> names;
+    std::vector<SnapshotPatient> waiting;
+    std::vector<SnapshotVisits> visits;
+    std::vector<SnapshotPatient> history;
+    std::vector<SnapshotRollup> rollups;
+};
+
+template <class T>
+struct SnapshotSection {
+    const T* items;
+    size_t count;
+
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+};
+
+// A point-in-time image of QueueManager state, versioned and fixed-layout.
+// write() goes through a temporary file, fsync and rename, so a reader only
+// ever sees a complete snapshot. open() maps the file and checks the header
+// and section bounds; the accessors then point straight into the mapping.
+class Snapshot {
+public:
+    static const unsigned int FORMAT_VERSION = 1;
+
+private:
+    MappedFile file;
+    const SnapshotHeader* header;
+
+    template <class T>
+    SnapshotSection<T> section(SnapshotSectionId id) const;
+
+public:
+    Snapshot();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    const SnapshotHeader& getHeader() const;
+    std::string nameAt(unsigned int index) const;
+    SnapshotSection<SnapshotPatient> waiting() const;
+    SnapshotSection<SnapshotVisits> visits() const;
+    SnapshotSection<SnapshotPatient> history() const;
+    SnapshotSection<SnapshotRollup> rollups() const;
+
+    static bool write(const std::string& path, const SnapshotState& state);
+};
+
+#endif
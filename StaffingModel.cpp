@@ -0,0 +1,326 @@
+#include "StaffingModel.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+ServiceTimeDistribution ServiceTimeDistribution::fixed(double minutes) {
+    ServiceTimeDistribution distribution;
+    distribution.shape = ServiceTimeShape::FIXED;
+    distribution.meanMinutes = minutes;
+    distribution.variation = 0.0;
+    return distribution;
+}
+
+ServiceTimeDistribution ServiceTimeDistribution::exponential(double meanMinutes) {
+    ServiceTimeDistribution distribution;
+    distribution.shape = ServiceTimeShape::EXPONENTIAL;
+    distribution.meanMinutes = meanMinutes;
+    distribution.variation = 1.0;
+    return distribution;
+}
+
+ServiceTimeDistribution ServiceTimeDistribution::lognormal(double meanMinutes, double variation) {
+    ServiceTimeDistribution distribution;
+    distribution.shape = ServiceTimeShape::LOGNORMAL;
+    distribution.meanMinutes = meanMinutes;
+    distribution.variation = variation;
+    return distribution;
+}
+
+StaffingConfig StaffingConfig::evenStaffing(unsigned long long seed, int countersPerLane) {
+    StaffingConfig config;
+    config.seed = seed;
+    config.lanes = {
+        { "Emergency", countersPerLane, ServiceTimeDistribution::lognormal(20.0, 0.8) },
+        { "Critical", countersPerLane, ServiceTimeDistribution::lognormal(15.0, 0.6) },
+        { "Checkup", countersPerLane, ServiceTimeDistribution::lognormal(8.0, 0.5) }
+    };
+    return config;
+}
+
+namespace {
+
+// Nearest-rank percentile of sorted waits in seconds, in minutes.
+double percentileMinutes(const std::vector<int>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[rank > 0 ? rank - 1 : 0] / 60.0;
+}
+
+}
+
+StaffingModel::StaffingModel() {
+    this->state = 0;
+    this->origin = 0;
+    this->startTime = 0;
+    this->redirectBaseline = 0;
+    this->nextSample = LLONG_MAX;
+    this->nextRescore = LLONG_MAX;
+}
+
+void StaffingModel::configure(const StaffingConfig& config) {
+    this->config = config;
+    counters.clear();
+}
+
+bool StaffingModel::enabled() const {
+    if (config.floatingCounters > 0) {
+        return true;
+    }
+    for (const LaneStaffing& lane : config.lanes) {
+        if (lane.counters > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const StaffingConfig& StaffingModel::getConfig() const {
+    return config;
+}
+
+// Same generator as WorkloadGenerator, for the same reason: <random>'s
+// distributions differ between standard libraries.
+unsigned long long StaffingModel::nextRandom() {
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// In [0, 1).
+double StaffingModel::uniform() {
+    return static_cast<double>(nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// At least a second, so a completion always comes after its service began.
+long long StaffingModel::drawServiceSeconds(ServiceTypeId typeId) {
+    const ServiceTimeDistribution& distribution =
+        (typeId >= 0 && typeId < static_cast<int>(serviceTimes.size())) ? serviceTimes[typeId] : config.defaultServiceTime;
+    double mean = distribution.meanMinutes * 60.0;
+    if (mean <= 0.0) {
+        return 1;
+    }
+
+    double seconds = mean;
+    switch (distribution.shape) {
+    case ServiceTimeShape::FIXED:
+        break;
+    case ServiceTimeShape::EXPONENTIAL:
+        seconds = -mean * std::log(1.0 - uniform());
+        break;
+    case ServiceTimeShape::LOGNORMAL: {
+        // Box-Muller for the underlying normal.
+        double sigma2 = std::log(1.0 + distribution.variation * distribution.variation);
+        double mu = std::log(mean) - sigma2 / 2.0;
+        double normal = std::sqrt(-2.0 * std::log(1.0 - uniform())) * std::cos(6.283185307179586 * uniform());
+        seconds = std::exp(mu + std::sqrt(sigma2) * normal);
+        break;
+    }
+    }
+    return std::max(1LL, std::llround(seconds));
+}
+
+void StaffingModel::begin(QueueManager& queue, time_t origin, long long now) {
+    const ServiceTypeRegistry& types = queue.getServiceTypes();
+    this->state = config.seed;
+    this->origin = origin;
+    this->startTime = now;
+    serviceTimes.assign(types.size(), config.defaultServiceTime);
+    counters.clear();
+
+    for (const LaneStaffing& lane : config.lanes) {
+        ServiceTypeId typeId = types.find(lane.serviceType);
+        if (typeId < 0) {
+            continue;
+        }
+        serviceTimes[typeId] = lane.serviceTime;
+        for (int n = 1; n <= lane.counters; n++) {
+            std::string name = lane.serviceType + " counter " + std::to_string(n);
+            CounterId id = -1;
+            for (int i = 0; i < queue.getCounterCount() && id < 0; i++) {
+                if (queue.getCounterStatus(i).name == name) {
+                    id = i;
+                }
+            }
+            if (id < 0) {
+                id = queue.addCounter(name, { lane.serviceType });
+            }
+            if (id < 0) {
+                // Out of counters; run with the ones there are.
+                break;
+            }
+            counters.push_back(SimCounter{ id, typeId, -1, 0 });
+        }
+    }
+    for (int i = 0; i < config.floatingCounters; i++) {
+        counters.push_back(SimCounter{ -1, -1, -1, 0 });
+    }
+
+    waitsByType.assign(types.size(), std::vector<int>());
+    samples.clear();
+    nextRescore = config.rescoreIntervalSeconds > 0 ? now + config.rescoreIntervalSeconds : LLONG_MAX;
+    nextSample = config.sampleIntervalSeconds > 0 ? now : LLONG_MAX;
+    redirectBaseline = queue.getRedirectCount();
+}
+
+// Counter `index` is idle; it takes the next patient it can reach, if any,
+// and its completion is added to completions.
+bool StaffingModel::startService(QueueManager& queue, int index, long long now,
+    std::vector<ScheduledEvent>& completions) {
+    SimCounter& counter = counters[index];
+    Patient* patient = counter.id >= 0 ? queue.serveAtCounter(counter.id) : queue.serveNextPatient();
+    if (!patient) {
+        return false;
+    }
+
+    ServiceTypeId typeId = patient->getServiceTypeId();
+    if (typeId >= static_cast<int>(waitsByType.size())) {
+        waitsByType.resize(typeId + 1);
+    }
+    long long wait = static_cast<long long>(patient->getServiceTime() - patient->getArrivalTime());
+    waitsByType[typeId].push_back(static_cast<int>(std::max(wait, 0LL)));
+
+    long long duration = drawServiceSeconds(typeId);
+    counter.patientId = patient->getId();
+    counter.busySeconds += duration;
+    completions.push_back(ScheduledEvent::serviceComplete(now + duration, index, counter.patientId));
+    return true;
+}
+
+bool StaffingModel::serveIdle(QueueManager& queue, bool floating, long long now,
+    std::vector<ScheduledEvent>& completions) {
+    bool started = false;
+    for (int i = 0; i < static_cast<int>(counters.size()); i++) {
+        if ((counters[i].id < 0) == floating && counters[i].patientId < 0) {
+            started = startService(queue, i, now, completions) || started;
+        }
+    }
+    return started;
+}
+
+// Lane counters go first, so floating counters only pick up what the lanes'
+// own staff cannot. When lanes run dry, mergeQueues may hand them a lower
+// lane's patients, so lane counters get another pass after each redirect.
+void StaffingModel::dispatch(QueueManager& queue, long long now, std::vector<ScheduledEvent>& completions) {
+    while (true) {
+        serveIdle(queue, false, now, completions);
+        if (!config.mergeEmptyLanes) {
+            break;
+        }
+        long long before = queue.getRedirectCount();
+        queue.mergeQueues();
+        if (queue.getRedirectCount() == before) {
+            break;
+        }
+    }
+    serveIdle(queue, true, now, completions);
+}
+
+// Events for a counter this run does not have, or that it is not serving,
+// are ignored; an event handler may schedule completions of its own.
+void StaffingModel::complete(QueueManager& queue, const ScheduledEvent& event, long long now,
+    std::vector<ScheduledEvent>& completions) {
+    int index = event.tag;
+    if (index < 0 || index >= static_cast<int>(counters.size()) || counters[index].patientId != event.patientId
+        || event.patientId < 0) {
+        return;
+    }
+    SimCounter& counter = counters[index];
+    counter.patientId = -1;
+    if (counter.id >= 0) {
+        queue.finishService(counter.id);
+    }
+    dispatch(queue, now, completions);
+}
+
+long long StaffingModel::nextBoundary() const {
+    return std::min(nextRescore, nextSample);
+}
+
+void StaffingModel::boundary(QueueManager& queue, long long now) {
+    if (now >= nextRescore) {
+        queue.updatePriorities(origin + static_cast<time_t>(now));
+        nextRescore = now + config.rescoreIntervalSeconds;
+    }
+    if (now >= nextSample) {
+        const ServiceTypeRegistry& types = queue.getServiceTypes();
+        QueueLengthSample sample;
+        sample.time = now;
+        for (int i = 0; i < types.size(); i++) {
+            sample.waiting.push_back(queue.getQueueSize(types.nameOf(i)));
+        }
+        samples.push_back(std::move(sample));
+        nextSample = now + config.sampleIntervalSeconds;
+    }
+}
+
+StaffingReport StaffingModel::finish(QueueManager& queue, long long now) {
+    StaffingReport report;
+    report.durationSeconds = std::max(now - startTime, 0LL);
+    report.redirects = queue.getRedirectCount() - redirectBaseline;
+    double span = static_cast<double>(report.durationSeconds);
+
+    std::vector<int> all;
+    long long total = 0;
+    for (std::vector<int>& waits : waitsByType) {
+        std::sort(waits.begin(), waits.end());
+        all.insert(all.end(), waits.begin(), waits.end());
+        for (int wait : waits) {
+            total += wait;
+        }
+    }
+    std::sort(all.begin(), all.end());
+    report.served = static_cast<long long>(all.size());
+    if (!all.empty()) {
+        report.meanWaitMinutes = static_cast<double>(total) / all.size() / 60.0;
+        report.waitP50Minutes = percentileMinutes(all, 0.50);
+        report.waitP90Minutes = percentileMinutes(all, 0.90);
+        report.waitP95Minutes = percentileMinutes(all, 0.95);
+        report.waitP99Minutes = percentileMinutes(all, 0.99);
+        report.maxWaitMinutes = all.back() / 60.0;
+    }
+
+    const ServiceTypeRegistry& types = queue.getServiceTypes();
+    for (const LaneStaffing& lane : config.lanes) {
+        ServiceTypeId typeId = types.find(lane.serviceType);
+        if (typeId < 0) {
+            continue;
+        }
+        LaneStaffingReport laneReport = { lane.serviceType, 0, 0, 0.0, 0.0, 0.0 };
+        long long busy = 0;
+        for (const SimCounter& counter : counters) {
+            if (counter.id >= 0 && counter.lane == typeId) {
+                laneReport.counters++;
+                busy += counter.busySeconds;
+            }
+        }
+        if (typeId < static_cast<int>(waitsByType.size())) {
+            const std::vector<int>& waits = waitsByType[typeId];
+            laneReport.served = static_cast<long long>(waits.size());
+            laneReport.waitP50Minutes = percentileMinutes(waits, 0.50);
+            laneReport.waitP90Minutes = percentileMinutes(waits, 0.90);
+        }
+        if (laneReport.counters > 0 && span > 0.0) {
+            laneReport.utilization = busy / (laneReport.counters * span);
+        }
+        report.lanes.push_back(laneReport);
+    }
+
+    long long floatingBusy = 0;
+    for (const SimCounter& counter : counters) {
+        if (counter.id < 0) {
+            report.floatingCounters++;
+            floatingBusy += counter.busySeconds;
+        }
+    }
+    if (report.floatingCounters > 0 && span > 0.0) {
+        report.floatingUtilization = floatingBusy / (report.floatingCounters * span);
+    }
+
+    report.queueLengths = std::move(samples);
+    samples.clear();
+    return report;
+}
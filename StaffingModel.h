@@ -0,0 +1,155 @@
+#ifndef STAFFINGMODEL_H
+#define STAFFINGMODEL_H
+
+#include "EventQueue.h"
+#include "QueueManager.h"
+#include <string>
+#include <vector>
+#include <ctime>
+
+enum class ServiceTimeShape {
+    FIXED,
+    EXPONENTIAL,
+    LOGNORMAL
+};
+
+// How long one service takes. LOGNORMAL has the given mean and coefficient
+// of variation (standard deviation over mean), with the long right tail
+// real service times tend to have; EXPONENTIAL always has variation 1.
+struct ServiceTimeDistribution {
+    ServiceTimeShape shape = ServiceTimeShape::EXPONENTIAL;
+    double meanMinutes = 10.0;
+    double variation = 1.0;
+
+    static ServiceTimeDistribution fixed(double minutes);
+    static ServiceTimeDistribution exponential(double meanMinutes);
+    static ServiceTimeDistribution lognormal(double meanMinutes, double variation);
+};
+
+// Counters that serve only one lane, and how long a patient of that
+// service type takes wherever they are served.
+struct LaneStaffing {
+    std::string serviceType;
+    int counters;
+    ServiceTimeDistribution serviceTime;
+};
+
+struct StaffingConfig {
+    unsigned long long seed = 1;
+    std::vector<LaneStaffing> lanes;
+    // Counters that take whoever serveNextPatient gives them, so they work
+    // the highest-ranked lane with anyone waiting.
+    int floatingCounters = 0;
+    // For service types not listed in lanes.
+    ServiceTimeDistribution defaultServiceTime;
+    // Whether a lane whose counters run out of patients takes over the lane
+    // below it (QueueManager::mergeQueues), as a single server's lanes do.
+    bool mergeEmptyLanes = true;
+    // Waiting patients are re-scored this often; 0 leaves it to whoever
+    // handles the events.
+    int rescoreIntervalSeconds = 60;
+    // Queue lengths are recorded this often; 0 records none.
+    int sampleIntervalSeconds = 300;
+
+    // The three built-in lanes, each with the same number of counters and a
+    // typical service time.
+    static StaffingConfig evenStaffing(unsigned long long seed, int countersPerLane);
+};
+
+struct LaneStaffingReport {
+    std::string serviceType;
+    int counters;
+    // Patients of this type served, at any counter.
+    long long served;
+    double waitP50Minutes;
+    double waitP90Minutes;
+    // Share of the run this lane's counters spent serving.
+    double utilization;
+};
+
+// Lengths of every lane, by ServiceTypeId, at `time` seconds into the run.
+struct QueueLengthSample {
+    long long time;
+    std::vector<int> waiting;
+};
+
+// What the counters did over one run. Waits run from arrival to the start
+// of service.
+struct StaffingReport {
+    long long durationSeconds = 0;
+    long long served = 0;
+    double meanWaitMinutes = 0.0;
+    double waitP50Minutes = 0.0;
+    double waitP90Minutes = 0.0;
+    double waitP95Minutes = 0.0;
+    double waitP99Minutes = 0.0;
+    double maxWaitMinutes = 0.0;
+    std::vector<LaneStaffingReport> lanes;
+    int floatingCounters = 0;
+    double floatingUtilization = 0.0;
+    // Lane redirects during the run, whether from mergeQueues or from
+    // serveNextPatient emptying a lane.
+    long long redirects = 0;
+    std::vector<QueueLengthSample> queueLengths;
+};
+
+// Service counters for SimulationManager. Lane counters are registered
+// with the QueueManager (addCounter) under names like "Checkup counter 2",
+// and reused by name on later runs, so QueueManager::MAX_COUNTERS bounds
+// them; floating counters are not registered. Service times are drawn
+// from a seeded generator, so the same scenario and seed always serve the
+// same patients at the same times.
+class StaffingModel {
+private:
+    struct SimCounter {
+        CounterId id;            // -1 for a floating counter
+        ServiceTypeId lane;      // -1 for a floating counter
+        int patientId;           // -1 while idle
+        long long busySeconds;
+    };
+
+    StaffingConfig config;
+    std::vector<SimCounter> counters;
+    std::vector<ServiceTimeDistribution> serviceTimes;
+    unsigned long long state;
+    time_t origin;
+    long long startTime;
+    long long redirectBaseline;
+    std::vector<std::vector<int>> waitsByType;
+    std::vector<QueueLengthSample> samples;
+    long long nextSample;
+    long long nextRescore;
+
+    unsigned long long nextRandom();
+    double uniform();
+    long long drawServiceSeconds(ServiceTypeId typeId);
+    bool startService(QueueManager& queue, int index, long long now, std::vector<ScheduledEvent>& completions);
+    bool serveIdle(QueueManager& queue, bool floating, long long now, std::vector<ScheduledEvent>& completions);
+
+public:
+    StaffingModel();
+
+    void configure(const StaffingConfig& config);
+    // Off until configured with at least one counter.
+    bool enabled() const;
+    const StaffingConfig& getConfig() const;
+
+    // Registers the counters and starts the statistics afresh for a run
+    // whose time 0 is `origin`, starting `now` seconds in.
+    void begin(QueueManager& queue, time_t origin, long long now);
+    // Gives every idle counter a patient if one is waiting, adding the
+    // completion of each service begun to completions.
+    void dispatch(QueueManager& queue, long long now, std::vector<ScheduledEvent>& completions);
+    // The counter named by a service-completion event frees up and, like
+    // every other idle counter, takes the next patient.
+    void complete(QueueManager& queue, const ScheduledEvent& event, long long now,
+        std::vector<ScheduledEvent>& completions);
+    // The next time that needs boundary(), or LLONG_MAX. Waiting patients
+    // are re-scored and queue lengths recorded at fixed intervals; the
+    // caller sets the clock to each boundary in turn before calling it.
+    long long nextBoundary() const;
+    void boundary(QueueManager& queue, long long now);
+    StaffingReport finish(QueueManager& queue, long long now);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int workerCount) {
+    this->workerCount = workerCount > 0 ? workerCount : 0;
+    this->started = false;
+    this->stopping = false;
+    this->job = nullptr;
+    this->nextChunk = 0;
+    this->chunkCount = 0;
+    this->pendingChunks = 0;
+    this->generation = 0;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// One less than the hardware threads: the caller of run() is the last one.
+int ThreadPool::defaultWorkerCount() {
+    int hardware = static_cast<int>(std::thread::hardware_concurrency());
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+int ThreadPool::size() const {
+    return workerCount;
+}
+
+void ThreadPool::startWorkers() {
+    started = true;
+    workers.reserve(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+// Claims and runs one chunk of the current job, dropping the lock while the
+// chunk runs. Returns false when no chunk was left to claim.
+bool ThreadPool::runOneChunk(std::unique_lock<std::mutex>& guard) {
+    if (!job || nextChunk >= chunkCount) {
+        return false;
+    }
+    int chunk = nextChunk++;
+    const std::function<void(int)>* task = job;
+    guard.unlock();
+    (*task)(chunk);
+    guard.lock();
+    if (--pendingChunks == 0) {
+        done.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    unsigned long seen = generation;
+    while (true) {
+        wake.wait(guard, [&]() { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        while (runOneChunk(guard)) {
+        }
+    }
+}
+
+// Calls task(0) .. task(chunks - 1), spread over the workers and the caller.
+// Only one job runs at a time; concurrent callers queue on the pool lock.
+void ThreadPool::run(int chunks, const std::function<void(int)>& task) {
+    if (chunks <= 0) {
+        return;
+    }
+    if (workerCount == 0 || chunks == 1) {
+        for (int i = 0; i < chunks; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [&]() { return job == nullptr; });
+    if (!started) {
+        startWorkers();
+    }
+    job = &task;
+    nextChunk = 0;
+    chunkCount = chunks;
+    pendingChunks = chunks;
+    generation++;
+    wake.notify_all();
+
+    while (runOneChunk(guard)) {
+    }
+    done.wait(guard, [&]() { return pendingChunks == 0; });
+    job = nullptr;
+    done.notify_all();
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads for splitting one large job into chunks.
+// run() blocks until every chunk is done; the calling thread works on
+// chunks too, so a pool with no workers simply runs the job inline.
+// Workers are started on first use.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    int workerCount;
+    bool started;
+    bool stopping;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)>* job;
+    int nextChunk;
+    int chunkCount;
+    int pendingChunks;
+    unsigned long generation;
+
+    void startWorkers();
+    void workerLoop();
+    bool runOneChunk(std::unique_lock<std::mutex>& guard);
+
+public:
+    ThreadPool(int workerCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const;
+    void run(int chunks, const std::function<void(int)>& task);
+
+    static int defaultWorkerCount();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,502 @@
+#include "Trace.h"
+#include "FileIO.h"
+#include <cstring>
+
+namespace {
+    const char MAGIC[4] = { 'H', 'Q', 'T', '1' };
+    // Version 2 may carry score overrides among its CHANGE records; it is
+    // otherwise the same as version 1, which is still read.
+    const unsigned int FORMAT_VERSION = 2;
+    const size_t MAX_NAME_BYTES = 255;
+    // No record is longer than this: a name record or a framed journal
+    // record with a full-length name, plus the op and time.
+    const size_t MAX_RECORD_BYTES = 1024;
+
+    void putVarint(std::vector<char>& out, unsigned long long value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Zigzag, so small negative numbers stay short too.
+    void putSigned(std::vector<char>& out, long long value) {
+        putVarint(out, (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+    }
+
+    // An arrival time of 0 means "now" and stays 0; anything else is stored
+    // relative to the record's own time.
+    void putArrival(std::vector<char>& out, time_t arrivalTime, time_t time) {
+        if (arrivalTime == 0) {
+            putVarint(out, 0);
+            return;
+        }
+        long long delta = static_cast<long long>(arrivalTime - time);
+        putVarint(out, ((static_cast<unsigned long long>(delta) << 1) ^ static_cast<unsigned long long>(delta >> 63)) + 1);
+    }
+
+    struct Cursor {
+        const char* at;
+        const char* end;
+
+        bool getByte(unsigned char& value) {
+            if (at == end) return false;
+            value = static_cast<unsigned char>(*at++);
+            return true;
+        }
+
+        bool getVarint(unsigned long long& value) {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                unsigned char byte;
+                if (!getByte(byte)) return false;
+                value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+
+        bool getSigned(long long& value) {
+            unsigned long long raw;
+            if (!getVarint(raw)) return false;
+            value = static_cast<long long>(raw >> 1) ^ -static_cast<long long>(raw & 1);
+            return true;
+        }
+
+        bool getInt(int& value) {
+            long long wide;
+            if (!getSigned(wide)) return false;
+            value = static_cast<int>(wide);
+            return true;
+        }
+
+        bool getArrival(time_t& arrivalTime, time_t time) {
+            unsigned long long raw;
+            if (!getVarint(raw)) return false;
+            if (raw == 0) {
+                arrivalTime = 0;
+                return true;
+            }
+            raw--;
+            long long delta = static_cast<long long>(raw >> 1) ^ -static_cast<long long>(raw & 1);
+            arrivalTime = time + static_cast<time_t>(delta);
+            return true;
+        }
+    };
+}
+
+TraceRecord TraceRecord::addPatient(time_t time, int patientId, int urgency, const std::string& serviceType) {
+    TraceRecord record = TraceRecord();
+    record.op = TraceOp::ADD_PATIENT;
+    record.time = time;
+    record.patientId = patientId;
+    record.urgency = urgency;
+    record.serviceType = serviceType;
+    return record;
+}
+
+TraceRecord TraceRecord::addAtTime(time_t time, int patientId, int urgency, const std::string& serviceType,
+    time_t arrivalTime) {
+    TraceRecord record = addPatient(time, patientId, urgency, serviceType);
+    record.op = TraceOp::ADD_AT_TIME;
+    record.argTime = arrivalTime;
+    return record;
+}
+
+TraceRecord TraceRecord::addBatch(time_t time, int count, bool countVisits) {
+    TraceRecord record = TraceRecord();
+    record.op = TraceOp::ADD_BATCH;
+    record.time = time;
+    record.count = count;
+    record.flag = countVisits;
+    return record;
+}
+
+TraceRecord TraceRecord::arrival(time_t time, int patientId, int urgency, const std::string& serviceType,
+    time_t arrivalTime) {
+    TraceRecord record = addAtTime(time, patientId, urgency, serviceType, arrivalTime);
+    record.op = TraceOp::ARRIVAL;
+    return record;
+}
+
+TraceRecord TraceRecord::serveNext(time_t time, int patientId, long long waitSeconds) {
+    TraceRecord record = TraceRecord();
+    record.op = TraceOp::SERVE_NEXT;
+    record.time = time;
+    record.patientId = patientId;
+    record.waitSeconds = waitSeconds;
+    return record;
+}
+
+TraceRecord TraceRecord::serveBatch(time_t time, int requested, int served) {
+    TraceRecord record = TraceRecord();
+    record.op = TraceOp::SERVE_BATCH;
+    record.time = time;
+    record.count = requested;
+    record.served = served;
+    return record;
+}
+
+TraceRecord TraceRecord::servedPatient(time_t time, int patientId, long long waitSeconds) {
+    TraceRecord record = serveNext(time, patientId, waitSeconds);
+    record.op = TraceOp::SERVED;
+    return record;
+}
+
+TraceRecord TraceRecord::serveById(time_t time, int patientId, bool found, long long waitSeconds) {
+    TraceRecord record = serveNext(time, patientId, waitSeconds);
+    record.op = TraceOp::SERVE_BY_ID;
+    record.flag = found;
+    return record;
+}
+
+TraceRecord TraceRecord::remove(time_t time, int patientId, bool found) {
+    TraceRecord record = TraceRecord();
+    record.op = TraceOp::REMOVE;
+    record.time = time;
+    record.patientId = patientId;
+    record.flag = found;
+    return record;
+}
+
+TraceRecord TraceRecord::updatePriorities(time_t time, time_t currentTime) {
+    TraceRecord record = TraceRecord();
+    record.op = TraceOp::UPDATE_PRIORITIES;
+    record.time = time;
+    record.argTime = currentTime;
+    return record;
+}
+
+TraceRecord TraceRecord::journalChange(time_t time, const JournalRecord& change) {
+    TraceRecord record = TraceRecord();
+    record.op = TraceOp::CHANGE;
+    record.time = time;
+    record.change = change;
+    return record;
+}
+
+TraceWriter::TraceWriter() {
+    this->fd = -1;
+    this->lastTime = 0;
+    this->written = 0;
+}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const std::string& path) {
+    close();
+    std::lock_guard<std::mutex> guard(lock);
+    fd = FileIO::createForWrite(path);
+    if (fd < 0) {
+        return false;
+    }
+    pending.assign(MAGIC, MAGIC + sizeof(MAGIC));
+    const char* version = reinterpret_cast<const char*>(&FORMAT_VERSION);
+    pending.insert(pending.end(), version, version + sizeof(FORMAT_VERSION));
+    names.clear();
+    lastTime = 0;
+    written = 0;
+    return true;
+}
+
+void TraceWriter::close() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd < 0) {
+        return;
+    }
+    flushPending();
+    FileIO::closeFile(fd);
+    fd = -1;
+}
+
+bool TraceWriter::isOpen() const {
+    return fd >= 0;
+}
+
+void TraceWriter::flushPending() {
+    if (fd >= 0 && !pending.empty()) {
+        FileIO::writeAll(fd, pending.data(), pending.size());
+    }
+    pending.clear();
+}
+
+// The name's number, defining it in the file on first use.
+unsigned int TraceWriter::nameIndex(const std::string& name) {
+    auto found = names.find(name);
+    if (found != names.end()) {
+        return found->second;
+    }
+    unsigned int index = static_cast<unsigned int>(names.size());
+    names.emplace(name, index);
+    size_t size = name.size() < MAX_NAME_BYTES ? name.size() : MAX_NAME_BYTES;
+    pending.push_back(static_cast<char>(TraceOp::NAME));
+    putVarint(pending, index);
+    pending.push_back(static_cast<char>(size));
+    pending.insert(pending.end(), name.begin(), name.begin() + size);
+    return index;
+}
+
+void TraceWriter::encode(const TraceRecord& record) {
+    unsigned int name = 0;
+    if (record.op == TraceOp::ADD_PATIENT || record.op == TraceOp::ADD_AT_TIME || record.op == TraceOp::ARRIVAL) {
+        name = nameIndex(record.serviceType);
+    }
+    pending.push_back(static_cast<char>(record.op));
+    putSigned(pending, static_cast<long long>(record.time - lastTime));
+    lastTime = record.time;
+
+    switch (record.op) {
+    case TraceOp::ADD_PATIENT:
+    case TraceOp::ADD_AT_TIME:
+    case TraceOp::ARRIVAL:
+        putSigned(pending, record.patientId);
+        putSigned(pending, record.urgency);
+        putVarint(pending, name);
+        if (record.op != TraceOp::ADD_PATIENT) {
+            putArrival(pending, record.argTime, record.time);
+        }
+        break;
+    case TraceOp::ADD_BATCH:
+        putVarint(pending, static_cast<unsigned int>(record.count));
+        pending.push_back(record.flag ? 1 : 0);
+        break;
+    case TraceOp::SERVE_NEXT:
+    case TraceOp::SERVED:
+        putSigned(pending, record.patientId);
+        if (record.patientId >= 0) {
+            putSigned(pending, record.waitSeconds);
+        }
+        break;
+    case TraceOp::SERVE_BATCH:
+        putSigned(pending, record.count);
+        putVarint(pending, static_cast<unsigned int>(record.served));
+        break;
+    case TraceOp::SERVE_BY_ID:
+        putSigned(pending, record.patientId);
+        pending.push_back(record.flag ? 1 : 0);
+        if (record.flag) {
+            putSigned(pending, record.waitSeconds);
+        }
+        break;
+    case TraceOp::REMOVE:
+        putSigned(pending, record.patientId);
+        pending.push_back(record.flag ? 1 : 0);
+        break;
+    case TraceOp::UPDATE_PRIORITIES:
+        putSigned(pending, static_cast<long long>(record.argTime - record.time));
+        break;
+    case TraceOp::CHANGE:
+        Journal::encodeRecord(record.change, pending);
+        break;
+    case TraceOp::NAME:
+        break;
+    }
+    written++;
+}
+
+void TraceWriter::write(const TraceRecord& record) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd < 0) {
+        return;
+    }
+    encode(record);
+    if (pending.size() >= FLUSH_BYTES) {
+        flushPending();
+    }
+}
+
+void TraceWriter::write(const std::vector<TraceRecord>& records) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd < 0) {
+        return;
+    }
+    for (const TraceRecord& record : records) {
+        encode(record);
+        if (pending.size() >= FLUSH_BYTES) {
+            flushPending();
+        }
+    }
+}
+
+void TraceWriter::flush() {
+    std::lock_guard<std::mutex> guard(lock);
+    flushPending();
+}
+
+long long TraceWriter::recordCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return written;
+}
+
+TraceReader::TraceReader() {
+    this->file = nullptr;
+    this->pos = nullptr;
+    this->end = nullptr;
+    this->atEof = true;
+    this->broken = false;
+    this->lastTime = 0;
+}
+
+TraceReader::~TraceReader() {
+    close();
+}
+
+bool TraceReader::open(const std::string& path) {
+    close();
+    broken = false;
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    buffer.resize(BUFFER_SIZE);
+    pos = buffer.data();
+    end = pos;
+    atEof = false;
+    lastTime = 0;
+    names.clear();
+
+    char magic[sizeof(MAGIC)];
+    unsigned int version;
+    fill();
+    if (static_cast<size_t>(end - pos) < sizeof(magic) + sizeof(version)) {
+        broken = true;
+        close();
+        return false;
+    }
+    std::memcpy(magic, pos, sizeof(magic));
+    std::memcpy(&version, pos + sizeof(magic), sizeof(version));
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version == 0 || version > FORMAT_VERSION) {
+        broken = true;
+        close();
+        return false;
+    }
+    pos += sizeof(magic) + sizeof(version);
+    return true;
+}
+
+void TraceReader::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+// Tops the buffer up so a whole record is in it unless the file ends first.
+bool TraceReader::fill() {
+    size_t left = end - pos;
+    if (left >= MAX_RECORD_BYTES || atEof || !file) {
+        return left > 0;
+    }
+    std::memmove(buffer.data(), pos, left);
+    size_t got = std::fread(buffer.data() + left, 1, buffer.size() - left, file);
+    if (got < buffer.size() - left) {
+        atEof = true;
+    }
+    pos = buffer.data();
+    end = pos + left + got;
+    return end > pos;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    while (file && fill()) {
+        Cursor in = { pos, end };
+        unsigned char op = 0;
+        in.getByte(op);
+
+        if (static_cast<TraceOp>(op) == TraceOp::NAME) {
+            unsigned long long index;
+            unsigned char size;
+            if (!in.getVarint(index) || index != names.size() || !in.getByte(size) ||
+                static_cast<size_t>(in.end - in.at) < size) {
+                break;
+            }
+            names.emplace_back(in.at, size);
+            pos = in.at + size;
+            continue;
+        }
+
+        record.op = static_cast<TraceOp>(op);
+        long long delta;
+        if (!in.getSigned(delta)) {
+            break;
+        }
+        record.time = lastTime + static_cast<time_t>(delta);
+
+        bool ok = false;
+        unsigned char flag = 0;
+        unsigned long long count = 0;
+        switch (record.op) {
+        case TraceOp::ADD_PATIENT:
+        case TraceOp::ADD_AT_TIME:
+        case TraceOp::ARRIVAL: {
+            unsigned long long name;
+            ok = in.getInt(record.patientId) && in.getInt(record.urgency) && in.getVarint(name) && name < names.size();
+            if (ok) {
+                record.serviceType = names[name];
+            }
+            if (ok && record.op != TraceOp::ADD_PATIENT) {
+                ok = in.getArrival(record.argTime, record.time);
+            }
+            break;
+        }
+        case TraceOp::ADD_BATCH:
+            ok = in.getVarint(count) && in.getByte(flag);
+            record.count = static_cast<int>(count);
+            record.flag = flag != 0;
+            break;
+        case TraceOp::SERVE_NEXT:
+        case TraceOp::SERVED:
+            ok = in.getInt(record.patientId);
+            record.waitSeconds = 0;
+            if (ok && record.patientId >= 0) {
+                ok = in.getSigned(record.waitSeconds);
+            }
+            break;
+        case TraceOp::SERVE_BATCH:
+            ok = in.getInt(record.count) && in.getVarint(count);
+            record.served = static_cast<int>(count);
+            break;
+        case TraceOp::SERVE_BY_ID:
+            ok = in.getInt(record.patientId) && in.getByte(flag);
+            record.flag = flag != 0;
+            record.waitSeconds = 0;
+            if (ok && record.flag) {
+                ok = in.getSigned(record.waitSeconds);
+            }
+            break;
+        case TraceOp::REMOVE:
+            ok = in.getInt(record.patientId) && in.getByte(flag);
+            record.flag = flag != 0;
+            break;
+        case TraceOp::UPDATE_PRIORITIES: {
+            long long offset = 0;
+            ok = in.getSigned(offset);
+            record.argTime = record.time + static_cast<time_t>(offset);
+            break;
+        }
+        case TraceOp::CHANGE: {
+            size_t used = Journal::decodeRecord(in.at, in.end - in.at, record.change);
+            in.at += used;
+            ok = used > 0;
+            break;
+        }
+        case TraceOp::NAME:
+            break;
+        }
+        if (!ok) {
+            break;
+        }
+        lastTime = record.time;
+        pos = in.at;
+        return true;
+    }
+    broken = broken || pos != end;
+    return false;
+}
+
+bool TraceReader::failed() const {
+    return broken;
+}
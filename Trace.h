@@ -0,0 +1,131 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "Journal.h"
+#include <cstdio>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ctime>
+
+// One QueueManager call as the caller made it, with what it returned where
+// that matters for comparing runs. Each op uses only some of the fields;
+// the factory functions show which. time is the queue clock when the call
+// ran.
+enum class TraceOp : unsigned char {
+    ADD_PATIENT = 1,
+    ADD_AT_TIME,
+    ADD_BATCH,        // followed by `count` ARRIVAL records
+    ARRIVAL,
+    SERVE_NEXT,
+    SERVE_BATCH,      // followed by `served` SERVED records
+    SERVED,
+    SERVE_BY_ID,
+    REMOVE,
+    UPDATE_PRIORITIES,
+    CHANGE,           // an admin change or visit, as its journal record
+    NAME              // format-internal: defines a service-type name
+};
+
+struct TraceRecord {
+    TraceOp op;
+    time_t time;
+    int patientId;
+    int urgency;
+    int count;
+    int served;
+    bool flag;
+    time_t argTime;
+    long long waitSeconds;
+    std::string serviceType;
+    JournalRecord change;
+
+    static TraceRecord addPatient(time_t time, int patientId, int urgency, const std::string& serviceType);
+    static TraceRecord addAtTime(time_t time, int patientId, int urgency, const std::string& serviceType,
+        time_t arrivalTime);
+    static TraceRecord addBatch(time_t time, int count, bool countVisits);
+    static TraceRecord arrival(time_t time, int patientId, int urgency, const std::string& serviceType,
+        time_t arrivalTime);
+    // patientId is -1 when nothing was served.
+    static TraceRecord serveNext(time_t time, int patientId, long long waitSeconds);
+    static TraceRecord serveBatch(time_t time, int requested, int served);
+    static TraceRecord servedPatient(time_t time, int patientId, long long waitSeconds);
+    static TraceRecord serveById(time_t time, int patientId, bool found, long long waitSeconds);
+    static TraceRecord remove(time_t time, int patientId, bool found);
+    static TraceRecord updatePriorities(time_t time, time_t currentTime);
+    static TraceRecord journalChange(time_t time, const JournalRecord& change);
+};
+
+// Writes a trace file: a short header, then one record after another.
+// Integers are variable-length and times are deltas from the previous
+// record, so a typical call takes 4 to 8 bytes; service-type names are
+// written once and then referred to by number. Records from several
+// threads are written in the order write() is called. Thread-safe; the
+// writer lock is a leaf lock.
+class TraceWriter {
+private:
+    static const size_t FLUSH_BYTES = 64 * 1024;
+
+    int fd;
+    std::vector<char> pending;
+    std::unordered_map<std::string, unsigned int> names;
+    time_t lastTime;
+    long long written;
+    std::mutex lock;
+
+    void encode(const TraceRecord& record);
+    unsigned int nameIndex(const std::string& name);
+    void flushPending();
+
+public:
+    TraceWriter();
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Starts a new file at path, replacing any file there.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    void write(const TraceRecord& record);
+    // Writes the records together, with nothing from other threads between them.
+    void write(const std::vector<TraceRecord>& records);
+    void flush();
+    long long recordCount();
+};
+
+// Reads a trace file record by record through a fixed buffer. Stops at the
+// first record it cannot decode; failed() tells a torn or foreign file from
+// a clean end.
+class TraceReader {
+public:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+private:
+    std::FILE* file;
+    std::vector<char> buffer;
+    const char* pos;
+    const char* end;
+    bool atEof;
+    bool broken;
+    time_t lastTime;
+    std::vector<std::string> names;
+
+    bool fill();
+
+public:
+    TraceReader();
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool next(TraceRecord& record);
+    bool failed() const;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "TraceReplayer.h"
+#include "Logger.h"
+#include <chrono>
+
+TraceReplayer::TraceReplayer(QueueManager* qm) : clock(0) {
+    this->queueManager = qm;
+    this->previousClock = nullptr;
+}
+
+TraceReplayer::~TraceReplayer() {
+    if (previousClock && queueManager->getClock() == &clock) {
+        queueManager->setClock(previousClock);
+    }
+    if (Logger::get().getClock() == &clock) {
+        Logger::get().setClock(nullptr);
+    }
+}
+
+void TraceReplayer::installClock(time_t start) {
+    clock.set(start);
+    if (queueManager->getClock() != &clock) {
+        previousClock = queueManager->getClock();
+    }
+    queueManager->setClock(&clock);
+    Logger::get().setClock(&clock);
+}
+
+// patient is what the replay served, or nullptr; recordedId is -1 where the
+// recording served nobody.
+void TraceReplayer::compare(TraceReplayResult& result, int recordedId, long long recordedWait, Patient* patient) {
+    int replayedId = patient ? patient->getId() : -1;
+    if (patient) {
+        result.served++;
+        result.replayedWaitSeconds += patient->getServiceTime() - patient->getArrivalTime();
+    }
+    if (recordedId >= 0) {
+        result.recordedWaitSeconds += recordedWait;
+    }
+    if (replayedId != recordedId) {
+        mismatch(result);
+    }
+}
+
+void TraceReplayer::mismatch(TraceReplayResult& result) {
+    if (result.mismatches == 0) {
+        result.firstMismatch = result.operations;
+    }
+    result.mismatches++;
+}
+
+TraceReplayResult TraceReplayer::replay(const std::string& path) {
+    TraceReplayResult result;
+    TraceReader reader;
+    if (!reader.open(path)) {
+        result.complete = false;
+        return result;
+    }
+
+    LogLevel level = Logger::get().getLevel();
+    if (level < LogLevel::WARNING) {
+        Logger::get().setLevel(LogLevel::WARNING);
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    TraceRecord record;
+    TraceRecord part;
+    bool started = false;
+    while (result.complete && reader.next(record)) {
+        if (!started) {
+            installClock(record.time);
+            started = true;
+        }
+        clock.set(record.time);
+        result.operations++;
+
+        switch (record.op) {
+        case TraceOp::ADD_PATIENT:
+            queueManager->addPatient(record.patientId, record.urgency, record.serviceType);
+            break;
+        case TraceOp::ADD_AT_TIME:
+            queueManager->addPatientAtTime(record.patientId, record.urgency, record.serviceType, record.argTime);
+            break;
+        case TraceOp::ADD_BATCH:
+            arrivals.clear();
+            for (int i = 0; i < record.count; i++) {
+                if (!reader.next(part) || part.op != TraceOp::ARRIVAL) {
+                    result.complete = false;
+                    break;
+                }
+                arrivals.push_back(PatientArrival{ part.patientId, part.urgency, part.serviceType, part.argTime });
+            }
+            if (result.complete) {
+                queueManager->addPatients(arrivals, record.flag);
+            }
+            break;
+        case TraceOp::SERVE_NEXT:
+            compare(result, record.patientId, record.waitSeconds, queueManager->serveNextPatient());
+            break;
+        case TraceOp::SERVE_BATCH: {
+            queueManager->serveNext(record.count, served);
+            int count = record.served > static_cast<int>(served.size()) ? record.served : static_cast<int>(served.size());
+            for (int i = 0; i < count; i++) {
+                Patient* patient = i < static_cast<int>(served.size()) ? served[i] : nullptr;
+                if (i >= record.served) {
+                    compare(result, -1, 0, patient);
+                }
+                else if (!reader.next(part) || part.op != TraceOp::SERVED) {
+                    result.complete = false;
+                    break;
+                }
+                else {
+                    compare(result, part.patientId, part.waitSeconds, patient);
+                }
+            }
+            break;
+        }
+        case TraceOp::SERVE_BY_ID: {
+            Patient* patient = queueManager->servePatientById(record.patientId);
+            compare(result, record.flag ? record.patientId : -1, record.waitSeconds, patient);
+            break;
+        }
+        case TraceOp::REMOVE:
+            if (queueManager->removePatientById(record.patientId) != record.flag) {
+                mismatch(result);
+            }
+            break;
+        case TraceOp::UPDATE_PRIORITIES:
+            queueManager->updatePriorities(record.argTime);
+            break;
+        case TraceOp::CHANGE:
+            queueManager->applyJournalRecord(record.change);
+            break;
+        case TraceOp::ARRIVAL:
+        case TraceOp::SERVED:
+        case TraceOp::NAME:
+            // Only ever part of a batch, or read by TraceReader itself.
+            result.complete = false;
+            break;
+        }
+    }
+    if (reader.failed()) {
+        result.complete = false;
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Logger::get().setLevel(level);
+    return result;
+}
@@ -0,0 +1,52 @@
+#ifndef TRACEREPLAYER_H
+#define TRACEREPLAYER_H
+
+#include "Clock.h"
+#include "QueueManager.h"
+#include "Trace.h"
+#include <string>
+#include <vector>
+#include <ctime>
+
+// How a replay went. operations counts the calls replayed (a batch is one);
+// a mismatch is a serve or removal whose outcome differs from the recorded
+// one, and firstMismatch is the number of the call it happened in, or -1.
+struct TraceReplayResult {
+    long long operations = 0;
+    long long served = 0;
+    long long mismatches = 0;
+    long long firstMismatch = -1;
+    long long recordedWaitSeconds = 0;
+    long long replayedWaitSeconds = 0;
+    double seconds = 0.0;
+    // False if the trace could not be opened or ended in a torn record.
+    bool complete = true;
+};
+
+// Runs a recorded trace (QueueManager::setTraceWriter) against a queue as
+// fast as it will go, setting the queue's clock to each call's recorded
+// time, and checks that the same patients come out in the same order. Start
+// from a queue configured as the recorded one was when recording began.
+// Log records are stamped with the same clock. The queue goes back to its
+// own clock, and the logger to the wall clock, when the replayer is
+// destroyed.
+class TraceReplayer {
+private:
+    QueueManager* queueManager;
+    VirtualClock clock;
+    Clock* previousClock;
+    std::vector<PatientArrival> arrivals;
+    std::vector<Patient*> served;
+
+    void installClock(time_t start);
+    void compare(TraceReplayResult& result, int recordedId, long long recordedWait, Patient* patient);
+    void mismatch(TraceReplayResult& result);
+
+public:
+    TraceReplayer(QueueManager* qm);
+    ~TraceReplayer();
+
+    TraceReplayResult replay(const std::string& path);
+};
+
+#endif
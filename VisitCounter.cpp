@@ -0,0 +1,139 @@
+#include "VisitCounter.h"
+
+namespace {
+    const size_t MIN_CAPACITY = 16;
+
+    // Fibonacci hashing spreads sequential IDs across the table.
+    size_t slotFor(int patientId, size_t capacity) {
+        unsigned long long h = static_cast<unsigned int>(patientId) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h >> 32) & (capacity - 1);
+    }
+}
+
+VisitCounter::VisitCounter() {
+    this->used = 0;
+    this->highest = 0;
+    this->buckets.resize(1);
+}
+
+// The slot holding patientId, or the empty slot where it belongs. The table
+// is never full, so the probe always ends.
+size_t VisitCounter::findSlot(int patientId) const {
+    size_t mask = slots.size() - 1;
+    size_t i = slotFor(patientId, slots.size());
+    while (slots[i].count != 0 && slots[i].patientId != patientId) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Keeps the load factor at or below 1/2 for `patients` entries.
+void VisitCounter::grow(size_t patients) {
+    size_t capacity = slots.empty() ? MIN_CAPACITY : slots.size();
+    while (capacity < patients * 2) {
+        capacity *= 2;
+    }
+    if (capacity == slots.size()) {
+        return;
+    }
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.assign(capacity, Slot{ 0, 0, -1 });
+    for (const Slot& slot : old) {
+        if (slot.count > 0) {
+            slots[findSlot(slot.patientId)] = slot;
+        }
+    }
+}
+
+void VisitCounter::unlink(Slot& slot) {
+    std::vector<int>& bucket = buckets[slot.count];
+    int last = bucket.back();
+    bucket[slot.bucketPos] = last;
+    bucket.pop_back();
+    if (last != slot.patientId) {
+        slots[findSlot(last)].bucketPos = slot.bucketPos;
+    }
+    while (highest > 0 && buckets[highest].empty()) {
+        highest--;
+    }
+}
+
+void VisitCounter::link(Slot& slot, int count) {
+    if (static_cast<size_t>(count) >= buckets.size()) {
+        buckets.resize(count + 1);
+    }
+    slot.count = count;
+    slot.bucketPos = static_cast<int>(buckets[count].size());
+    buckets[count].push_back(slot.patientId);
+    if (count > highest) {
+        highest = count;
+    }
+}
+
+int VisitCounter::get(int patientId) const {
+    if (slots.empty()) {
+        return 0;
+    }
+    return slots[findSlot(patientId)].count;
+}
+
+int VisitCounter::increment(int patientId) {
+    grow(used + 1);
+    Slot& slot = slots[findSlot(patientId)];
+    int count = slot.count;
+    if (count == 0) {
+        slot.patientId = patientId;
+        used++;
+    }
+    else {
+        unlink(slot);
+    }
+    link(slot, count + 1);
+    return count + 1;
+}
+
+void VisitCounter::set(int patientId, int count) {
+    if (count < 1) {
+        return;
+    }
+    grow(used + 1);
+    Slot& slot = slots[findSlot(patientId)];
+    if (slot.count == 0) {
+        slot.patientId = patientId;
+        used++;
+    }
+    else {
+        unlink(slot);
+    }
+    link(slot, count);
+}
+
+void VisitCounter::reserve(size_t patients) {
+    grow(patients);
+}
+
+size_t VisitCounter::size() const {
+    return used;
+}
+
+void VisitCounter::appendAtLeast(int threshold, std::vector<VisitCount>& out) const {
+    for (int count = highest; count >= threshold && count > 0; count--) {
+        for (int patientId : buckets[count]) {
+            out.push_back(VisitCount{ patientId, count });
+        }
+    }
+}
+
+void VisitCounter::appendTop(size_t k, std::vector<VisitCount>& out) const {
+    size_t taken = 0;
+    for (int count = highest; count > 0 && taken < k; count--) {
+        for (int patientId : buckets[count]) {
+            if (taken == k) {
+                break;
+            }
+            out.push_back(VisitCount{ patientId, count });
+            taken++;
+        }
+    }
+}
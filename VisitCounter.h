@@ -0,0 +1,66 @@
+#ifndef VISITCOUNTER_H
+#define VISITCOUNTER_H
+
+#include <vector>
+#include <cstddef>
+
+struct VisitCount {
+    int patientId;
+    int count;
+};
+
+// Visit counts keyed by patient ID in an open-addressing table, plus an
+// index of patients bucketed by count that is updated on every increment.
+// Threshold and top-K queries walk the buckets from the highest count down,
+// so they cost about the size of the answer rather than the number of
+// patients ever seen. Counts only go up except through set(), so the table
+// never needs tombstones.
+//
+// Not thread-safe; QueueManager keeps one per table shard under its lock.
+class VisitCounter {
+private:
+    // count == 0 marks an empty slot. bucketPos is the patient's index in
+    // buckets[count].
+    struct Slot {
+        int patientId;
+        int count;
+        int bucketPos;
+    };
+
+    std::vector<Slot> slots;
+    size_t used;
+    std::vector<std::vector<int>> buckets;
+    int highest;
+
+    size_t findSlot(int patientId) const;
+    void grow(size_t patients);
+    void unlink(Slot& slot);
+    void link(Slot& slot, int count);
+
+public:
+    VisitCounter();
+
+    int get(int patientId) const;
+    // Returns the new count.
+    int increment(int patientId);
+    // For restoring saved counts; a count below 1 is ignored.
+    void set(int patientId, int count);
+    void reserve(size_t patients);
+    size_t size() const;
+
+    // Patients with at least threshold visits, most visits first.
+    void appendAtLeast(int threshold, std::vector<VisitCount>& out) const;
+    // Up to k patients with the most visits, most visits first.
+    void appendTop(size_t k, std::vector<VisitCount>& out) const;
+
+    template <class Fn>
+    void forEach(Fn fn) const {
+        for (const Slot& slot : slots) {
+            if (slot.count > 0) {
+                fn(slot.patientId, slot.count);
+            }
+        }
+    }
+};
+
+#endif
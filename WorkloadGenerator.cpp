@@ -0,0 +1,146 @@
+#include "WorkloadGenerator.h"
+#include <algorithm>
+#include <cmath>
+
+WorkloadConfig WorkloadConfig::typicalDay(unsigned long long seed, double arrivalsPerHour) {
+    WorkloadConfig config;
+    config.seed = seed;
+    config.arrivalsPerHour = arrivalsPerHour;
+    config.hourlyRateFactors = {
+        0.30, 0.25, 0.20, 0.20, 0.25, 0.40, 0.70, 1.10, 1.50, 1.70, 1.80, 1.70,
+        1.50, 1.40, 1.30, 1.30, 1.40, 1.50, 1.50, 1.30, 1.00, 0.80, 0.60, 0.40
+    };
+    return config;
+}
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& config) {
+    this->config = config;
+    if (this->config.serviceMix.empty()) {
+        this->config.serviceMix.push_back({ "Checkup", 1.0 });
+    }
+
+    double total = 0.0;
+    for (double weight : this->config.urgencyWeights) {
+        total += std::max(weight, 0.0);
+        urgencyCumulative.push_back(total);
+    }
+    total = 0.0;
+    for (const WorkloadServiceShare& share : this->config.serviceMix) {
+        total += std::max(share.weight, 0.0);
+        serviceCumulative.push_back(total);
+    }
+
+    // Thinning draws candidates at the highest rate the process ever
+    // reaches and keeps each with probability rate(t) / that rate.
+    double peakFactor = 1.0;
+    if (!this->config.hourlyRateFactors.empty()) {
+        peakFactor = *std::max_element(this->config.hourlyRateFactors.begin(), this->config.hourlyRateFactors.end());
+    }
+    double peak = std::max(this->config.arrivalsPerHour * peakFactor, 0.0);
+    for (const WorkloadBurst& burst : this->config.bursts) {
+        peak += std::max(burst.arrivalsPerHour, 0.0);
+    }
+    this->maxRatePerMinute = peak / 60.0;
+    reset();
+}
+
+void WorkloadGenerator::reset() {
+    state = config.seed;
+    minute = 0.0;
+    nextPatientId = config.firstPatientId;
+    generated = 0;
+}
+
+// SplitMix64.
+unsigned long long WorkloadGenerator::nextRandom() {
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// In [0, 1).
+double WorkloadGenerator::uniform() {
+    return static_cast<double>(nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int WorkloadGenerator::pick(const std::vector<double>& cumulative) {
+    double target = uniform() * cumulative.back();
+    int last = static_cast<int>(cumulative.size()) - 1;
+    int i = 0;
+    while (i < last && target >= cumulative[i]) {
+        i++;
+    }
+    return i;
+}
+
+double WorkloadGenerator::baseRateAt(double minute) const {
+    double rate = std::max(config.arrivalsPerHour, 0.0) / 60.0;
+    if (!config.hourlyRateFactors.empty()) {
+        size_t hour = static_cast<size_t>(minute / 60.0) % 24;
+        double factor = hour < config.hourlyRateFactors.size() ? config.hourlyRateFactors[hour] : 1.0;
+        rate *= std::max(factor, 0.0);
+    }
+    return rate;
+}
+
+double WorkloadGenerator::burstRateAt(const WorkloadBurst& burst, double minute) const {
+    if (minute < burst.startMinute || minute >= burst.startMinute + burst.minutes) {
+        return 0.0;
+    }
+    return std::max(burst.arrivalsPerHour, 0.0) / 60.0;
+}
+
+bool WorkloadGenerator::next(SimulationEvent& event) {
+    if (maxRatePerMinute <= 0.0) {
+        return false;
+    }
+    while (true) {
+        minute += -std::log(1.0 - uniform()) / maxRatePerMinute;
+        if (minute >= config.durationMinutes) {
+            minute = config.durationMinutes;
+            return false;
+        }
+
+        double draw = uniform() * maxRatePerMinute;
+        double rate = baseRateAt(minute);
+        if (draw < rate) {
+            event.timestamp = static_cast<int>(minute);
+            if (nextPatientId > config.firstPatientId && uniform() < config.returningFraction) {
+                double span = static_cast<double>(nextPatientId - config.firstPatientId);
+                event.patientId = config.firstPatientId + static_cast<int>(span * std::pow(uniform(), config.returnSkew));
+            }
+            else {
+                event.patientId = nextPatientId++;
+            }
+            event.urgency = pick(urgencyCumulative) + 1;
+            event.serviceType = config.serviceMix[pick(serviceCumulative)].serviceType;
+            generated++;
+            return true;
+        }
+        draw -= rate;
+
+        for (const WorkloadBurst& burst : config.bursts) {
+            rate = burstRateAt(burst, minute);
+            if (draw < rate) {
+                int minUrgency = std::min(std::max(burst.minUrgency, 1), 5);
+                event.timestamp = static_cast<int>(minute);
+                event.patientId = nextPatientId++;
+                event.urgency = minUrgency + static_cast<int>(uniform() * (6 - minUrgency));
+                event.serviceType = burst.serviceType;
+                generated++;
+                return true;
+            }
+            draw -= rate;
+        }
+        // Rejected: the rate at this instant is below the peak.
+    }
+}
+
+long long WorkloadGenerator::generatedCount() const {
+    return generated;
+}
+
+const WorkloadConfig& WorkloadGenerator::getConfig() const {
+    return config;
+}
@@ -0,0 +1,91 @@
+#ifndef WORKLOADGENERATOR_H
+#define WORKLOADGENERATOR_H
+
+#include "EventReader.h"
+#include <string>
+#include <vector>
+
+// A stretch of extra arrivals on top of the normal rate, such as a
+// mass-casualty event. Its arrivals are always new patients of one service
+// type, with urgency spread evenly from minUrgency to 5.
+struct WorkloadBurst {
+    int startMinute;
+    int minutes;
+    double arrivalsPerHour;
+    int minUrgency;
+    std::string serviceType;
+};
+
+struct WorkloadServiceShare {
+    std::string serviceType;
+    double weight;
+};
+
+// What to generate. Minute 0 is midnight, so hourlyRateFactors[h] scales
+// the arrival rate during hour h of each simulated day. Weights are
+// relative and need not sum to 1.
+struct WorkloadConfig {
+    unsigned long long seed = 1;
+    int durationMinutes = 24 * 60;
+    double arrivalsPerHour = 60.0;
+    // Empty means the same rate all day; otherwise 24 factors.
+    std::vector<double> hourlyRateFactors;
+    std::vector<WorkloadBurst> bursts;
+    // Weights for urgency 1 to 5.
+    double urgencyWeights[5] = { 0.30, 0.30, 0.20, 0.12, 0.08 };
+    std::vector<WorkloadServiceShare> serviceMix = {
+        { "Emergency", 0.10 }, { "Critical", 0.20 }, { "Checkup", 0.70 }
+    };
+    // Chance that an arrival is a patient who came before. Earlier patients
+    // are picked more often the higher returnSkew is, so a few become
+    // frequent visitors.
+    double returningFraction = 0.15;
+    double returnSkew = 3.0;
+    int firstPatientId = 1;
+    // Whether arrivals add to visit counts when run through
+    // SimulationManager, so returning patients earn the visit bonus.
+    bool countVisits = true;
+
+    // A weekday profile: quiet at night, busiest late morning and early
+    // evening.
+    static WorkloadConfig typicalDay(unsigned long long seed, double arrivalsPerHour);
+};
+
+// Produces simulation events one at a time, in timestamp order, from a
+// seeded arrival process, keeping no per-event state, so a run of any
+// length takes constant memory. Arrivals follow a Poisson process whose
+// rate varies by hour of day and bursts, drawn by thinning at the
+// highest rate. The random numbers come from a fixed generator rather than
+// <random>'s distributions, whose output differs between standard
+// libraries, so a seed gives the same events on every platform.
+class WorkloadGenerator {
+private:
+    WorkloadConfig config;
+    double maxRatePerMinute;
+    std::vector<double> urgencyCumulative;
+    std::vector<double> serviceCumulative;
+
+    unsigned long long state;
+    double minute;
+    int nextPatientId;
+    long long generated;
+
+    unsigned long long nextRandom();
+    double uniform();
+    int pick(const std::vector<double>& cumulative);
+    double baseRateAt(double minute) const;
+    double burstRateAt(const WorkloadBurst& burst, double minute) const;
+
+public:
+    WorkloadGenerator(const WorkloadConfig& config);
+
+    // The next arrival, or false once the configured duration is over.
+    bool next(SimulationEvent& event);
+    // Starts again from the seed; the same events follow.
+    void reset();
+
+    long long generatedCount() const;
+    const WorkloadConfig& getConfig() const;
+};
+
+#endif
@@ -0,0 +1,131 @@
+// Admission-plus-serve throughput of one QueueManager shared by T triage
+// threads calling addPatient and T counter threads calling serveNextPatient,
+// for T = 1, 2, 4, 8 and 16, and a check that every patient added is served
+// exactly once. Not part of the Visual Studio project; build from this
+// directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. ConcurrencyBenchmark.cpp ../Clock.cpp
+//       ../FileIO.cpp ../Journal.cpp ../Logger.cpp ../Patient.cpp
+//       ../PatientPool.cpp ../PriorityEngine.cpp ../QueueManager.cpp
+//       ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp ../Snapshot.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../VisitCounter.cpp
+//       -o concurrency_benchmark
+//
+// Usage: concurrency_benchmark [patients per triage thread] [max threads]
+// Numbers only mean parallel speedup on a machine with at least 2T cores.
+
+#include "Logger.h"
+#include "PriorityEngine.h"
+#include "QueueManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int HISTORY_RECORDS = 100000;
+const char* TYPES[] = { "Emergency", "Critical", "Checkup" };
+
+int waiting(QueueManager& queue) {
+    int count = 0;
+    for (const char* type : TYPES) {
+        count += queue.getQueueSize(type);
+    }
+    return count;
+}
+
+struct RunResult {
+    long long added;
+    long long served;
+    long long duplicates;
+    int leftWaiting;
+    double seconds;
+};
+
+RunResult run(int threads, int perThread) {
+    PriorityEngine engine;
+    QueueManager queue(&engine);
+    // Served records are kept for history; cap them so long runs stay small.
+    queue.setHistoryRetention(0, HISTORY_RECORDS);
+
+    long long total = static_cast<long long>(threads) * perThread;
+    std::vector<std::atomic<unsigned char>> seen(static_cast<size_t>(total));
+    std::atomic<long long> added(0);
+    std::atomic<long long> served(0);
+    std::atomic<long long> duplicates(0);
+    std::atomic<int> producersLeft(threads);
+    std::atomic<bool> start(false);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            while (!start) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < perThread; i++) {
+                int id = t * perThread + i;
+                queue.addPatient(id, 1 + id % 5, TYPES[id % 3]);
+            }
+            added += perThread;
+            producersLeft--;
+        });
+        workers.emplace_back([&]() {
+            while (!start) {
+                std::this_thread::yield();
+            }
+            long long mine = 0;
+            while (true) {
+                Patient* patient = queue.serveNextPatient();
+                if (patient) {
+                    if (seen[patient->getId()].fetch_add(1) != 0) {
+                        duplicates++;
+                    }
+                    mine++;
+                    continue;
+                }
+                // Nothing waiting: done once the producers are, and the
+                // queue is still empty after they finished.
+                if (producersLeft == 0 && waiting(queue) == 0) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            served += mine;
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return RunResult{ added, served, duplicates, waiting(queue), seconds };
+}
+
+}
+
+int main(int argc, char** argv) {
+    int perThread = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 16;
+    Logger::get().setLevel(LogLevel::OFF);
+
+    std::cout << perThread << " patients per triage thread, " << std::thread::hardware_concurrency()
+        << " hardware threads\n";
+    std::cout << "triage+counter threads   Mops/s   added   served   ok\n";
+    bool allOk = true;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        RunResult result = run(threads, perThread);
+        bool ok = result.served == result.added && result.duplicates == 0 && result.leftWaiting == 0;
+        allOk = allOk && ok;
+        double mops = (result.added + result.served) / result.seconds / 1e6;
+        std::cout << std::setw(10) << threads << "+" << std::left << std::setw(13) << threads << std::right
+            << std::fixed << std::setprecision(2) << std::setw(7) << mops << std::setw(9) << result.added
+            << std::setw(9) << result.served << "   " << (ok ? "yes" : "NO") << "\n";
+    }
+    return allOk ? 0 : 1;
+}
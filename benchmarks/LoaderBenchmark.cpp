@@ -0,0 +1,100 @@
+// Throughput of EventReader on a large minified scenario file, next to
+// plain chunked reads of the same file as the ceiling. Run it twice if the
+// first pass should come from the page cache rather than the disk. Not part
+// of the Visual Studio project; build from this directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. LoaderBenchmark.cpp ../Clock.cpp
+//       ../EventQueue.cpp ../EventReader.cpp ../FileIO.cpp ../Journal.cpp
+//       ../Logger.cpp ../Patient.cpp ../PatientPool.cpp ../PriorityEngine.cpp
+//       ../QueueManager.cpp ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp
+//       ../SimulationManager.cpp ../Snapshot.cpp ../StaffingModel.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../VisitCounter.cpp
+//       ../WorkloadGenerator.cpp -o loader_benchmark
+//
+// Usage: loader_benchmark [events]
+// Writes bench_events.json in the working directory.
+
+#include "EventReader.h"
+#include "Logger.h"
+#include "PriorityEngine.h"
+#include "QueueManager.h"
+#include "SimulationManager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char* EVENTS_PATH = "bench_events.json";
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+long long writeEvents(int count) {
+    const char* types[] = { "Emergency", "Critical", "Checkup" };
+    std::FILE* out = std::fopen(EVENTS_PATH, "wb");
+    if (!out) {
+        return 0;
+    }
+    std::fputs("{\"simulation_events\":[", out);
+    for (int i = 0; i < count; i++) {
+        std::fprintf(out, "%s{\"timestamp\":%d,\"patientId\":%d,\"urgency\":%d,\"serviceType\":\"%s\"}",
+            i > 0 ? "," : "", static_cast<int>(i * 1440LL / count), i, 1 + i % 5, types[i % 3]);
+    }
+    std::fputs("]}", out);
+    long long size = std::ftell(out);
+    std::fclose(out);
+    return size;
+}
+
+void printRate(const char* label, double seconds, long long bytes) {
+    std::cout << std::left << std::setw(24) << label << std::setw(10) << seconds * 1000 << " ms  "
+        << bytes / seconds / (1024 * 1024) << " MB/s\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? std::atoi(argv[1]) : 5000000;
+    Logger::get().setLevel(LogLevel::OFF);
+
+    long long bytes = writeEvents(count);
+    std::cout << count << " events, " << bytes / (1024 * 1024) << " MB minified\n";
+
+    auto start = std::chrono::steady_clock::now();
+    std::FILE* in = std::fopen(EVENTS_PATH, "rb");
+    std::vector<char> chunk(EventReader::BUFFER_SIZE);
+    long long read = 0;
+    size_t got;
+    while ((got = std::fread(chunk.data(), 1, chunk.size(), in)) > 0) {
+        read += got;
+    }
+    std::fclose(in);
+    printRate("chunked read only", secondsSince(start), read);
+
+    start = std::chrono::steady_clock::now();
+    EventReader reader;
+    reader.open(EVENTS_PATH);
+    SimulationEvent event;
+    long long parsed = 0;
+    while (reader.next(event)) {
+        parsed++;
+    }
+    printRate("EventReader", secondsSince(start), bytes);
+    if (parsed != count || reader.failed()) {
+        std::cout << "parsed " << parsed << " events, failed " << reader.failed() << "\n";
+        return 1;
+    }
+
+    PriorityEngine engine;
+    QueueManager queue(&engine);
+    SimulationManager simulation(&queue);
+    start = std::chrono::steady_clock::now();
+    simulation.loadSimulation(EVENTS_PATH);
+    printRate("loadSimulation", secondsSince(start), bytes);
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Restart time for a QueueManager holding a large service history: replaying
+// the whole journal versus mapping a snapshot and replaying the journal tail.
+// Also reports how long serving stalls while a snapshot is taken. Not part
+// of the Visual Studio project; build from this directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. RecoveryBenchmark.cpp ../Clock.cpp
+//       ../FileIO.cpp ../Journal.cpp ../Logger.cpp ../Patient.cpp
+//       ../PatientPool.cpp ../PriorityEngine.cpp ../QueueManager.cpp
+//       ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp ../Snapshot.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../VisitCounter.cpp
+//       -o recovery_benchmark
+//
+// Usage: recovery_benchmark [history records] [tail records]
+// Writes bench.journal and bench.snapshot in the working directory.
+
+#include "Logger.h"
+#include "PriorityEngine.h"
+#include "QueueManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const char* JOURNAL_PATH = "bench.journal";
+const char* SNAPSHOT_PATH = "bench.snapshot";
+const int WAITING = 1000;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Keeps WAITING patients queued and serves `count` of them.
+void serveMany(QueueManager& queue, int& nextId, int count) {
+    const char* types[] = { "Emergency", "Critical", "Checkup" };
+    time_t now = time(0);
+    for (int i = 0; i < count; i++) {
+        int id = nextId++;
+        queue.addPatientAtTime(id, 1 + id % 5, types[id % 3], now - id % 3600);
+        queue.serveNextPatient();
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    int historyCount = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int tailCount = argc > 2 ? std::atoi(argv[2]) : 10000;
+    std::remove(JOURNAL_PATH);
+    std::remove(SNAPSHOT_PATH);
+    Logger::get().setLevel(LogLevel::OFF);
+
+    int nextId = 0;
+    {
+        PriorityEngine engine(0);
+        QueueManager queue(&engine);
+        queue.recover(SNAPSHOT_PATH, JOURNAL_PATH);
+        queue.setHistoryRetention(0, 0);
+        time_t now = time(0);
+        for (; nextId < WAITING; nextId++) {
+            queue.addPatientAtTime(nextId, 1 + nextId % 5, "Checkup", now);
+        }
+        serveMany(queue, nextId, historyCount);
+        queue.syncJournal();
+    }
+
+    std::cout << historyCount << " history records, " << WAITING << " waiting\n";
+
+    double journalOnly;
+    {
+        PriorityEngine engine(0);
+        QueueManager queue(&engine);
+        auto start = std::chrono::steady_clock::now();
+        queue.openJournal(JOURNAL_PATH);
+        journalOnly = secondsSince(start);
+    }
+
+    double snapshotWrite;
+    double longestStall = 0.0;
+    {
+        PriorityEngine engine(0);
+        QueueManager queue(&engine);
+        queue.recover(SNAPSHOT_PATH, JOURNAL_PATH);
+
+        // A second counter keeps serving while the snapshot is taken; its
+        // slowest single admission-plus-serve is the stall.
+        std::atomic<bool> done(false);
+        int counterId = 1 << 30;
+        std::thread counter([&]() {
+            const char* types[] = { "Emergency", "Critical", "Checkup" };
+            while (!done) {
+                auto start = std::chrono::steady_clock::now();
+                queue.addPatient(counterId, 1 + counterId % 5, types[counterId % 3]);
+                queue.serveNextPatient();
+                counterId++;
+                double took = secondsSince(start);
+                if (took > longestStall) longestStall = took;
+            }
+        });
+        auto start = std::chrono::steady_clock::now();
+        queue.writeSnapshot();
+        snapshotWrite = secondsSince(start);
+        done = true;
+        counter.join();
+
+        serveMany(queue, nextId, tailCount);
+        queue.syncJournal();
+    }
+
+    double fromSnapshot;
+    int restoredHistory;
+    {
+        PriorityEngine engine(0);
+        QueueManager queue(&engine);
+        auto start = std::chrono::steady_clock::now();
+        queue.recover(SNAPSHOT_PATH, JOURNAL_PATH);
+        fromSnapshot = secondsSince(start);
+        restoredHistory = queue.getRetainedHistoryCount();
+    }
+
+    std::cout << std::left << std::setw(28) << "journal replay" << journalOnly * 1000 << " ms\n";
+    std::cout << std::setw(28) << "snapshot write" << snapshotWrite * 1000 << " ms (longest serving stall "
+        << longestStall * 1000 << " ms)\n";
+    std::cout << std::setw(28) << "snapshot + journal tail" << fromSnapshot * 1000 << " ms ("
+        << tailCount << " tail records, " << restoredHistory << " history records restored, "
+        << journalOnly / fromSnapshot << "x)\n";
+    return 0;
+}
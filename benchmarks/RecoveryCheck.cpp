@@ -0,0 +1,273 @@
+// Checks that recovery rebuilds the queue exactly. Each seed drives a random
+// mix of admissions (single, timed and batched, with urgencies outside 1-5
+// and returning patients), serves (next, batched, by ID and at counters),
+// removals, manual score overrides and rescores, ticks, lane merges, weight,
+// service-type, fairness, scoring-mode and retention changes against a
+// journaled QueueManager on a virtual clock. The same run is made twice: once
+// with the journal alone, once with a snapshot taken halfway. Each is then
+// recovered from its files on a fresh QueueManager, and all four queues are
+// drained; the recovered ones must serve the same patients in the same order
+// as the live ones, and keep the same history. Not part of the Visual Studio
+// project; build from this directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. RecoveryCheck.cpp ../Clock.cpp
+//       ../FileIO.cpp ../Journal.cpp ../Logger.cpp ../Patient.cpp
+//       ../PatientPool.cpp ../PriorityEngine.cpp ../QueueManager.cpp
+//       ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp ../Snapshot.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../VisitCounter.cpp
+//       -o recovery_check
+//
+// Usage: recovery_check [seeds] [operations per run]
+// Writes check.journal and check.snapshot (and copies) in the working
+// directory.
+
+#include "Clock.h"
+#include "Logger.h"
+#include "PriorityEngine.h"
+#include "QueueManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* JOURNAL_PATH = "check.journal";
+const char* SNAPSHOT_PATH = "check.snapshot";
+const char* JOURNAL_COPY = "check.journal.copy";
+const char* SNAPSHOT_COPY = "check.snapshot.copy";
+const time_t START = 1700000000;
+const int PATIENT_IDS = 400;
+
+struct Outcome {
+    std::vector<int> served;
+    int history;
+    time_t endTime;
+};
+
+class Random {
+private:
+    unsigned long long state;
+
+public:
+    Random(unsigned long long seed) : state(seed) {}
+
+    unsigned long long next() {
+        unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    int below(int n) {
+        return static_cast<int>(next() % static_cast<unsigned long long>(n));
+    }
+};
+
+bool copyFile(const char* from, const char* to) {
+    std::remove(to);
+    std::ifstream in(from, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+    return static_cast<bool>(out);
+}
+
+// Serves everyone left, the way a single server would, at the queue's
+// current time.
+Outcome drain(QueueManager& queue) {
+    Outcome outcome;
+    while (Patient* patient = queue.serveNextPatient()) {
+        outcome.served.push_back(patient->getId());
+    }
+    outcome.history = queue.getRetainedHistoryCount();
+    outcome.endTime = queue.getClock()->now();
+    return outcome;
+}
+
+int urgencyFor(Random& random) {
+    // Mostly the usual 1-5, sometimes well outside it.
+    static const int unusual[] = { -1, 0, 6, 255, 256, 300, -300 };
+    return random.below(8) == 0 ? unusual[random.below(7)] : 1 + random.below(5);
+}
+
+const std::string& typeFor(Random& random, const std::vector<std::string>& types) {
+    return types[random.below(static_cast<int>(types.size()))];
+}
+
+// One run of the operation mix. The live queue is drained after its files
+// are copied, so the drain itself is not part of what gets recovered.
+Outcome runLive(unsigned long long seed, int operations, bool withSnapshot) {
+    std::remove(JOURNAL_PATH);
+    std::remove(SNAPSHOT_PATH);
+    VirtualClock clock(START);
+    PriorityEngine engine(0);
+    QueueManager queue(&engine);
+    queue.setClock(&clock);
+    queue.recover(withSnapshot ? SNAPSHOT_PATH : "", JOURNAL_PATH);
+
+    Random random(seed);
+    // "Imaging" is not registered until a service-type change adds it; until
+    // then its patients wait in the Checkup lane.
+    std::vector<std::string> types = { "Emergency", "Critical", "Checkup", "Imaging" };
+    CounterId counters[] = {
+        queue.addCounter("Front desk", { "Emergency", "Critical" }),
+        queue.addCounter("Clinic", { "Checkup" })
+    };
+
+    for (int op = 0; op < operations; op++) {
+        if (withSnapshot && op == operations / 2) {
+            queue.writeSnapshot();
+        }
+        clock.advance(random.below(20));
+        time_t now = clock.now();
+        int id = random.below(PATIENT_IDS);
+
+        switch (random.below(20)) {
+        case 0: case 1: case 2: case 3:
+            queue.addPatient(id, urgencyFor(random), typeFor(random, types));
+            break;
+        case 4: case 5:
+            queue.addPatientAtTime(id, urgencyFor(random), typeFor(random, types), now - random.below(7200));
+            break;
+        case 6: {
+            std::vector<PatientArrival> arrivals;
+            for (int i = random.below(6); i >= 0; i--) {
+                arrivals.push_back(PatientArrival{ random.below(PATIENT_IDS), urgencyFor(random),
+                    typeFor(random, types), now - random.below(3600) });
+            }
+            queue.addPatients(arrivals, random.below(2) == 0);
+            break;
+        }
+        case 7: case 8:
+            queue.serveNextPatient();
+            break;
+        case 9: {
+            std::vector<Patient*> served;
+            queue.serveNext(1 + random.below(4), served);
+            break;
+        }
+        case 10:
+            queue.servePatientById(id);
+            break;
+        case 11:
+            queue.removePatientById(id);
+            break;
+        case 12:
+            if (random.below(2) == 0) {
+                queue.updatePatientScore(id, static_cast<float>(random.below(400)) / 10.0f);
+            }
+            else {
+                queue.rescorePatient(id, now);
+            }
+            break;
+        case 13: case 14:
+            queue.updatePriorities(now);
+            break;
+        case 15:
+            queue.mergeQueues();
+            break;
+        case 16: {
+            CounterId counter = counters[random.below(2)];
+            queue.finishService(counter);
+            queue.serveAtCounter(counter);
+            break;
+        }
+        case 17:
+            if (random.below(2) == 0) {
+                float weights[] = { 0.5f + random.below(4) * 0.25f, 0.01f * random.below(5), 0.5f + random.below(3) * 0.25f };
+                queue.reconfigure([&]() { engine.setWeights(weights[0], weights[1], weights[2]); },
+                    JournalRecord::weightChange(weights[0], weights[1], weights[2]));
+            }
+            else {
+                const std::string& type = types[1 + random.below(3)];
+                float score = static_cast<float>(2 + random.below(9));
+                queue.reconfigure([&]() { engine.setServiceTypeScore(type, score); },
+                    JournalRecord::serviceTypeScore(type, score));
+            }
+            break;
+        case 18:
+            if (random.below(2) == 0) {
+                queue.setFairnessParams(5 + random.below(60), 0.1f * (1 + random.below(10)));
+            }
+            else {
+                queue.setScoringMode(random.below(2) == 0 ? ScoringMode::ARRIVAL_ANCHORED : ScoringMode::RECOMPUTE);
+            }
+            break;
+        case 19:
+            queue.setHistoryRetention(random.below(3), 50 + random.below(500));
+            break;
+        }
+    }
+
+    queue.syncJournal();
+    copyFile(JOURNAL_PATH, JOURNAL_COPY);
+    std::remove(SNAPSHOT_COPY);
+    if (withSnapshot) {
+        copyFile(SNAPSHOT_PATH, SNAPSHOT_COPY);
+    }
+    return drain(queue);
+}
+
+Outcome recoverCopies(bool withSnapshot, time_t now, long long& replayed) {
+    VirtualClock clock(now);
+    PriorityEngine engine(0);
+    QueueManager queue(&engine);
+    queue.setClock(&clock);
+    replayed = queue.recover(withSnapshot ? SNAPSHOT_COPY : "", JOURNAL_COPY);
+    return drain(queue);
+}
+
+// Prints where two drains part ways; returns whether they match.
+bool compare(const char* what, unsigned long long seed, const Outcome& live, const Outcome& recovered) {
+    if (live.served == recovered.served && live.history == recovered.history) {
+        return true;
+    }
+    size_t at = 0;
+    while (at < live.served.size() && at < recovered.served.size() && live.served[at] == recovered.served[at]) {
+        at++;
+    }
+    std::cout << "seed " << seed << ": " << what << " serves " << recovered.served.size() << " of "
+        << live.served.size() << " patients, history " << recovered.history << " of " << live.history
+        << ", first difference at position " << at << "\n";
+    return false;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int seeds = argc > 1 ? std::atoi(argv[1]) : 50;
+    int operations = argc > 2 ? std::atoi(argv[2]) : 4000;
+    Logger::get().setLevel(LogLevel::OFF);
+
+    int passed = 0;
+    long long drained = 0;
+    for (int s = 1; s <= seeds; s++) {
+        unsigned long long seed = static_cast<unsigned long long>(s);
+        long long replayed;
+
+        Outcome journalLive = runLive(seed, operations, false);
+        Outcome fromJournal = recoverCopies(false, journalLive.endTime, replayed);
+        bool ok = replayed >= 0 && compare("journal-only recovery", seed, journalLive, fromJournal);
+
+        Outcome snapshotLive = runLive(seed, operations, true);
+        Outcome fromSnapshot = recoverCopies(true, snapshotLive.endTime, replayed);
+        ok = compare("snapshot run", seed, journalLive, snapshotLive) && ok;
+        ok = replayed >= 0 && compare("snapshot + journal tail recovery", seed, snapshotLive, fromSnapshot) && ok;
+
+        passed += ok ? 1 : 0;
+        drained += static_cast<long long>(journalLive.served.size());
+    }
+
+    std::cout << passed << " of " << seeds << " seeds recover exactly (" << operations << " operations each, "
+        << drained << " patients drained in all)\n";
+    std::remove(JOURNAL_PATH);
+    std::remove(SNAPSHOT_PATH);
+    std::remove(JOURNAL_COPY);
+    std::remove(SNAPSHOT_COPY);
+    return passed == seeds ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+// Scored-patients-per-second for full per-patient scoring versus
+// PriorityEngine::scoreBatch over cached score parts with each kernel, plus a
+// whole QueueManager::updatePriorities tick. Not part of the Visual Studio project;
+// build from this directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. ScoringBenchmark.cpp ../Clock.cpp
+//       ../FileIO.cpp ../Journal.cpp ../Logger.cpp ../Patient.cpp
+//       ../PatientPool.cpp ../PriorityEngine.cpp ../QueueManager.cpp
+//       ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp ../Snapshot.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../VisitCounter.cpp
+//       -o scoring_benchmark
+//
+// Usage: scoring_benchmark [patients] [worker threads]
+
+#include "PriorityEngine.h"
+#include "PatientPool.h"
+#include "QueueManager.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const int ROUNDS = 20;
+const int MAX_WAIT_MINUTES = 25;
+const float BOOST = 0.5f;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* kernelName(BatchKernel kernel) {
+    switch (kernel) {
+    case BatchKernel::SCALAR: return "scalar";
+    case BatchKernel::SSE2: return "sse2";
+    case BatchKernel::AVX2: return "avx2";
+    default: return "auto";
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int workers = argc > 2 ? std::atoi(argv[2]) : ThreadPool::defaultWorkerCount();
+    const char* types[] = { "Emergency", "Critical", "Checkup" };
+    time_t now = 1000000;
+
+    PriorityEngine engine(workers);
+    PatientPool pool;
+    std::vector<PatientHandle> handles(count);
+    ScoreBatch batch;
+    batch.resize(count);
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        int typeId = (seed >> 8) % 3;
+        handles[i] = pool.allocate(i, 1 + (seed >> 16) % 5, types[typeId], typeId);
+        Patient* patient = pool.get(handles[i]);
+        patient->setArrivalTime(now - (seed >> 4) % 7200);
+        engine.cacheScoreParts(*patient, nullptr);
+
+        batch.staticScore[i] = patient->getStaticScore();
+        batch.waitRate[i] = patient->getWaitRate();
+        batch.waitSeconds[i] = static_cast<int>(now - patient->getArrivalTime());
+    }
+
+    std::cout << count << " patients, " << ROUNDS << " rounds each\n";
+
+    std::vector<float> reference(count);
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < count; i++) {
+            Patient* patient = pool.get(handles[i]);
+            float score = engine.calculatePriorityScore(*patient, now);
+            int waitMinutes = static_cast<int>(now - patient->getArrivalTime()) / 60;
+            if (waitMinutes > MAX_WAIT_MINUTES) {
+                score += static_cast<float>(waitMinutes - MAX_WAIT_MINUTES) * BOOST;
+            }
+            reference[i] = score;
+        }
+    }
+    double baseline = count * static_cast<double>(ROUNDS) / secondsSince(start);
+    std::cout << std::left << std::setw(20) << "per-patient" << baseline / 1e6 << " M patients/s\n";
+
+    BatchKernel kernels[] = { BatchKernel::SCALAR, BatchKernel::SSE2, BatchKernel::AVX2 };
+    for (BatchKernel kernel : kernels) {
+        engine.setBatchKernel(kernel);
+        if (engine.getBatchKernel() != kernel) {
+            std::cout << "batch " << std::setw(14) << kernelName(kernel) << "not supported here\n";
+            continue;
+        }
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++) {
+            engine.scoreBatch(batch, MAX_WAIT_MINUTES, BOOST);
+        }
+        double rate = count * static_cast<double>(ROUNDS) / secondsSince(start);
+
+        int mismatches = 0;
+        for (int i = 0; i < count; i++) {
+            if (batch.scores[i] != reference[i]) mismatches++;
+        }
+        std::cout << "batch " << std::setw(14) << kernelName(kernel) << rate / 1e6 << " M patients/s ("
+            << rate / baseline << "x, " << mismatches << " mismatches)\n";
+    }
+    engine.setBatchKernel(BatchKernel::AUTO);
+    std::cout << std::setw(20) << "worker threads" << workers << " + caller\n";
+
+    QueueManager queue(&engine);
+    std::cout.setstate(std::ios::failbit);
+    for (int i = 0; i < count; i++) {
+        Patient* patient = pool.get(handles[i]);
+        queue.addPatientAtTime(i, patient->getUrgency(), patient->getServiceType(), patient->getArrivalTime());
+    }
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        queue.updatePriorities(now + round * 60);
+    }
+    double tick = secondsSince(start) / ROUNDS;
+    std::cout.clear();
+    std::cout << std::setw(20) << "updatePriorities" << tick * 1000 << " ms per tick\n";
+    return 0;
+}
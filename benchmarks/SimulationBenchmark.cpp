@@ -0,0 +1,92 @@
+// A day-long scenario fast-forwarded through SimulationManager::runHeadless.
+// Runs it twice, a second of wall time apart, on fresh queues and checks that
+// both give the same serving order and service times. Not part of the Visual
+// Studio project; build from this directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. SimulationBenchmark.cpp ../Clock.cpp
+//       ../EventQueue.cpp ../EventReader.cpp ../FileIO.cpp ../Journal.cpp
+//       ../Logger.cpp ../Patient.cpp ../PatientPool.cpp ../PriorityEngine.cpp
+//       ../QueueManager.cpp ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp
+//       ../SimulationManager.cpp ../Snapshot.cpp ../StaffingModel.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../VisitCounter.cpp
+//       ../WorkloadGenerator.cpp -o simulation_benchmark
+//
+// Usage: simulation_benchmark [arrivals]
+
+#include "Logger.h"
+#include "PriorityEngine.h"
+#include "QueueManager.h"
+#include "SimulationManager.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int MINUTES_PER_DAY = 24 * 60;
+
+struct RunResult {
+    SimulationSummary summary;
+    double seconds;
+    std::vector<int> servedIds;
+    std::vector<time_t> serviceTimes;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+RunResult runOnce(int arrivals) {
+    PriorityEngine engine;
+    QueueManager queue(&engine);
+    SimulationManager simulation(&queue);
+
+    // A fixed linear congruential sequence, so both runs see the same day.
+    const char* types[] = { "Emergency", "Critical", "Checkup" };
+    unsigned int state = 12345;
+    for (int i = 0; i < arrivals; i++) {
+        state = state * 1103515245u + 12345u;
+        int minute = static_cast<int>((state >> 8) % MINUTES_PER_DAY);
+        simulation.addEvent(minute, i, 1 + (state >> 4) % 5, types[(state >> 16) % 3]);
+    }
+
+    RunResult result;
+    auto start = std::chrono::steady_clock::now();
+    result.summary = simulation.runHeadless();
+    result.seconds = secondsSince(start);
+
+    std::vector<Patient*> served;
+    while (queue.serveNext(4096, served) > 0) {
+        for (Patient* patient : served) {
+            result.servedIds.push_back(patient->getId());
+            result.serviceTimes.push_back(patient->getServiceTime());
+        }
+        served.clear();
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int arrivals = argc > 1 ? std::atoi(argv[1]) : 100000;
+    Logger::get().setLevel(LogLevel::OFF);
+
+    RunResult first = runOnce(arrivals);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    RunResult second = runOnce(arrivals);
+
+    bool same = first.servedIds == second.servedIds && first.serviceTimes == second.serviceTimes
+        && first.summary.endTime == second.summary.endTime;
+
+    std::cout << arrivals << " arrivals over " << (first.summary.endTime - first.summary.startTime) / 60
+        << " simulated minutes, " << first.summary.waiting << " waiting at the end\n";
+    std::cout << std::left << std::setw(20) << "first run" << first.seconds * 1000 << " ms\n";
+    std::cout << std::setw(20) << "second run" << second.seconds * 1000 << " ms\n";
+    std::cout << std::setw(20) << "reproducible" << (same ? "yes" : "NO") << " ("
+        << first.servedIds.size() << " patients served in the same order)\n";
+    return same ? 0 : 1;
+}
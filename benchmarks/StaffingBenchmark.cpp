@@ -0,0 +1,91 @@
+// Sizes staff against a forecast: fast-forwards the same synthetic week
+// through SimulationManager with more and more counters per lane and
+// prints wait percentiles and utilization for each, then runs one level
+// again on a fresh queue and checks it serves identically. Not part of the
+// Visual Studio project; build from this directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. StaffingBenchmark.cpp ../Clock.cpp
+//       ../EventQueue.cpp ../EventReader.cpp ../FileIO.cpp ../Journal.cpp
+//       ../Logger.cpp ../Patient.cpp ../PatientPool.cpp ../PriorityEngine.cpp
+//       ../QueueManager.cpp ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp
+//       ../SimulationManager.cpp ../Snapshot.cpp ../StaffingModel.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../VisitCounter.cpp
+//       ../WorkloadGenerator.cpp -o staffing_benchmark
+//
+// Usage: staffing_benchmark [arrivals per hour] [days]
+
+#include "Logger.h"
+#include "PriorityEngine.h"
+#include "QueueManager.h"
+#include "SimulationManager.h"
+#include "StaffingModel.h"
+#include "WorkloadGenerator.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+struct StaffedRun {
+    StaffingReport report;
+    SimulationSummary summary;
+    double seconds;
+};
+
+StaffedRun runWeek(double arrivalsPerHour, int days, int countersPerLane) {
+    PriorityEngine engine;
+    QueueManager queue(&engine);
+    SimulationManager simulation(&queue);
+    StaffingConfig staffing = StaffingConfig::evenStaffing(7, countersPerLane);
+    staffing.floatingCounters = 2;
+    simulation.setStaffing(staffing);
+
+    WorkloadConfig config = WorkloadConfig::typicalDay(42, arrivalsPerHour);
+    config.durationMinutes = days * 24 * 60;
+    WorkloadGenerator generator(config);
+
+    StaffedRun run;
+    auto start = std::chrono::steady_clock::now();
+    run.summary = simulation.runHeadless(generator);
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    run.report = simulation.getStaffingReport();
+    return run;
+}
+
+}
+
+int main(int argc, char** argv) {
+    double arrivalsPerHour = argc > 1 ? std::atof(argv[1]) : 120.0;
+    int days = argc > 2 ? std::atoi(argv[2]) : 7;
+    Logger::get().setLevel(LogLevel::OFF);
+
+    std::cout << arrivalsPerHour << " arrivals per hour on average over " << days
+        << " days, 2 floating counters\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "per lane   served   p50 min   p90 min   p99 min   busy %   redirects   run ms\n";
+    StaffedRun last;
+    int lastLevel = 0;
+    for (int counters = 4; counters <= 12; counters += 2) {
+        StaffedRun run = runWeek(arrivalsPerHour, days, counters);
+        double busy = 0.0;
+        for (const LaneStaffingReport& lane : run.report.lanes) {
+            busy += lane.utilization / run.report.lanes.size();
+        }
+        std::cout << std::setw(8) << counters << std::setw(9) << run.report.served
+            << std::setw(10) << run.report.waitP50Minutes << std::setw(10) << run.report.waitP90Minutes
+            << std::setw(10) << run.report.waitP99Minutes << std::setw(9) << busy * 100
+            << std::setw(12) << run.report.redirects << std::setw(9) << run.seconds * 1000 << "\n";
+        last = run;
+        lastLevel = counters;
+    }
+
+    StaffedRun again = runWeek(arrivalsPerHour, days, lastLevel);
+    bool same = again.report.served == last.report.served
+        && again.report.meanWaitMinutes == last.report.meanWaitMinutes
+        && again.report.maxWaitMinutes == last.report.maxWaitMinutes
+        && again.report.redirects == last.report.redirects
+        && again.summary.endTime == last.summary.endTime;
+    std::cout << "reproducible        " << (same ? "yes" : "NO") << "\n";
+    return same ? 0 : 1;
+}
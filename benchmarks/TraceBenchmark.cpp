@@ -0,0 +1,143 @@
+// Records a long mixed session (arrivals, batches, serves, removals, visits,
+// re-scoring and the odd fairness change) to a trace, then replays it on a
+// fresh queue and checks that every serve comes out the same. Reports the
+// cost of recording, the trace size and the replay rate. Not part of the
+// Visual Studio project; build from this directory with, for example:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. TraceBenchmark.cpp ../Clock.cpp
+//       ../FileIO.cpp ../Journal.cpp ../Logger.cpp ../Patient.cpp
+//       ../PatientPool.cpp ../PriorityEngine.cpp ../QueueManager.cpp
+//       ../ServiceHistory.cpp ../ServiceTypeRegistry.cpp ../Snapshot.cpp
+//       ../ThreadPool.cpp ../Trace.cpp ../TraceReplayer.cpp
+//       ../VisitCounter.cpp -o trace_benchmark
+//
+// Usage: trace_benchmark [operations]
+// Writes bench_session.trace in the working directory.
+
+#include "Logger.h"
+#include "PriorityEngine.h"
+#include "QueueManager.h"
+#include "Trace.h"
+#include "TraceReplayer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char* TRACE_PATH = "bench_session.trace";
+const time_t SESSION_START = 1704067200;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The same session every time: a fixed linear congruential sequence picks
+// each call, and the clock moves a few seconds between calls.
+double runSession(int operations, TraceWriter* writer) {
+    PriorityEngine engine;
+    QueueManager queue(&engine);
+    VirtualClock clock(SESSION_START);
+    queue.setClock(&clock);
+    queue.setTraceWriter(writer);
+
+    const char* types[] = { "Emergency", "Critical", "Checkup" };
+    unsigned int state = 12345;
+    int nextId = 0;
+    std::vector<PatientArrival> batch;
+    std::vector<Patient*> served;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < operations; i++) {
+        state = state * 1103515245u + 12345u;
+        unsigned int pick = (state >> 8) % 100;
+        clock.advance(1 + (state >> 20) % 20);
+        int urgency = 1 + (state >> 4) % 5;
+        const char* type = types[(state >> 16) % 3];
+        // Mostly new patients, some returning ones.
+        int id = (state >> 12) % 4 == 0 && nextId > 0 ? static_cast<int>((state >> 10) % nextId) : nextId++;
+
+        if (pick < 40) {
+            queue.addPatient(id, urgency, type);
+        }
+        else if (pick < 44) {
+            batch.clear();
+            for (int j = 0; j < 4; j++) {
+                batch.push_back(PatientArrival{ nextId++, 1 + j % 5, types[j % 3], 0 });
+            }
+            queue.addPatients(batch, (state >> 5) % 2 == 0);
+        }
+        else if (pick < 70) {
+            queue.serveNextPatient();
+        }
+        else if (pick < 75) {
+            queue.serveNext(8, served);
+        }
+        else if (pick < 80) {
+            queue.servePatientById(id);
+        }
+        else if (pick < 85) {
+            queue.removePatientById(id);
+        }
+        else if (pick < 87) {
+            queue.updatePriorities(clock.now());
+        }
+        else if (pick < 99) {
+            queue.incrementVisitCount(id);
+        }
+        else if ((state >> 4) % 16 == 0) {
+            queue.setFairnessParams(15 + (state >> 6) % 20, 0.25f + ((state >> 7) % 4) * 0.25f);
+        }
+    }
+    double seconds = secondsSince(start);
+    queue.setTraceWriter(nullptr);
+    return seconds;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int operations = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    Logger::get().setLevel(LogLevel::OFF);
+
+    double plain = runSession(operations, nullptr);
+
+    TraceWriter writer;
+    if (!writer.open(TRACE_PATH)) {
+        std::cerr << "Cannot create " << TRACE_PATH << "\n";
+        return 1;
+    }
+    double recorded = runSession(operations, &writer);
+    long long records = writer.recordCount();
+    writer.close();
+
+    std::FILE* file = std::fopen(TRACE_PATH, "rb");
+    std::fseek(file, 0, SEEK_END);
+    long long bytes = std::ftell(file);
+    std::fclose(file);
+
+    PriorityEngine engine;
+    QueueManager queue(&engine);
+    TraceReplayer replayer(&queue);
+    TraceReplayResult result = replayer.replay(TRACE_PATH);
+
+    std::cout << operations << " operations, " << records << " trace records, " << bytes / 1024 << " KiB ("
+        << std::fixed << std::setprecision(1) << static_cast<double>(bytes) / records << " bytes per record)\n";
+    std::cout << std::left << std::setw(20) << "live, not recorded" << plain * 1000 << " ms\n";
+    std::cout << std::setw(20) << "live, recorded" << recorded * 1000 << " ms\n";
+    std::cout << std::setw(20) << "replay" << result.seconds * 1000 << " ms, "
+        << static_cast<long long>(result.operations / result.seconds) << " calls/s\n";
+    std::cout << std::setw(20) << "served" << result.served << ", " << result.mismatches << " mismatches";
+    if (result.mismatches > 0) {
+        std::cout << " (first in call " << result.firstMismatch << ")";
+    }
+    std::cout << "\n" << std::setw(20) << "total wait" << result.recordedWaitSeconds << " s recorded, "
+        << result.replayedWaitSeconds << " s replayed\n";
+
+    bool same = result.complete && result.mismatches == 0
+        && result.recordedWaitSeconds == result.replayedWaitSeconds;
+    return same ? 0 : 1;
+}
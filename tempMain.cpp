@@ -4,11 +4,14 @@
 #include "AdminConsole.h"
 #include "AdminUI.h"
 #include "SimulationManager.h"
+#include "TraceReplayer.h"
 #include "ReportManager.h"
+#include "Logger.h"
 #include <iostream>
 #include <ctime>
 #include <thread>
 #include <chrono>
+#include <iomanip>
 using namespace std;
 
 int getIntInput(int min, int max) {
@@ -30,7 +33,7 @@ int getIntInput(int min, int max) {
 void simulateTimePassing(QueueManager& queue, int minutes) {
     cout << "\n⏳ Simulating " << minutes << " minutes...\n";
     this_thread::sleep_for(chrono::seconds(1));
-    queue.updatePriorities(time(0) + minutes * 60);
+    queue.updatePriorities(queue.getClock()->now() + minutes * 60);
 }
 
 void addPatient(QueueManager& queue) {
@@ -43,29 +46,133 @@ void addPatient(QueueManager& queue) {
         << "Select (1-5): ";
     int urgency = getIntInput(1, 5);
 
-    cout << "\n🏷️ Service Type:\n"
-        << "1. Emergency\n2. Critical\n3. Checkup\n"
-        << "Select (1-3): ";
-    int type = getIntInput(1, 3);
+    const ServiceTypeRegistry& types = queue.getServiceTypes();
+    cout << "\n🏷️ Service Type:\n";
+    for (int i = 0; i < types.size(); i++) {
+        cout << i + 1 << ". " << types.nameOf(i) << "\n";
+    }
+    cout << "Select (1-" << types.size() << "): ";
+    int type = getIntInput(1, types.size());
 
-    string types[] = { "Emergency", "Critical", "Checkup" };
-    Patient* p = new Patient(id, urgency, types[type - 1]);
-    queue.addPatient(p);
+    string serviceType = types.nameOf(type - 1);
+    queue.addPatient(id, urgency, serviceType);
+    Logger::get().flush();
 
     cout << "\n✅ Patient added! (ID: " << id
-        << ", " << types[type - 1]
+        << ", " << serviceType
         << ", Urgency: " << urgency << ")\n";
 }
 
+void printHeadlessSummary(const SimulationSummary& summary, double took, QueueManager& scratch) {
+    if (!summary.complete) {
+        cout << "❌ Stopped early: the file could not be read to the end.\n";
+    }
+    cout << "\n⏩ Fast-forwarded " << summary.arrivals << " arrivals over "
+        << (summary.endTime - summary.startTime) / 60 << " simulated minutes in " << took << " ms\n";
+    cout << "Admitted: " << summary.admitted << ", still waiting: " << summary.waiting;
+    if (summary.skipped > 0) {
+        cout << ", malformed events skipped: " << summary.skipped;
+    }
+    cout << "\n";
+    cout << "Queue status: " << scratch.getQueueStatus() << "\n";
+}
+
+void printStaffingReport(const StaffingReport& report, QueueManager& scratch) {
+    streamsize precision = cout.precision();
+    cout << fixed << setprecision(1);
+    cout << "\n👩‍⚕️ Served " << report.served << " patients, mean wait " << report.meanWaitMinutes << " min\n";
+    cout << "Wait percentiles (min): 50th " << report.waitP50Minutes << ", 90th " << report.waitP90Minutes
+        << ", 95th " << report.waitP95Minutes << ", 99th " << report.waitP99Minutes
+        << ", max " << report.maxWaitMinutes << "\n";
+    for (const LaneStaffingReport& lane : report.lanes) {
+        cout << "  " << left << setw(10) << lane.serviceType << right << lane.counters << " counters, "
+            << lane.served << " served, median wait " << lane.waitP50Minutes << " min, 90th "
+            << lane.waitP90Minutes << " min, " << lane.utilization * 100 << "% busy\n";
+    }
+    if (report.floatingCounters > 0) {
+        cout << "  Floating  " << report.floatingCounters << " counters, "
+            << report.floatingUtilization * 100 << "% busy\n";
+    }
+    cout << "Lane redirects: " << report.redirects << "\n";
+
+    const ServiceTypeRegistry& types = scratch.getServiceTypes();
+    cout << "Waiting by hour:\n  Time ";
+    for (int i = 0; i < types.size(); i++) {
+        cout << setw(11) << types.nameOf(i);
+    }
+    cout << "\n";
+    for (const QueueLengthSample& sample : report.queueLengths) {
+        cout << "  " << setw(2) << setfill('0') << sample.time / 3600 << ":00" << setfill(' ');
+        for (int waiting : sample.waiting) {
+            cout << setw(11) << waiting;
+        }
+        cout << "\n";
+    }
+    cout.unsetf(ios::fixed);
+    cout.precision(precision);
+}
+
 void runSimulation(QueueManager& queue) {
     SimulationManager simManager(&queue);
 
     cout << "\n🎬 Simulation Options:\n";
     cout << "1. Load from JSON file\n";
     cout << "2. Quick demo simulation\n";
-    cout << "Choice (1-2): ";
+    cout << "3. Fast-forward JSON file (headless, separate queue)\n";
+    cout << "4. Generate a synthetic day (headless, separate queue)\n";
+    cout << "Choice (1-4): ";
+
+    int choice = getIntInput(1, 4);
+
+    if (choice == 3 || choice == 4) {
+        // A scratch queue, so the simulated day does not mix with the live one.
+        PriorityEngine scratchEngine;
+        QueueManager scratch(&scratchEngine);
+        SimulationManager headless(&scratch);
+        SimulationSummary summary;
+        auto started = chrono::steady_clock::now();
 
-    int choice = getIntInput(1, 2);
+        if (choice == 3) {
+            cout << "Enter JSON filename (default: simulation_data.json): ";
+            string filename;
+            cin.ignore();
+            getline(cin, filename);
+            if (filename.empty()) filename = "simulation_data.json";
+            started = chrono::steady_clock::now();
+            summary = headless.runHeadless(filename);
+        }
+        else {
+            cout << "Seed (1-1000000): ";
+            int seed = getIntInput(1, 1000000);
+            cout << "Average arrivals per hour (1-100000): ";
+            int rate = getIntInput(1, 100000);
+            cout << "Mass-casualty burst at 14:00? (1 = yes, 0 = no): ";
+            bool burst = getIntInput(0, 1) == 1;
+            cout << "Counters per lane (0 = nobody is served, up to 20): ";
+            int counters = getIntInput(0, 20);
+            cout << "Floating counters serving any lane (0-100): ";
+            int floating = getIntInput(0, 100);
+
+            WorkloadConfig config = WorkloadConfig::typicalDay(seed, rate);
+            if (burst) {
+                config.bursts.push_back({ 14 * 60, 45, rate * 4.0, 4, "Emergency" });
+            }
+            StaffingConfig staffing = StaffingConfig::evenStaffing(seed, counters);
+            staffing.floatingCounters = floating;
+            staffing.sampleIntervalSeconds = 3600;
+            headless.setStaffing(staffing);
+
+            WorkloadGenerator generator(config);
+            started = chrono::steady_clock::now();
+            summary = headless.runHeadless(generator);
+        }
+        double took = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        printHeadlessSummary(summary, took, scratch);
+        if (choice == 4 && headless.getStaffingReport().served > 0) {
+            printStaffingReport(headless.getStaffingReport(), scratch);
+        }
+        return;
+    }
 
     if (choice == 1) {
         cout << "Enter JSON filename (default: simulation_data.json): ";
@@ -87,36 +194,143 @@ void runSimulation(QueueManager& queue) {
         simManager.addEvent(5, 203, 2, "Checkup");
         simManager.addEvent(7, 204, 4, "Emergency");
         simManager.addEvent(10, 205, 1, "Checkup");
+        // The last checkup gives up waiting two minutes later.
+        simManager.scheduleDeparture(12 * 60, 205);
 
         cout << "\n🚀 Running quick demo simulation...\n";
         simManager.runSimulation();
     }
 }
 
+string readFilename(const string& fallback) {
+    cout << "Enter filename (default: " << fallback << "): ";
+    string filename;
+    cin.ignore();
+    getline(cin, filename);
+    return filename.empty() ? fallback : filename;
+}
+
+// Record the live queue to a trace, replay one, or turn a JSON scenario into one.
+void useTraces(QueueManager& queue, TraceWriter& recorder) {
+    cout << "\n🎞️ Session Traces\n";
+    cout << (recorder.isOpen() ? "1. Stop recording\n" : "1. Start recording the live queue\n");
+    cout << "2. Replay a trace (separate queue)\n";
+    cout << "3. Convert JSON scenario to a trace\n";
+    cout << "Choice (1-3): ";
+
+    int choice = getIntInput(1, 3);
+    if (choice == 1) {
+        if (recorder.isOpen()) {
+            queue.setTraceWriter(nullptr);
+            long long records = recorder.recordCount();
+            recorder.close();
+            cout << "⏹️ Recording stopped after " << records << " records.\n";
+            return;
+        }
+        string filename = readFilename("session.trace");
+        if (!recorder.open(filename)) {
+            cout << "❌ Cannot create " << filename << "\n";
+            return;
+        }
+        queue.setTraceWriter(&recorder);
+        cout << "⏺️ Recording to " << filename << "\n";
+    }
+    else if (choice == 2) {
+        string filename = readFilename("session.trace");
+
+        // Configured as the live queue is at startup.
+        PriorityEngine scratchEngine;
+        scratchEngine.setWeights(0.5f, 0.3f, 0.2f);
+        scratchEngine.setServiceTypeScore("Emergency", 10);
+        scratchEngine.setServiceTypeScore("Critical", 8);
+        scratchEngine.setServiceTypeScore("Checkup", 5);
+        QueueManager scratch(&scratchEngine);
+        scratch.setFairnessParams(25, 0.5f);
+
+        TraceReplayer replayer(&scratch);
+        TraceReplayResult result = replayer.replay(filename);
+        if (!result.complete) {
+            cout << "❌ Stopped early: the trace could not be read to the end.\n";
+        }
+        cout << "\n⏩ Replayed " << result.operations << " calls in " << result.seconds * 1000 << " ms\n";
+        cout << "Served: " << result.served << ", differing from the recording: " << result.mismatches;
+        if (result.mismatches > 0) {
+            cout << " (first in call " << result.firstMismatch << ")";
+        }
+        cout << "\n";
+        cout << "Total wait: " << result.recordedWaitSeconds / 60 << " min recorded, "
+            << result.replayedWaitSeconds / 60 << " min replayed\n";
+        cout << "Queue status: " << scratch.getQueueStatus() << "\n";
+    }
+    else {
+        string filename = readFilename("simulation_data.json");
+        string traceName = filename + ".trace";
+        SimulationManager converter(&queue);
+        long long events = converter.exportTrace(filename, traceName);
+        if (events < 0) {
+            cout << "❌ Conversion failed.\n";
+            return;
+        }
+        cout << "✅ Wrote " << events << " arrivals to " << traceName << "\n";
+    }
+}
+
 void servePatients(QueueManager& queue) {
     cout << "\n🔄 Serve Patients Mode\n";
     cout << "How many patients to serve? (1-10): ";
     int count = getIntInput(1, 10);
 
-    for (int i = 0; i < count; i++) {
-        Patient* p = queue.serveNextPatient();
-        if (p) {
-            cout << "🩺 Served Patient " << p->getId()
-                << " (Final Score: " << p->getPriorityScore()
-                << ", Wait Time: " << p->getTotalWaitTimeMinutes() << " min)\n";
-            delete p;
+    vector<Patient*> served;
+    queue.serveNext(count, served);
+    Logger::get().flush();
+    for (Patient* p : served) {
+        cout << "🩺 Served Patient " << p->getId()
+            << " (Final Score: " << p->getPriorityScore()
+            << ", Wait Time: " << p->getTotalWaitTimeMinutes() << " min)\n";
+    }
+    if (static_cast<int>(served.size()) < count) {
+        cout << "❌ No more patients in queue!\n";
+    }
+}
+
+void useCounters(QueueManager& queue) {
+    queue.printCounters();
+    int count = queue.getCounterCount();
+    if (count == 0) {
+        return;
+    }
+    cout << "\nSelect a counter that is now free (1-" << count << "), or 0 to fill every idle counter: ";
+    int choice = getIntInput(0, count);
+
+    if (choice == 0) {
+        auto assigned = queue.dispatchIdleCounters();
+        Logger::get().flush();
+        if (assigned.empty()) {
+            cout << "❌ No idle counter has a patient waiting in its queues!\n";
         }
-        else {
-            cout << "❌ No more patients in queue!\n";
-            break;
+        for (auto& entry : assigned) {
+            cout << "🩺 " << queue.getCounterStatus(entry.first).name << " took Patient " << entry.second->getId()
+                << " (Final Score: " << entry.second->getPriorityScore()
+                << ", Wait Time: " << entry.second->getTotalWaitTimeMinutes() << " min)\n";
         }
+        return;
+    }
 
-        // Small delay between servings
-        this_thread::sleep_for(chrono::milliseconds(500));
+    Patient* p = queue.serveAtCounter(choice - 1);
+    Logger::get().flush();
+    if (p) {
+        cout << "🩺 Served Patient " << p->getId()
+            << " (Final Score: " << p->getPriorityScore()
+            << ", Wait Time: " << p->getTotalWaitTimeMinutes() << " min)\n";
+    }
+    else {
+        cout << "❌ No patients waiting for this counter; it is now idle.\n";
     }
 }
 
 void runHospitalSystem() {
+    // Outlives the queue, which may still be recording to it at exit.
+    TraceWriter recorder;
     PriorityEngine engine;
     QueueManager queue(&engine);
     AdminConsole console(&engine, &queue);
@@ -129,10 +343,25 @@ void runHospitalSystem() {
     console.setServiceTypeScore("Checkup", 5);
     console.setFairnessParams(25, 0.5f);
 
+    long long recovered = queue.recover("hospital.snapshot", "hospital.journal");
+    if (recovered < 0) {
+        cerr << "Warning: cannot open hospital.journal; changes will not be saved.\n";
+    }
+    else if (recovered > 0) {
+        cout << "Recovered " << recovered << " journal records from hospital.journal.\n";
+    }
+    queue.setSnapshotInterval(300);
+
+    queue.addCounter("Emergency Counter", { "Emergency", "Critical" });
+    queue.addCounter("Critical Counter", { "Critical", "Emergency" });
+    queue.addCounter("Checkup Counter", { "Checkup" });
+
     cout << "\n🏥 Welcome to Smart Hospital Queue Management System\n";
     cout << "==================================================\n";
 
     while (true) {
+        // Queue messages from the last action are written before the menu.
+        Logger::get().flush();
         cout << "\n🏠 Main Menu\n"
             << "1. Add Patient\n"
             << "2. Serve Next Patient\n"
@@ -145,20 +374,22 @@ void runHospitalSystem() {
             << "9. Exit\n"
             << "10. Show Frequent Visitors\n"
             << "11. Emergency Serve Patient\n"
-            << "Choice (1-11): ";
+            << "12. Service Counters\n"
+            << "13. Session Traces\n"
+            << "Choice (1-13): ";
 
-        switch (getIntInput(1, 11)) { 
+        switch (getIntInput(1, 13)) { 
         case 1:
             addPatient(queue);
             break;
 
         case 2: {
             Patient* p = queue.serveNextPatient();
+            Logger::get().flush();
             if (p) {
                 cout << "\n🩺 Served Patient " << p->getId()
                     << " (Final Score: " << p->getPriorityScore()
                     << ", Wait Time: " << p->getTotalWaitTimeMinutes() << " min)\n";
-                delete p;
             }
             else {
                 cout << "\n❌ No patients in queue!\n";
@@ -214,16 +445,22 @@ void runHospitalSystem() {
             cout << "\n🚨 Emergency Serve\nEnter Patient ID: ";
             int id = getIntInput(1, 9999);
             Patient* p = queue.servePatientById(id);
+            Logger::get().flush();
             if (p) {
                 cout << "🩺 Emergency Served Patient " << p->getId()
                     << " (Final Score: " << p->getPriorityScore()
                     << ", Wait Time: " << p->getTotalWaitTimeMinutes() << " min)\n";
-                delete p;
             } else {
                 cout << "❌ Patient not found in any queue!\n";
             }
             break;
         }
+        case 12:
+            useCounters(queue);
+            break;
+        case 13:
+            useTraces(queue, recorder);
+            break;
         }
     }
 }